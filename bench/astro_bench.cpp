@@ -0,0 +1,508 @@
+// astro_bench.cpp — benchmark suite: ephemeris, houses, charts, aspects, gazetteer (C++17)
+//
+// usage: astro_bench [options]
+//
+// Every case runs one operation in a loop: enough iterations per repetition
+// to fill min-time / reps, then the median time per operation over the
+// repetitions. Inputs are fixed pseudo-random data, so runs on one machine
+// compare across builds. Case names are group/what/variant:
+//
+//   calc/<body>/<flags>/<warm|cold>    swe_calc_ut, SWIEPH or MOSEPH, plain,
+//                                      +speed and +speed+topo
+//   houses/<letter>/<warm|cold>        swe_houses_ex, every CalcH system
+//   chart/compute/<warm|cold>          AstrologyChart construction + compute()
+//   table/year/<loop|batch>            one year of daily positions of every
+//                                      body, SWIEPH+speed: a body-major
+//                                      swe_calc_ut loop or one swe_calc_ut_batch
+//   aspects/find, aspects/cross        AspectFinder on computed charts
+//   gazetteer/...                      text search, nearest place, open
+//
+// warm: the state is primed and inputs stay within one year, so ephemeris
+// segments are cached (the steady state of a running service). cold: every
+// operation starts after swe_close() with births spread over 1900..2100, so
+// it pays for opening files, reading headers and decoding its segment (the
+// first chart of a process). Aspects and searches keep no ephemeris state
+// and only run warm; gazetteer/open is their cold start.
+//
+// --json writes the results, one case per line, for --baseline to compare a
+// later run against. A case slower than the baseline by more than
+// --threshold percent is a regression and makes the exit code 1.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Aspects.hpp"
+#include "AstrologyChart.hpp"
+#include "Gazetteer.hpp"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+namespace fs = std::filesystem;
+
+const size_t kInputs = 1024;                // distinct inputs per case, cycled
+const char kHouseLetters[] = "ABCDEFGHIiJKLMNOPQRSTUVWXY";
+
+struct Options {
+    std::string ephe, places, json, baseline, filter;
+    double minTime = 0.2;                   // seconds per case
+    int reps = 5;
+    double threshold = 10.0;                // percent
+    bool list = false;
+};
+
+struct Case {
+    std::string name;
+    std::function<void()> setup;            // once, before the case (may be empty)
+    std::function<void(size_t i)> op;       // the measured operation on input i
+};
+
+struct Result {
+    std::string name;
+    double ns{}, minNs{}, maxNs{};          // per operation: median, fastest and slowest rep
+    uint64_t iterations{};
+};
+
+volatile double g_sink;                     // keeps results alive
+
+// ---- Inputs ----
+struct Birth { double jd, lat, lon; };
+
+std::vector<Birth> make_births(uint64_t seed, double jd0, double jd1) {
+    std::mt19937_64 rng(seed);
+    std::uniform_real_distribution<double> jd(jd0, jd1), lat(-60.0, 60.0), lon(-180.0, 180.0);
+    std::vector<Birth> v(kInputs);
+    for (Birth& b : v) b = { jd(rng), lat(rng), lon(rng) };
+    return v;
+}
+
+// Synthetic places for the gazetteer cases: deterministic, world-wide, with
+// names built from syllables so that trigram and prefix queries have work.
+std::string write_places_csv(size_t n) {
+    static const char* const kSyl[] = { "an", "ber", "ca", "dor", "el", "fa", "gra", "hal", "is", "jo",
+        "ka", "lin", "mar", "no", "or", "pe", "qui", "ros", "san", "ta", "ur", "vil", "wes", "zan" };
+    const size_t ns = sizeof(kSyl) / sizeof(kSyl[0]);
+    std::mt19937_64 rng(7);
+    std::uniform_real_distribution<double> lat(-60.0, 70.0), lon(-180.0, 180.0);
+    const fs::path path = fs::temp_directory_path() / "astro_bench_places.csv";
+    std::ofstream f(path, std::ios::binary);
+    f << "name,admin,country,lat,lon,tzid\n";
+    char buf[200];
+    for (size_t i = 0; i < n; ++i) {
+        std::string name;
+        const int parts = 2 + (int)(rng() % 3);
+        for (int k = 0; k < parts; ++k) name += kSyl[rng() % ns];
+        name[0] = (char)(name[0] - 'a' + 'A');
+        std::snprintf(buf, sizeof(buf), "%s,Region %u,Country %u,%.4f,%.4f,Etc/UTC\n",
+                      name.c_str(), (unsigned)(rng() % 500), (unsigned)(rng() % 200), lat(rng), lon(rng));
+        f << buf;
+    }
+    return path.string();
+}
+
+// ---- Cases ----
+void add_calc_cases(std::vector<Case>& cases, const Options& o) {
+    static const struct { const char* name; int32 flags; } kFlagSets[] = {
+        { "swieph",            SEFLG_SWIEPH },
+        { "swieph+speed",      SEFLG_SWIEPH | SEFLG_SPEED },
+        { "swieph+speed+topo", SEFLG_SWIEPH | SEFLG_SPEED | SEFLG_TOPOCTR },
+        { "moseph",            SEFLG_MOSEPH },
+        { "moseph+speed",      SEFLG_MOSEPH | SEFLG_SPEED },
+        { "moseph+speed+topo", SEFLG_MOSEPH | SEFLG_SPEED | SEFLG_TOPOCTR },
+    };
+    static const std::vector<Birth> warm = make_births(1, 2460310.5, 2460676.5);     // 2024
+    static const std::vector<Birth> cold = make_births(2, 2415020.5, 2488069.5);     // 1900..2100
+    const std::string ephe = o.ephe;
+    for (const BodyInfo& b : kBodyInfo) {
+        for (const auto& set : kFlagSets) {
+            const int ipl = b.ipl;
+            const int32 flags = set.flags;
+            const bool topo = (flags & SEFLG_TOPOCTR) != 0;
+            const std::string base = std::string("calc/") + b.key + "/" + set.name;
+            cases.push_back({ base + "/warm",
+                [ephe, topo] {
+                    swe_set_ephe_path(ephe.c_str());
+                    if (topo) swe_set_topo(13.4, 52.5, 40.0);
+                },
+                [ipl, flags](size_t i) {
+                    double xx[6]; char serr[AS_MAXCH];
+                    swe_calc_ut(warm[i % kInputs].jd, ipl, flags, xx, serr);
+                    g_sink = xx[0];
+                } });
+            cases.push_back({ base + "/cold", nullptr,
+                [ephe, ipl, flags, topo](size_t i) {
+                    swe_close();
+                    swe_set_ephe_path(ephe.c_str());
+                    if (topo) swe_set_topo(13.4, 52.5, 40.0);
+                    double xx[6]; char serr[AS_MAXCH];
+                    swe_calc_ut(cold[i % kInputs].jd, ipl, flags, xx, serr);
+                    g_sink = xx[0];
+                } });
+        }
+    }
+}
+
+void add_house_cases(std::vector<Case>& cases, const Options& o) {
+    static const std::vector<Birth> warm = make_births(3, 2460310.5, 2460676.5);
+    static const std::vector<Birth> cold = make_births(4, 2415020.5, 2488069.5);
+    const std::string ephe = o.ephe;
+    for (const char* p = kHouseLetters; *p; ++p) {
+        const int hsys = *p;
+        const std::string base = std::string("houses/") + *p;
+        cases.push_back({ base + "/warm", [ephe] { swe_set_ephe_path(ephe.c_str()); },
+            [hsys](size_t i) {
+                const Birth& b = warm[i % kInputs];
+                double cusps[37], ascmc[10];
+                swe_houses_ex(b.jd, 0, b.lat, b.lon, hsys, cusps, ascmc);
+                g_sink = cusps[1];
+            } });
+        cases.push_back({ base + "/cold", nullptr,
+            [ephe, hsys](size_t i) {
+                swe_close();
+                swe_set_ephe_path(ephe.c_str());
+                const Birth& b = cold[i % kInputs];
+                double cusps[37], ascmc[10];
+                swe_houses_ex(b.jd, 0, b.lat, b.lon, hsys, cusps, ascmc);
+                g_sink = cusps[1];
+            } });
+    }
+}
+
+struct CivilBirth { int Y, M, D; double hour, lat, lon; };
+
+std::vector<CivilBirth> to_civil(const std::vector<Birth>& v) {
+    std::vector<CivilBirth> out;
+    for (const Birth& b : v) {
+        CivilBirth c{ 0, 0, 0, 0, b.lat, b.lon };
+        swe_revjul(b.jd, SE_GREG_CAL, &c.Y, &c.M, &c.D, &c.hour);
+        out.push_back(c);
+    }
+    return out;
+}
+
+void add_chart_cases(std::vector<Case>& cases, const Options& o) {
+    static const std::vector<CivilBirth> warm = to_civil(make_births(5, 2460310.5, 2460676.5));
+    static const std::vector<CivilBirth> cold = to_civil(make_births(6, 2415020.5, 2488069.5));
+    const std::string ephe = o.ephe;
+    cases.push_back({ "chart/compute/warm", [ephe] { swe_set_ephe_path(ephe.c_str()); },
+        [](size_t i) {
+            const CivilBirth& b = warm[i % kInputs];
+            AstrologyChart c(b.Y, b.M, b.D, b.hour, b.lat, b.lon, 'P');
+            c.compute();
+            g_sink = c.getHouses().ascmc[SE_ASC];
+        } });
+    cases.push_back({ "chart/compute/cold", nullptr,
+        [ephe](size_t i) {
+            swe_close();
+            swe_set_ephe_path(ephe.c_str());
+            const CivilBirth& b = cold[i % kInputs];
+            AstrologyChart c(b.Y, b.M, b.D, b.hour, b.lat, b.lon, 'P');
+            c.compute();
+            g_sink = c.getHouses().ascmc[SE_ASC];
+        } });
+}
+
+// The years step through 1600..2099, so a run covers the same ground as a
+// 500-year table a little at a time.
+void add_table_cases(std::vector<Case>& cases, const Options& o) {
+    static const int kDays = 365;
+    static std::vector<int32> ipl;
+    static std::vector<double> jd, xx;
+    const std::string ephe = o.ephe;
+    auto setup = [ephe] {
+        swe_set_ephe_path(ephe.c_str());
+        ipl.clear();
+        for (const BodyInfo& b : kBodyInfo) ipl.push_back(b.ipl);
+        jd.resize(kDays);
+        xx.resize(6 * jd.size() * ipl.size());
+    };
+    auto days = [](size_t i) {
+        const double jd0 = swe_julday(1600 + (int)(i % 500), 1, 1, 0.0, SE_GREG_CAL);
+        for (int d = 0; d < kDays; ++d) jd[d] = jd0 + d;
+    };
+    const int32 flags = SEFLG_SWIEPH | SEFLG_SPEED;
+    cases.push_back({ "table/year/loop", setup, [days, flags](size_t i) {
+        days(i);
+        char serr[AS_MAXCH];
+        for (size_t k = 0; k < ipl.size(); ++k)
+            for (int d = 0; d < kDays; ++d) swe_calc_ut(jd[d], ipl[k], flags, &xx[6 * (k * kDays + d)], serr);
+        g_sink = xx[0];
+    } });
+    cases.push_back({ "table/year/batch", setup, [days, flags](size_t i) {
+        days(i);
+        char serr[AS_MAXCH];
+        swe_calc_ut_batch(jd.data(), kDays, ipl.data(), (int32)ipl.size(), flags, xx.data(), nullptr, serr);
+        g_sink = xx[0];
+    } });
+}
+
+void add_aspect_cases(std::vector<Case>& cases, const Options& o) {
+    // Aspect points of kInputs computed charts, with ASC and MC.
+    static std::vector<std::vector<AspectPoint>> pts;
+    static AspectFinder finder;
+    static const OrbWeights w = OrbWeights::fromClasses(kDefaultOrbClassWeights);
+    const std::string ephe = o.ephe;
+    auto setup = [ephe] {
+        if (!pts.empty()) return;
+        swe_set_ephe_path(ephe.c_str());
+        for (const CivilBirth& b : to_civil(make_births(8, 2415020.5, 2488069.5))) {
+            AstrologyChart c(b.Y, b.M, b.D, b.hour, b.lat, b.lon, 'P');
+            c.compute();
+            pts.push_back(aspect_points(c.getBodies(), &c.getHouses()));
+        }
+    };
+    cases.push_back({ "aspects/find", setup, [](size_t i) {
+        const auto& p = pts[i % kInputs];
+        g_sink = (double)finder.find(p.data(), p.size(), kDefaultAspects, kNumDefaultAspects, w).size();
+    } });
+    cases.push_back({ "aspects/cross", setup, [](size_t i) {
+        const auto& a = pts[i % kInputs];
+        const auto& b = pts[(i + 1) % kInputs];
+        g_sink = (double)finder.findCross(a.data(), a.size(), b.data(), b.size(), kDefaultAspects, kNumDefaultAspects, w).size();
+    } });
+}
+
+void add_gazetteer_cases(std::vector<Case>& cases, const Options& o) {
+    static std::string gazPath;
+    static Gazetteer gaz;
+    static std::vector<std::string> prefixes, words;
+    static std::vector<Birth> spots;
+    static std::vector<int> hits;
+    static std::vector<GeoHit> geo;
+    const std::string places = o.places;
+    auto setup = [places] {
+        if (!gazPath.empty()) return;
+        std::string csv = places, err;
+        if (csv.empty()) csv = write_places_csv(200000);
+        if (fs::path(csv).extension() == ".gaz") {
+            gazPath = csv;
+        } else {
+            gazPath = (fs::temp_directory_path() / "astro_bench_places.gaz").string();
+            if (!compile_gazetteer(csv, gazPath, &err)) {
+                std::fprintf(stderr, "astro_bench: %s: %s\n", csv.c_str(), err.c_str());
+                std::exit(1);
+            }
+        }
+        if (!gaz.open(gazPath, &err)) {
+            std::fprintf(stderr, "astro_bench: %s: %s\n", gazPath.c_str(), err.c_str());
+            std::exit(1);
+        }
+        // Queries taken from the data: 2-letter prefixes and 4..6-letter
+        // fragments from the middle of names.
+        std::mt19937_64 rng(9);
+        for (size_t k = 0; k < kInputs; ++k) {
+            const std::string name(gaz[rng() % gaz.size()].name);
+            prefixes.push_back(name.substr(0, 2));
+            const size_t len = 4 + rng() % 3;
+            const size_t at = name.size() > len ? rng() % (name.size() - len + 1) : 0;
+            words.push_back(name.substr(at, len));
+        }
+        spots = make_births(10, 0, 1);
+    };
+    cases.push_back({ "gazetteer/search/prefix", setup, [](size_t i) {
+        gaz.index().find(prefixes[i % kInputs].c_str(), hits, 20);
+        g_sink = (double)hits.size();
+    } });
+    cases.push_back({ "gazetteer/search/text", setup, [](size_t i) {
+        gaz.index().find(words[i % kInputs].c_str(), hits, 20);
+        g_sink = (double)hits.size();
+    } });
+    cases.push_back({ "gazetteer/nearest", setup, [](size_t i) {
+        gaz.geo().nearest(spots[i % kInputs].lat, spots[i % kInputs].lon, 1, geo);
+        g_sink = geo.empty() ? 0.0 : geo[0].km;
+    } });
+    cases.push_back({ "gazetteer/open", setup, [](size_t i) {
+        Gazetteer g;
+        g.open(gazPath);
+        g.index().find(words[i % kInputs].c_str(), hits, 20);
+        g_sink = (double)hits.size();
+    } });
+}
+
+// ---- Runner ----
+double seconds(Clock::duration d) { return std::chrono::duration<double>(d).count(); }
+
+Result run_case(const Case& c, const Options& o) {
+    if (c.setup) c.setup();
+    const double repTime = o.minTime / o.reps;
+    // Warm-up and calibration: double the count until one rep fills repTime.
+    uint64_t n = 1;
+    size_t next = 0;
+    for (;;) {
+        const Clock::time_point t0 = Clock::now();
+        for (uint64_t k = 0; k < n; ++k) c.op(next++);
+        const double t = seconds(Clock::now() - t0);
+        if (t >= repTime || n >= (1ull << 40)) {
+            if (t > 0) n = std::max<uint64_t>(1, (uint64_t)((double)n * repTime / t));
+            break;
+        }
+        n *= t > 0 ? std::min<uint64_t>(16, std::max<uint64_t>(2, (uint64_t)(repTime / t))) : 16;
+    }
+    std::vector<double> ns;
+    for (int r = 0; r < o.reps; ++r) {
+        const Clock::time_point t0 = Clock::now();
+        for (uint64_t k = 0; k < n; ++k) c.op(next++);
+        ns.push_back(seconds(Clock::now() - t0) * 1e9 / (double)n);
+    }
+    std::sort(ns.begin(), ns.end());
+    return { c.name, ns[ns.size() / 2], ns.front(), ns.back(), n * (uint64_t)o.reps };
+}
+
+std::string json_escape(const std::string& s) {
+    std::string out;
+    for (char c : s) {
+        if (c == '"' || c == '\\') out.push_back('\\');
+        if ((unsigned char)c >= 0x20) out.push_back(c);
+    }
+    return out;
+}
+
+void write_json(std::FILE* f, const Options& o, const std::vector<Result>& results) {
+    char date[32];
+    const std::time_t now = std::time(nullptr);
+    std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+#if defined(__clang__)
+    const std::string compiler = std::string("clang ") + __clang_version__;
+#elif defined(__GNUC__)
+    const std::string compiler = std::string("gcc ") + __VERSION__;
+#elif defined(_MSC_VER)
+    const std::string compiler = "msvc " + std::to_string(_MSC_VER);
+#else
+    const std::string compiler = "unknown";
+#endif
+    std::fprintf(f, "{\"schema\":1,\"date\":\"%s\",\"compiler\":\"%s\",\"cpus\":%u,\"min_time_s\":%g,\"reps\":%d,\n"
+                    "\"results\":[\n",
+                 date, json_escape(compiler).c_str(), std::thread::hardware_concurrency(), o.minTime, o.reps);
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Result& r = results[i];
+        std::fprintf(f, "{\"name\":\"%s\",\"ns_per_op\":%.2f,\"min_ns\":%.2f,\"max_ns\":%.2f,\"ops_per_s\":%.1f,\"iterations\":%llu}%s\n",
+                     json_escape(r.name).c_str(), r.ns, r.minNs, r.maxNs, r.ns > 0 ? 1e9 / r.ns : 0.0,
+                     (unsigned long long)r.iterations, i + 1 < results.size() ? "," : "");
+    }
+    std::fprintf(f, "]}\n");
+}
+
+// name -> ns_per_op from a file written by write_json (one result per line).
+bool read_baseline(const std::string& path, std::map<std::string, double>& out) {
+    std::ifstream f(path);
+    if (!f) return false;
+    std::string line;
+    while (std::getline(f, line)) {
+        const size_t n = line.find("{\"name\":\"");
+        const size_t v = line.find("\"ns_per_op\":");
+        if (n == std::string::npos || v == std::string::npos) continue;
+        const size_t end = line.find('"', n + 9);
+        if (end == std::string::npos) continue;
+        out[line.substr(n + 9, end - n - 9)] = std::strtod(line.c_str() + v + 12, nullptr);
+    }
+    return true;
+}
+
+void usage() {
+    std::fprintf(stderr,
+        "usage: astro_bench [options]\n"
+        "  --ephe PATH        ephemeris directory (default $SE_EPHE_PATH, else data/ephe)\n"
+        "  --places FILE      places CSV or .gaz for the gazetteer cases (default: synthetic)\n"
+        "  --filter TEXT      only cases whose name contains TEXT\n"
+        "  --list             print the case names and exit\n"
+        "  --min-time S       seconds per case (default 0.2)\n"
+        "  --reps N           timed repetitions per case, median reported (default 5)\n"
+        "  --json FILE        write the results as JSON (- for stdout)\n"
+        "  --baseline FILE    compare with an earlier --json file\n"
+        "  --threshold PCT    slowdown counted as a regression (default 10)\n");
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options o;
+    for (int i = 1; i < argc; ++i) {
+        const std::string a = argv[i];
+        if (a == "--list") { o.list = true; continue; }
+        if (a == "-h" || a == "--help" || i + 1 >= argc) { usage(); return 2; }
+        const char* v = argv[++i];
+        if (a == "--ephe") o.ephe = v;
+        else if (a == "--places") o.places = v;
+        else if (a == "--filter") o.filter = v;
+        else if (a == "--min-time") o.minTime = std::max(0.001, std::atof(v));
+        else if (a == "--reps") o.reps = std::max(1, std::atoi(v));
+        else if (a == "--json") o.json = v;
+        else if (a == "--baseline") o.baseline = v;
+        else if (a == "--threshold") o.threshold = std::atof(v);
+        else { usage(); return 2; }
+    }
+    if (o.ephe.empty()) {
+        const char* env = std::getenv("SE_EPHE_PATH");
+        o.ephe = env && *env ? env : "data/ephe";
+    }
+    if (!fs::path(o.ephe).is_absolute()) o.ephe = fs::weakly_canonical(fs::current_path() / o.ephe).string();
+
+    std::vector<Case> cases;
+    add_calc_cases(cases, o);
+    add_house_cases(cases, o);
+    add_chart_cases(cases, o);
+    add_table_cases(cases, o);
+    add_aspect_cases(cases, o);
+    add_gazetteer_cases(cases, o);
+    cases.erase(std::remove_if(cases.begin(), cases.end(),
+        [&](const Case& c) { return c.name.find(o.filter) == std::string::npos; }), cases.end());
+    if (o.list) {
+        for (const Case& c : cases) std::printf("%s\n", c.name.c_str());
+        return 0;
+    }
+
+    std::map<std::string, double> base;
+    if (!o.baseline.empty() && !read_baseline(o.baseline, base)) {
+        std::fprintf(stderr, "astro_bench: cannot read %s\n", o.baseline.c_str());
+        return 2;
+    }
+    std::FILE* out = o.json == "-" ? stderr : stdout;   // keep stdout for the JSON
+    if (base.empty()) std::fprintf(out, "%-36s %14s %14s %8s\n", "case", "ns/op", "ops/s", "spread");
+    else std::fprintf(out, "%-36s %14s %14s %8s %14s %8s\n", "case", "ns/op", "ops/s", "spread", "baseline", "change");
+
+    std::vector<Result> results;
+    int regressions = 0;
+    for (const Case& c : cases) {
+        const Result r = run_case(c, o);
+        results.push_back(r);
+        std::fprintf(out, "%-36s %14.1f %14.0f %7.1f%%", r.name.c_str(), r.ns, 1e9 / r.ns,
+                     r.ns > 0 ? 100.0 * (r.maxNs - r.minNs) / r.ns : 0.0);
+        auto it = base.find(r.name);
+        if (it != base.end() && it->second > 0) {
+            const double change = 100.0 * (r.ns / it->second - 1.0);
+            const bool worse = change > o.threshold;
+            regressions += worse;
+            std::fprintf(out, " %14.1f %+7.1f%%%s", it->second, change, worse ? "  REGRESSION" : "");
+        }
+        std::fprintf(out, "\n");
+        std::fflush(out);
+    }
+    swe_close();
+
+    if (!o.json.empty()) {
+        std::FILE* f = o.json == "-" ? stdout : std::fopen(o.json.c_str(), "w");
+        if (!f) {
+            std::fprintf(stderr, "astro_bench: cannot write %s\n", o.json.c_str());
+            return 2;
+        }
+        write_json(f, o, results);
+        if (f != stdout) std::fclose(f);
+    }
+    if (!base.empty())
+        std::fprintf(out, "%d of %zu cases slower than the baseline by more than %g%%\n",
+                     regressions, results.size(), o.threshold);
+    return regressions ? 1 : 0;
+}
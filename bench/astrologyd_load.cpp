@@ -0,0 +1,280 @@
+// astrologyd_load.cpp — closed-loop load generator for astrologyd (C++17, POSIX)
+//
+// usage: astrologyd_load [options]
+//
+// Each client holds one connection and sends a request as soon as the
+// previous response is complete, so concurrency is the client count. Births
+// are pseudo-random (1900..2100, lat -60..60, any lon), like
+// chart_pool_bench. Latency is measured per request, send to last byte, and
+// reported as p50/p90/p99/p99.9 after a warm-up that is not counted.
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "ChartIO.hpp"
+#include "LatencyHistogram.hpp"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+    std::string socketPath = "/tmp/astrologyd.sock";
+    int port = 0;                   // > 0: HTTP instead of the Unix socket
+    unsigned clients = 16;
+    double seconds = 10, warmup = 1;
+    unsigned charts = 1;            // births per request
+    bool binary = false, json = false;
+};
+
+int connect_to(const Options& o) {
+    int fd;
+    if (o.port > 0) {
+        fd = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in a{};
+        a.sin_family = AF_INET;
+        a.sin_port = htons((uint16_t)o.port);
+        a.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (fd < 0 || connect(fd, (sockaddr*)&a, sizeof(a)) < 0) return -1;
+        const int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    } else {
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        sockaddr_un a{};
+        a.sun_family = AF_UNIX;
+        std::strncpy(a.sun_path, o.socketPath.c_str(), sizeof(a.sun_path) - 1);
+        if (fd < 0 || connect(fd, (sockaddr*)&a, sizeof(a)) < 0) return -1;
+    }
+    return fd;
+}
+
+bool send_all(int fd, const std::string& s) {
+    size_t off = 0;
+    while (off < s.size()) {
+        const ssize_t k = send(fd, s.data() + off, s.size() - off, MSG_NOSIGNAL);
+        if (k <= 0) return false;
+        off += (size_t)k;
+    }
+    return true;
+}
+
+// Reads until buf holds at least n bytes.
+bool recv_at_least(int fd, std::string& buf, size_t n) {
+    char tmp[64 << 10];
+    while (buf.size() < n) {
+        const ssize_t k = recv(fd, tmp, sizeof(tmp), 0);
+        if (k <= 0) return false;
+        buf.append(tmp, (size_t)k);
+    }
+    return true;
+}
+
+struct Client {
+    LatencyHistogram latencyNs;
+    uint64_t requests{}, errors{};
+    std::string failure;
+};
+
+// One response; counts the rows that carry an error. Over HTTP a binary
+// body starts with a BinHeader, which sets recordBytes. False if the
+// connection broke or the response was malformed.
+bool read_response(int fd, const Options& o, uint32_t& recordBytes, std::string& buf, uint64_t& errors) {
+    size_t bodyAt = 0, bodyLen = 0;
+    if (o.port > 0) {
+        size_t end;
+        while ((end = buf.find("\r\n\r\n")) == std::string::npos)
+            if (!recv_at_least(fd, buf, buf.size() + 1)) return false;
+        if (buf.compare(0, 12, "HTTP/1.1 200") != 0) return false;
+        const size_t cl = buf.find("Content-Length: ");
+        if (cl == std::string::npos || cl > end) return false;
+        bodyLen = std::strtoull(buf.c_str() + cl + 16, nullptr, 10);
+        bodyAt = end + 4;
+        if (!recv_at_least(fd, buf, bodyAt + bodyLen)) return false;
+        if (o.binary) {
+            BinHeader h;
+            if (bodyLen < sizeof(h)) return false;
+            std::memcpy(&h, buf.data() + bodyAt, sizeof(h));
+            recordBytes = h.recordBytes;
+            if (bodyLen != sizeof(h) + (size_t)o.charts * recordBytes) return false;
+            bodyAt += sizeof(BinHeader);
+            bodyLen -= sizeof(BinHeader);
+        }
+    } else if (o.binary) {
+        bodyLen = (size_t)o.charts * recordBytes;
+        if (!recv_at_least(fd, buf, bodyLen)) return false;
+    } else {
+        size_t lines = 0, p = 0;
+        while (lines < o.charts) {
+            const size_t nl = buf.find('\n', p);
+            if (nl == std::string::npos) {
+                if (!recv_at_least(fd, buf, buf.size() + 1)) return false;
+                continue;
+            }
+            p = nl + 1;
+            ++lines;
+        }
+        bodyLen = p;
+    }
+    if (o.binary) {
+        for (size_t r = 0; r < o.charts; ++r) {
+            int32_t status;
+            std::memcpy(&status, buf.data() + bodyAt + r * recordBytes, sizeof(status));
+            errors += status != 0;
+        }
+    } else {
+        const std::string_view body(buf.data() + bodyAt, bodyLen);
+        for (size_t p = 0; (p = body.find("\"error\":", p)) != std::string_view::npos; ++p) ++errors;
+    }
+    buf.erase(0, bodyAt + bodyLen);
+    return true;
+}
+
+void run_client(const Options& o, unsigned id, Clock::time_point measureFrom, Clock::time_point until, Client& c) {
+    const int fd = connect_to(o);
+    if (fd < 0) {
+        c.failure = "cannot connect";
+        return;
+    }
+    std::string buf, req;
+    uint32_t recordBytes = 0;
+    if (o.binary && o.port <= 0) {
+        BinHeader h;
+        if (!send_all(fd, "bin\n") || !recv_at_least(fd, buf, sizeof(h))) {
+            c.failure = "no binary header";
+            close(fd);
+            return;
+        }
+        std::memcpy(&h, buf.data(), sizeof(h));
+        recordBytes = h.recordBytes;
+        buf.erase(0, sizeof(h));
+    }
+
+    std::mt19937_64 rng(1000 + id);
+    std::uniform_real_distribution<double> jd(2415020.5, 2488069.5); // 1900..2100
+    std::uniform_real_distribution<double> lat(-60.0, 60.0);
+    std::uniform_real_distribution<double> lon(-180.0, 180.0);
+    std::string body;
+    char line[160];
+    for (uint64_t n = 0;; ++n) {
+        const Clock::time_point t0 = Clock::now();
+        if (t0 >= until) break;
+        body.clear();
+        for (unsigned k = 0; k < o.charts; ++k) {
+            const int len = std::snprintf(line, sizeof(line), "{\"id\":\"%u-%llu-%u\",\"jd\":%.6f,\"lat\":%.4f,\"lon\":%.4f}\n",
+                                          id, (unsigned long long)n, k, jd(rng), lat(rng), lon(rng));
+            body.append(line, (size_t)len);
+        }
+        if (o.port > 0) {
+            req = "POST /chart";
+            req.append(o.binary ? "?format=bin" : "").append(" HTTP/1.1\r\nHost: 127.0.0.1\r\nContent-Length: ");
+            req.append(std::to_string(body.size())).append("\r\n\r\n").append(body);
+        } else {
+            req.swap(body);
+        }
+        if (!send_all(fd, req)) {
+            c.failure = "send failed";
+            break;
+        }
+        uint64_t errors = 0;
+        if (!read_response(fd, o, recordBytes, buf, errors)) {
+            c.failure = "bad or missing response";
+            break;
+        }
+        if (t0 >= measureFrom) {
+            c.latencyNs.record((uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - t0).count());
+            ++c.requests;
+            c.errors += errors;
+        }
+    }
+    close(fd);
+}
+
+void usage() {
+    std::fprintf(stderr,
+        "usage: astrologyd_load [options]\n"
+        "  --socket PATH   Unix socket (default /tmp/astrologyd.sock)\n"
+        "  --port N        use HTTP on 127.0.0.1:N instead\n"
+        "  --clients N     concurrent connections (default 16)\n"
+        "  --seconds S     measured duration (default 10)\n"
+        "  --warmup S      unmeasured lead-in (default 1)\n"
+        "  --charts N      births per request (default 1)\n"
+        "  --bin           binary responses instead of NDJSON\n"
+        "  --json          print the summary as one JSON object\n");
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options o;
+    for (int i = 1; i < argc; ++i) {
+        const std::string a = argv[i];
+        if (a == "--bin") { o.binary = true; continue; }
+        if (a == "--json") { o.json = true; continue; }
+        if (i + 1 >= argc) { usage(); return 2; }
+        const char* v = argv[++i];
+        if (a == "--socket") o.socketPath = v;
+        else if (a == "--port") o.port = std::atoi(v);
+        else if (a == "--clients") o.clients = std::max(1, std::atoi(v));
+        else if (a == "--seconds") o.seconds = std::atof(v);
+        else if (a == "--warmup") o.warmup = std::atof(v);
+        else if (a == "--charts") o.charts = std::max(1, std::atoi(v));
+        else { usage(); return 2; }
+    }
+
+    const Clock::time_point start = Clock::now();
+    const Clock::time_point measureFrom = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(o.warmup));
+    const Clock::time_point until = measureFrom + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(o.seconds));
+    std::vector<Client> clients(o.clients);
+    std::vector<std::thread> threads;
+    for (unsigned i = 0; i < o.clients; ++i)
+        threads.emplace_back(run_client, std::cref(o), i, measureFrom, until, std::ref(clients[i]));
+    for (auto& t : threads) t.join();
+    const double secs = std::chrono::duration<double>(Clock::now() - measureFrom).count();
+
+    LatencyHistogram all;
+    uint64_t requests = 0, errors = 0;
+    unsigned broken = 0;
+    for (const Client& c : clients) {
+        all.merge(c.latencyNs);
+        requests += c.requests;
+        errors += c.errors;
+        if (!c.failure.empty()) {
+            if (!broken++) std::fprintf(stderr, "astrologyd_load: %s\n", c.failure.c_str());
+        }
+    }
+    const double rps = secs > 0 ? requests / secs : 0;
+    const char* transport = o.port > 0 ? "http" : "unix";
+    const char* format = o.binary ? "bin" : "ndjson";
+    if (o.json) {
+        std::string lat;
+        all.json(lat, 1000.0);
+        std::printf("{\"transport\":\"%s\",\"format\":\"%s\",\"clients\":%u,\"charts_per_request\":%u,"
+                    "\"seconds\":%.3f,\"requests\":%llu,\"requests_per_s\":%.1f,\"charts_per_s\":%.1f,"
+                    "\"chart_errors\":%llu,\"broken_clients\":%u,\"latency_us\":%s}\n",
+                    transport, format, o.clients, o.charts, secs, (unsigned long long)requests, rps,
+                    rps * o.charts, (unsigned long long)errors, broken, lat.c_str());
+    } else {
+        std::printf("%s/%s, %u clients, %u charts per request, %.1f s\n", transport, format, o.clients, o.charts, secs);
+        std::printf("%llu requests: %.0f req/s, %.0f charts/s, %llu chart errors, %u broken clients\n",
+                    (unsigned long long)requests, rps, rps * o.charts, (unsigned long long)errors, broken);
+        std::printf("latency us: p50 %.1f  p90 %.1f  p99 %.1f  p99.9 %.1f  max %.1f\n",
+                    all.quantile(0.50) / 1000.0, all.quantile(0.90) / 1000.0, all.quantile(0.99) / 1000.0,
+                    all.quantile(0.999) / 1000.0, all.max() / 1000.0);
+    }
+    return requests && !broken ? 0 : 1;
+}
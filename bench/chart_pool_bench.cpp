@@ -0,0 +1,64 @@
+// chart_pool_bench.cpp — ChartPool scaling benchmark: charts/sec at 1..N threads (C++17)
+//
+// usage: chart_pool_bench [ephe_path] [charts] [max_threads]
+//
+// Every run computes the same pseudo-random batch of births (1900..2100, any
+// location, Placidus). Results are checked against the 1-thread run, so the
+// benchmark doubles as a determinism check for the pool.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ChartPool.hpp"
+
+int main(int argc, char** argv) {
+    std::string ephe = argc > 1 ? argv[1] : "data/ephe";
+    size_t charts = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 20000;
+    unsigned max_threads = argc > 3 ? (unsigned)std::strtoul(argv[3], nullptr, 10) : std::thread::hardware_concurrency();
+    if (max_threads == 0) max_threads = 1;
+
+    std::mt19937_64 rng(42);
+    std::uniform_real_distribution<double> jd(2415020.5, 2488069.5); // 1900..2100
+    std::uniform_real_distribution<double> lat(-60.0, 60.0);
+    std::uniform_real_distribution<double> lon(-180.0, 180.0);
+
+    ChartBatch batch;
+    batch.reserve(charts);
+    for (size_t i = 0; i < charts; ++i) batch.add(jd(rng), lat(rng), lon(rng), 'P');
+
+    std::vector<double> ref_asc, ref_moon;
+    std::printf("%8s %14s %10s %8s\n", "threads", "charts/sec", "speedup", "same");
+    double base = 0;
+    for (unsigned t = 1; t <= max_threads; ++t) {
+        ChartPool pool(ephe, t);
+        pool.compute(batch);   // warm-up pass: page in ephemeris data on every worker
+
+        auto t0 = std::chrono::steady_clock::now();
+        size_t failed = pool.compute(batch);
+        auto t1 = std::chrono::steady_clock::now();
+        double secs = std::chrono::duration<double>(t1 - t0).count();
+        double rate = charts / secs;
+        if (t == 1) base = rate;
+
+        const double* asc = batch.ascmc(SE_ASC);
+        const double* moon = batch.bodyLon(1);
+        bool same = true;
+        if (t == 1) {
+            ref_asc.assign(asc, asc + charts);
+            ref_moon.assign(moon, moon + charts);
+        } else {
+            same = std::memcmp(ref_asc.data(), asc, charts * sizeof(double)) == 0
+                && std::memcmp(ref_moon.data(), moon, charts * sizeof(double)) == 0;
+        }
+        std::printf("%8u %14.0f %9.2fx %8s", t, rate, rate / base, same ? "yes" : "NO");
+        if (failed) std::printf("  (%zu failed: %s)", failed, batch.failures()[0].message.c_str());
+        std::printf("\n");
+    }
+    return 0;
+}
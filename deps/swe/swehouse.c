@@ -633,7 +633,7 @@ int CALL_CONV swe_houses_armc_ex2(
   struct houses h, hm1, hp1;
   int i, retc = 0, rm1, rp1;
   int ito;
-  static double saved_sundec = 99;
+  static TLS double saved_sundec = 99;
   if (toupper(hsys) == 'G')
     ito = 36;
   else
@@ -62,10 +62,21 @@
 
 #include <string.h>
 #include <ctype.h>
+#include <time.h>
 #if MSDOS
 #include <tchar.h>
 #include <windows.h>
 #endif
+#ifndef SWE_NO_MMAP
+# ifdef _WIN32
+#  include <io.h>
+# else
+#  include <sys/mman.h>
+# endif
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
 #include "swejpl.h"
 #include "swephexp.h"
 #include "sweph.h"
@@ -186,6 +197,23 @@ static int do_fread(void *targ, int size, int count, int corrsize,
 		    FILE *fp, int32 fpos, int freord, int fendian, int ifno, 
 		    char *serr);
 static int get_new_segment(double tjd, int ipli, int ifno, char *serr);
+static int get_new_segment_mapped(double tjd, int ipli, int ifno, char *serr);
+static void map_ephe_file(struct file_data *fdp);
+static void close_ephe_file(struct file_data *fdp);
+static void open_flat_file(struct file_data *fdp);
+static void close_flat_file(struct file_data *fdp);
+static struct plan_data *flat_plan(int ibdy);
+static AS_BOOL flat_segment(struct file_data *fdp, struct plan_data *pdp, double tjd);
+static AS_BOOL segcache_fetch(struct plan_data *pdp, double tjd);
+static void segcache_store(struct plan_data *pdp);
+static void segcache_free(struct plan_data *pdp);
+static void seg_use(struct plan_data *pdp, double *coef, struct shared_seg *sh);
+static void seg_free_all(struct plan_data *pdp);
+static int64 segstore_filekey(const char *fnam);
+static AS_BOOL segstore_fetch(struct plan_data *pdp, int ipli, int ifno, double tjd);
+static void segstore_publish(struct plan_data *pdp, int ipli, int ifno);
+static void segshared_release(struct shared_seg *sh);
+static long swi_atomic_inc(volatile long *p);
 static int main_planet(double tjd, int ipli, int iplmoon, int32 epheflag, int32 iflag,
 		       char *serr);
 static int main_planet_bary(double tjd, int ipli, int32 epheflag, int32 iflag, 
@@ -392,8 +420,7 @@ int32 CALL_CONV swe_calc(double tjd, int ipl, int32 iflag,
 	swed.jpl_file_is_open = FALSE;
       }
       for (i = 0; i < SEI_NEPHFILES; i ++) {
-	if (swed.fidat[i].fptr != NULL) 
-	  fclose(swed.fidat[i].fptr);
+	close_ephe_file(&swed.fidat[i]);
 	memset((void *) &swed.fidat[i], 0, sizeof(struct file_data));
       }
       swed.last_epheflag = epheflag;
@@ -584,7 +611,107 @@ int32 CALL_CONV swe_calc_ut(double tjd_ut, int32 ipl, int32 iflag,
   return retval;
 }
 
-static int32 swecalc(double tjd, int ipl, int32 iplmoon, int32 iflag, double *x, char *serr) 
+/* swe_calc_ut() for every body in body_mask (bit ipl set for body ipl,
+ * ipl < SE_NPLANETS) at one instant, e.g. all bodies of a chart.
+ * Delta t is computed once. The first body computes earth and sun,
+ * nutation, obliquity and the precession matrix for the date; the
+ * others find them in swed and only do their own work.
+ * Body ipl goes to xx[6 * ipl], its return flag to retflag[ipl]
+ * (retflag may be NULL), so both need room for SE_NPLANETS bodies.
+ * Returns the number of failed bodies, or ERR for a bad body_mask;
+ * serr gets the first error.
+ */
+int32 CALL_CONV swe_calc_all_ut(double tjd_ut, int32 body_mask, int32 iflag, 
+	double *xx, int32 *retflag, char *serr)
+{
+  int32 ipl, retval, nfail = 0;
+  int32 epheflag, ifl;
+  double deltat;
+  char serr1[AS_MAXCH];
+  if (serr != NULL)
+    *serr = '\0';
+  if (body_mask == 0 || (body_mask & ~(int32) ((1L << SE_NPLANETS) - 1)) != 0) {
+    if (serr != NULL)
+      sprintf(serr, "swe_calc_all_ut: bad body mask 0x%x", (unsigned int) body_mask);
+    return ERR;
+  }
+  /* the ephemeris as swe_calc_ut() picks it, see swe_calc_ut_batch() */
+  epheflag = plaus_iflag(iflag, SE_SUN, tjd_ut, NULL) & SEFLG_EPHMASK;
+  serr1[0] = '\0';
+  deltat = swe_deltat_ex(tjd_ut, epheflag, serr1);
+  for (ipl = 0; ipl < SE_NPLANETS; ipl++) {
+    if (!(body_mask & ((int32) 1 << ipl)))
+      continue;
+    ifl = plaus_iflag(iflag, ipl, tjd_ut, serr1);
+    retval = swe_calc(tjd_ut + deltat, ipl, ifl, xx + 6 * ipl, serr1);
+    /* if ephe required is not ephe returned, adjust delta t: */
+    if (retval != ERR && (retval & SEFLG_EPHMASK) != epheflag) 
+      retval = swe_calc(tjd_ut + swe_deltat_ex(tjd_ut, retval, NULL), ipl, ifl, xx + 6 * ipl, NULL);
+    if (retval == ERR) {
+      if (nfail++ == 0 && serr != NULL)
+	strcpy(serr, serr1);
+    }
+    if (retflag != NULL)
+      retflag[ipl] = retval;
+  }
+  return nfail;
+}
+
+/* swe_calc_ut() for nipl bodies at each of njd times.
+ * The loop runs time-major: delta t is computed once per time, and
+ * everything swe_calc() keeps per tjd in swed (earth and sun, nutation,
+ * obliquity, observer) is shared by all bodies at that time. Each body
+ * keeps its own segment, so ascending times read every segment once.
+ * Nutation is interpolated if swe_set_interpolate_nut() is on; that pays
+ * off with steps well below one day.
+ * Results are body-major: body k at time i is xx[6 * (k * njd + i)], its
+ * return flag retflag[k * njd + i] (retflag may be NULL).
+ * Returns the number of failed results; serr gets the first error.
+ */
+int32 CALL_CONV swe_calc_ut_batch(double *tjd_ut, int32 njd, int32 *ipl, int32 nipl, 
+	int32 iflag, double *xx, int32 *retflag, char *serr)
+{
+  int32 i, k, retval, nfail = 0;
+  int32 epheflag, ifl;
+  double deltat, *xp;
+  char serr1[AS_MAXCH];
+  if (serr != NULL)
+    *serr = '\0';
+  /* the ephemeris as swe_calc_ut() picks it, after plaus_iflag(). that
+   * choice does not depend on the body, and delta t depends on nothing
+   * else, so it holds for every body; each body's flags are still
+   * normalized below */
+  epheflag = plaus_iflag(iflag, SE_SUN, njd > 0 ? tjd_ut[0] : 0, NULL) & SEFLG_EPHMASK;
+  for (i = 0; i < njd; i++) {
+    serr1[0] = '\0';
+    deltat = swe_deltat_ex(tjd_ut[i], epheflag, serr1);
+    for (k = 0; k < nipl; k++) {
+      xp = xx + 6 * ((size_t) k * njd + i);
+      ifl = plaus_iflag(iflag, ipl[k], tjd_ut[i], serr1);
+      retval = swe_calc(tjd_ut[i] + deltat, ipl[k], ifl, xp, serr1);
+      /* if ephe required is not ephe returned, adjust delta t: */
+      if (retval != ERR && (retval & SEFLG_EPHMASK) != epheflag) 
+	retval = swe_calc(tjd_ut[i] + swe_deltat_ex(tjd_ut[i], retval, NULL), ipl[k], ifl, xp, NULL);
+      if (retval == ERR) {
+	if (nfail++ == 0 && serr != NULL)
+	  strcpy(serr, serr1);
+      }
+      if (retflag != NULL)
+	retflag[(size_t) k * njd + i] = retval;
+    }
+  }
+  return nfail;
+}
+
+#ifdef SWE_INSTRUMENT
+static int swi_instr_body(int ipl);
+static int32 swecalc_body(double tjd, int ipl, int32 iplmoon, int32 iflag, double *x, char *serr);
+static int32 swecalc(double tjd, int ipl, int32 iplmoon, int32 iflag, double *x, char *serr)
+  SWI_INSTR_RETURN(swecalc[swi_instr_body(ipl)], int32, swecalc_body(tjd, ipl, iplmoon, iflag, x, serr))
+static int32 swecalc_body(double tjd, int ipl, int32 iplmoon, int32 iflag, double *x, char *serr)
+#else
+static int32 swecalc(double tjd, int ipl, int32 iplmoon, int32 iflag, double *x, char *serr)
+#endif
 {
   int i;
   int ipli, ipli_ast, ifno;
@@ -1160,9 +1287,7 @@ static void free_planets(void)
   int i;
   /* free planets data space */
   for (i = 0; i < SEI_NPLANETS; i++) {
-    if (swed.pldat[i].segp != NULL) {
-      free((void *) swed.pldat[i].segp);
-    }
+    seg_free_all(&swed.pldat[i]);
     if (swed.pldat[i].refep != NULL) {
       free((void *) swed.pldat[i].refep);
     }
@@ -1200,8 +1325,7 @@ static void swi_close_keep_topo_etc(void)
   int i;
   /* close SWISSEPH files */
   for (i = 0; i < SEI_NEPHFILES; i ++) {
-    if (swed.fidat[i].fptr != NULL) 
-      fclose(swed.fidat[i].fptr);
+    close_ephe_file(&swed.fidat[i]);
     memset((void *) &swed.fidat[i], 0, sizeof(struct file_data));
   }
   free_planets();
@@ -1235,8 +1359,7 @@ void CALL_CONV swe_close(void)
   int i;
   /* close SWISSEPH files */
   for (i = 0; i < SEI_NEPHFILES; i ++) {
-    if (swed.fidat[i].fptr != NULL) 
-      fclose(swed.fidat[i].fptr);
+    close_ephe_file(&swed.fidat[i]);
     memset((void *) &swed.fidat[i], 0, sizeof(struct file_data));
   }
   free_planets();
@@ -2165,14 +2288,11 @@ static int sweph(double tjd, int ipli, int ifno, int32 iflag, double *xsunb, AS_
      * if new asteroid, close old file. */
     if (tjd < fdp->tfstart || tjd > fdp->tfend
       || (ipl == SEI_ANYBODY && ipli != pdp->ibdy)) { 	
-      fclose(fdp->fptr);
-      fdp->fptr = NULL;
+      close_ephe_file(fdp);
       if (pdp->refep != NULL) 
 	free((void *) pdp->refep);
       pdp->refep = NULL;
-      if (pdp->segp != NULL)
-	free((void *) pdp->segp);
-      pdp->segp = NULL;
+      seg_free_all(pdp);
     }
   }
   /* if sweph file not open, find and open it */
@@ -2227,6 +2347,9 @@ again:
     retc = read_const(ifno, serr);
     if (retc != OK)
       return(retc);
+    map_ephe_file(fdp);
+    open_flat_file(fdp);
+    fdp->fkey = segstore_filekey(fdp->fnam);
   }
   /* if first ephemeris file (J-3000), it might start a mars period
    * after -3000. if last ephemeris file (J3000), it might end a
@@ -2269,17 +2392,25 @@ again:
    * get planet's position      
    ******************************/
   /* get new segment, if necessary */
-  if (pdp->segp == NULL || tjd < pdp->tseg0 || tjd > pdp->tseg1) {
-    retc = get_new_segment(tjd, ipl, ifno, serr);
-    if (retc != OK)
-      return(retc);
-    /* rotate cheby coeffs back to equatorial system.
-     * if necessary, add reference orbit. */
-    if (pdp->iflg & SEI_FLG_ROTATE) {
-      rot_back(ipl); /**/
-    } else {
-      pdp->neval = pdp->ncoe;
+  if ((pdp->segc == NULL || tjd < pdp->tseg0 || tjd > pdp->tseg1)
+      && !(fdp->flat != NULL && flat_segment(fdp, pdp, tjd))
+      && !segcache_fetch(pdp, tjd)) {
+    if (!segstore_fetch(pdp, ipli, ifno, tjd)) {
+      seg_use(pdp, NULL, NULL);	/* get_new_segment() may free segp */
+      retc = get_new_segment(tjd, ipl, ifno, serr);
+      if (retc != OK)
+	return(retc);
+      /* rotate cheby coeffs back to equatorial system.
+       * if necessary, add reference orbit. */
+      if (pdp->iflg & SEI_FLG_ROTATE) {
+	rot_back(ipl); /**/
+      } else {
+	pdp->neval = pdp->ncoe;
+      }
+      seg_use(pdp, pdp->segp, NULL);
+      segstore_publish(pdp, ipli, ifno);
     }
+    segcache_store(pdp);
   }
   /* evaluate chebyshew polynomial for tjd */
   t = (tjd - pdp->tseg0) / pdp->dseg;
@@ -2291,10 +2422,10 @@ again:
    * 2. the speed flag has been specified.
    */
   need_speed = (do_save || (iflag & SEFLG_SPEED));
+  swi_echeb3(t, pdp->segc, pdp->ncoe, pdp->neval, xp, need_speed ? xp + 3 : NULL);
   for (i = 0; i <= 2; i++) {
-    xp[i]  = swi_echeb (t, pdp->segp+(i*pdp->ncoe), pdp->neval);
     if (need_speed) {
-      xp[i+3] = swi_edcheb(t, pdp->segp+(i*pdp->ncoe), pdp->neval) / pdp->dseg * 2;
+      xp[i+3] = xp[i+3] / pdp->dseg * 2;
     } else {
       xp[i+3] = 0;	/* von Alois als billiger fix, evtl. illegal */
     }
@@ -2461,7 +2592,14 @@ static int calc_center_body(int32 ipli, int32 iflag, double *xx, double *xcom, c
  * iflag	flags
  * serr         error string
  */
+#ifdef SWE_INSTRUMENT
+static int app_pos_etc_plan_body(int ipli, int iplmoon, int32 iflag, char *serr);
+static int app_pos_etc_plan(int ipli, int iplmoon, int32 iflag, char *serr)
+  SWI_INSTR_RETURN(app_pos[SE_INSTR_APP_PLAN], int, app_pos_etc_plan_body(ipli, iplmoon, iflag, serr))
+static int app_pos_etc_plan_body(int ipli, int iplmoon, int32 iflag, char *serr)
+#else
 static int app_pos_etc_plan(int ipli, int iplmoon, int32 iflag, char *serr)
+#endif
 {
   int i, j, niter, retc = OK;
   int ipl, ifno, ibody;
@@ -3361,7 +3499,14 @@ int swi_trop_ra2sid_lon_sosy(double *xin, double *xout, int32 iflag)
  * ipli		planet number
  * iflag	flags
  */
+#ifdef SWE_INSTRUMENT
+static int app_pos_etc_plan_osc_body(int ipl, int ipli, int32 iflag, char *serr);
 static int app_pos_etc_plan_osc(int ipl, int ipli, int32 iflag, char *serr)
+  SWI_INSTR_RETURN(app_pos[SE_INSTR_APP_PLAN_OSC], int, app_pos_etc_plan_osc_body(ipl, ipli, iflag, serr))
+static int app_pos_etc_plan_osc_body(int ipl, int ipli, int32 iflag, char *serr)
+#else
+static int app_pos_etc_plan_osc(int ipl, int ipli, int32 iflag, char *serr)
+#endif
 {
   int i, j, niter, retc;
   double xx[6], dx[3], dt, dtsave_for_defl;
@@ -3898,7 +4043,14 @@ void swi_deflect_light(double *xx, double dt, int32 iflag)
  * iflag	flags
  * serr         error string
  */
+#ifdef SWE_INSTRUMENT
+static int app_pos_etc_sun_body(int32 iflag, char *serr);
+static int app_pos_etc_sun(int32 iflag, char *serr)
+  SWI_INSTR_RETURN(app_pos[SE_INSTR_APP_SUN], int, app_pos_etc_sun_body(iflag, serr))
+static int app_pos_etc_sun_body(int32 iflag, char *serr)
+#else
 static int app_pos_etc_sun(int32 iflag, char *serr)
+#endif
 {
   int i, j, niter, retc = OK;
   int32 flg1, flg2;
@@ -4083,7 +4235,14 @@ static int app_pos_etc_sun(int32 iflag, char *serr)
  * consider the motions of the earth and the moon 
  * related to the solar system barycenter.
  */
+#ifdef SWE_INSTRUMENT
+static int app_pos_etc_moon_body(int32 iflag, char *serr);
+static int app_pos_etc_moon(int32 iflag, char *serr)
+  SWI_INSTR_RETURN(app_pos[SE_INSTR_APP_MOON], int, app_pos_etc_moon_body(iflag, serr))
+static int app_pos_etc_moon_body(int32 iflag, char *serr)
+#else
 static int app_pos_etc_moon(int32 iflag, char *serr)
+#endif
 {
   int i;
   int32 flg1, flg2;
@@ -4250,7 +4409,14 @@ static int app_pos_etc_moon(int32 iflag, char *serr)
  * iflag	flags
  * serr         error string
  */
+#ifdef SWE_INSTRUMENT
+static int app_pos_etc_sbar_body(int32 iflag, char *serr);
+static int app_pos_etc_sbar(int32 iflag, char *serr)
+  SWI_INSTR_RETURN(app_pos[SE_INSTR_APP_SBAR], int, app_pos_etc_sbar_body(iflag, serr))
+static int app_pos_etc_sbar_body(int32 iflag, char *serr)
+#else
 static int app_pos_etc_sbar(int32 iflag, char *serr)
+#endif
 {
   int i;
   double xx[6], xxsv[6], dt;
@@ -4306,7 +4472,14 @@ static int app_pos_etc_sbar(int32 iflag, char *serr)
  * iflag	flags
  * serr         error string
  */
-static int app_pos_etc_mean(int ipl, int32 iflag, char *serr) 
+#ifdef SWE_INSTRUMENT
+static int app_pos_etc_mean_body(int ipl, int32 iflag, char *serr);
+static int app_pos_etc_mean(int ipl, int32 iflag, char *serr)
+  SWI_INSTR_RETURN(app_pos[SE_INSTR_APP_MEAN], int, app_pos_etc_mean_body(ipl, iflag, serr))
+static int app_pos_etc_mean_body(int ipl, int32 iflag, char *serr)
+#else
+static int app_pos_etc_mean(int ipl, int32 iflag, char *serr)
+#endif
 {
   int i;
   int32 flg1, flg2;
@@ -4363,7 +4536,14 @@ static int app_pos_etc_mean(int ipl, int32 iflag, char *serr)
  * ifno		file number
  * serr		error string
  */
-static int get_new_segment(double tjd, int ipli, int ifno, char *serr) 
+#ifdef SWE_INSTRUMENT
+static int get_new_segment_body(double tjd, int ipli, int ifno, char *serr);
+static int get_new_segment(double tjd, int ipli, int ifno, char *serr)
+  SWI_INSTR_RETURN(segment, int, get_new_segment_body(tjd, ipli, ifno, serr))
+static int get_new_segment_body(double tjd, int ipli, int ifno, char *serr)
+#else
+static int get_new_segment(double tjd, int ipli, int ifno, char *serr)
+#endif
 {
   int i, j, k, m, n, o, icoord, retc;
   int32 iseg;
@@ -4378,6 +4558,8 @@ static int get_new_segment(double tjd, int ipli, int ifno, char *serr)
   int freord  = (int) fdp->iflg & SEI_FILE_REORD;
   int fendian = (int) fdp->iflg & SEI_FILE_LITENDIAN;
   uint32 longs[MAXORD+1];
+  if (fdp->mbase != NULL)
+    return get_new_segment_mapped(tjd, ipli, ifno, serr);
   /* compute segment number */
   iseg = (int32) ((tjd - pdp->tfstart) / pdp->dseg);
   /*if (tjd - pdp->tfstart < 0)
@@ -4492,15 +4674,1052 @@ static int get_new_segment(double tjd, int ipli, int ifno, char *serr)
       }
     }
   }
+  SWI_INSTR_COUNT(segment_bytes, ftell(fp) - fpos + 3);	/* index entry + coefficients */
   return(OK);
 return_error_gns:
-  fclose(fdp->fptr);
-  // free(fdp->fptr);  is not from malloc(), must not be freed by us
+  close_ephe_file(fdp);
+  free_planets();
+  return ERR;
+}
+
+/* unsigned integer of 1..4 bytes, big/little endian on file */
+static uint32 mm_uint_be(const unsigned char *p, int size)
+{
+  uint32 v = 0;
+  int i;
+  for (i = 0; i < size; i++)
+    v = (v << 8) | p[i];
+  return v;
+}
+
+static uint32 mm_uint_le(const unsigned char *p, int size)
+{
+  uint32 v = 0;
+  int i;
+  for (i = size - 1; i >= 0; i--)
+    v = (v << 8) | p[i];
+  return v;
+}
+
+/* fetch chebyshew coefficients for tjd straight from the memory-mapped
+ * sweph file (fdp->mbase); same decoding as get_new_segment(), but
+ * without stdio. The byte order of the file is resolved once per call.
+ */
+static int get_new_segment_mapped(double tjd, int ipli, int ifno, char *serr)
+{
+  int i, j, m, n, o, icoord;
+  int32 iseg;
+  uint32 fpos, l;
+  int nsizes, nsize[6];
+  int nco;
+  int idbl;
+  struct plan_data *pdp = &swed.pldat[ipli];
+  struct file_data *fdp = &swed.fidat[ifno];
+  const unsigned char *base = fdp->mbase;
+  const unsigned char *p;
+  size_t len = fdp->mlen;
+  uint32 (*get_uint)(const unsigned char *, int) =
+      (fdp->iflg & SEI_FILE_LITENDIAN) ? mm_uint_le : mm_uint_be;
+  /* compute segment number */
+  iseg = (int32) ((tjd - pdp->tfstart) / pdp->dseg);
+  pdp->tseg0 = pdp->tfstart + iseg * pdp->dseg;
+  pdp->tseg1 = pdp->tseg0 + pdp->dseg;
+  /* file position of coefficients, from the segment index */
+  if (iseg < 0 || pdp->lndx0 < 0 || (size_t) pdp->lndx0 + (size_t) iseg * 3 + 3 > len)
+    goto return_error_gnsm;
+  fpos = get_uint(base + pdp->lndx0 + (size_t) iseg * 3, 3);
+  if ((size_t) fpos >= len)
+    goto return_error_gnsm;
+  p = base + fpos;
+  /* clear space of chebyshew coefficients */
+  if (pdp->segp == NULL)
+    pdp->segp = (double *) malloc((size_t) pdp->ncoe * 3 * 8);
+  memset((void *) pdp->segp, 0, (size_t) pdp->ncoe * 3 * 8);
+  /* coefficients for 3 coordinates */
+  for (icoord = 0; icoord < 3; icoord++) {
+    idbl = icoord * pdp->ncoe;
+    /* header: first bit indicates number of sizes of packed coefficients */
+    if ((size_t) (p - base) + 2 > len)
+      goto return_error_gnsm;
+    if (p[0] & 128) {
+      if ((size_t) (p - base) + 4 > len)
+	goto return_error_gnsm;
+      nsizes = 6;
+      nsize[0] = (int) p[1] / 16;
+      nsize[1] = (int) p[1] % 16;
+      nsize[2] = (int) p[2] / 16;
+      nsize[3] = (int) p[2] % 16;
+      nsize[4] = (int) p[3] / 16;
+      nsize[5] = (int) p[3] % 16;
+      nco = nsize[0] + nsize[1] + nsize[2] + nsize[3] + nsize[4] + nsize[5];
+      p += 4;
+    } else {
+      nsizes = 4;
+      nsize[0] = (int) p[0] / 16;
+      nsize[1] = (int) p[0] % 16;
+      nsize[2] = (int) p[1] / 16;
+      nsize[3] = (int) p[1] % 16;
+      nco = nsize[0] + nsize[1] + nsize[2] + nsize[3];
+      p += 2;
+    }
+    /* there may not be more coefficients than interpolation
+     * order + 1 */
+    if (nco > pdp->ncoe) {
+      if (serr != NULL) {
+	sprintf(serr, "error in ephemeris file: %d coefficients instead of %d. ", nco, pdp->ncoe);
+	if (strlen(serr) + strlen(fdp->fnam) < AS_MAXCH - 1) {
+	  sprintf(serr, "error in ephemeris file %s: %d coefficients instead of %d. ", fdp->fnam, nco, pdp->ncoe);
+	}
+      }
+      free(pdp->segp);
+      pdp->segp = NULL;
+      return (ERR);
+    }
+    /* now unpack */
+    for (i = 0; i < nsizes; i++) {
+      if (nsize[i] == 0)
+	continue;
+      if (i < 4) {
+	j = (4 - i);
+	if ((size_t) (p - base) + (size_t) j * nsize[i] > len)
+	  goto return_error_gnsm;
+	for (m = 0; m < nsize[i]; m++, idbl++, p += j) {
+	  l = get_uint(p, j);
+	  if (l & 1) 	/* will be negative */
+	    pdp->segp[idbl] = -(((l+1) / 2) / 1e+9 * pdp->rmax / 2);
+	  else
+	    pdp->segp[idbl] = (l / 2) / 1e+9 * pdp->rmax / 2;
+	}
+      } else {
+	/* i == 4: half byte packing, i == 5: quarter byte packing */
+	int per_byte = (i == 4) ? 2 : 4;
+	int o0 = (i == 4) ? 16 : 64;
+	int odiv = (i == 4) ? 16 : 4;
+	int k = (nsize[i] + per_byte - 1) / per_byte;
+	if ((size_t) (p - base) + (size_t) k > len)
+	  goto return_error_gnsm;
+	for (m = 0, j = 0; m < k && j < nsize[i]; m++) {
+	  l = p[m];
+	  for (n = 0, o = o0; 
+	       n < per_byte && j < nsize[i]; 
+	       n++, j++, idbl++, l %= o, o /= odiv) {
+	    if (l & o) 
+	      pdp->segp[idbl] = -(((l+o) / o / 2) * pdp->rmax / 2 / 1e+9);
+	    else
+	      pdp->segp[idbl] = (l / o / 2) * pdp->rmax / 2 / 1e+9;
+	  } 
+	}
+	p += k;
+      }
+    }
+  }
+  SWI_INSTR_COUNT(segment_bytes, (p - (base + fpos)) + 3);
+  return(OK);
+return_error_gnsm:
+  if (serr != NULL) {
+    strcpy(serr, "Ephemeris file is damaged (5). ");
+    if (strlen(serr) + strlen(fdp->fnam) < AS_MAXCH - 1) {
+      sprintf(serr, "Ephemeris file %s is damaged (5).", fdp->fnam);
+    }
+  }
+  close_ephe_file(fdp);
+  free_planets();
+  return ERR;
+}
+
+/* process-wide file backend switches: mappings are read-only and the
+ * page cache is shared, so one switch serves every thread's swed. worker
+ * threads read them whenever they open a file, so they are accessed
+ * atomically; a change applies to files opened afterwards, files that are
+ * already open keep their backend */
+static volatile long ephe_use_mmap = FALSE;
+static volatile long ephe_use_flat = TRUE;
+
+#ifdef _MSC_VER
+static AS_BOOL ephe_switch_get(volatile long *p) { return (AS_BOOL) _InterlockedCompareExchange(p, 0, 0); }
+static void ephe_switch_set(volatile long *p, AS_BOOL on) { _InterlockedExchange(p, on ? 1 : 0); }
+#else
+static AS_BOOL ephe_switch_get(volatile long *p) { return (AS_BOOL) __atomic_load_n(p, __ATOMIC_RELAXED); }
+static void ephe_switch_set(volatile long *p, AS_BOOL on) { __atomic_store_n(p, on ? 1 : 0, __ATOMIC_RELAXED); }
+#endif
+
+void CALL_CONV swe_set_ephe_mmap(AS_BOOL do_mmap)
+{
+#ifdef SWE_NO_MMAP
+  ephe_switch_set(&ephe_use_mmap, FALSE);
+#else
+  ephe_switch_set(&ephe_use_mmap, do_mmap);
+#endif
+}
+
+/* maps an sweph file that has just passed read_const();
+ * on any failure the file simply stays on the stdio path */
+static void map_ephe_file(struct file_data *fdp)
+{
+#ifndef SWE_NO_MMAP
+  long flen;
+  if (!ephe_switch_get(&ephe_use_mmap) || fdp->fptr == NULL || fdp->mbase != NULL)
+    return;
+  if (fseek(fdp->fptr, 0L, SEEK_END) != 0 || (flen = ftell(fdp->fptr)) <= 0)
+    return;
+#ifdef _WIN32
+  {
+    HANDLE hfile = (HANDLE) _get_osfhandle(_fileno(fdp->fptr));
+    HANDLE hmap = CreateFileMappingA(hfile, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (hmap == NULL)
+      return;
+    fdp->mbase = (unsigned char *) MapViewOfFile(hmap, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(hmap);	/* the view keeps the mapping alive */
+  }
+#else
+  {
+    void *addr = mmap(NULL, (size_t) flen, PROT_READ, MAP_SHARED, fileno(fdp->fptr), 0);
+    if (addr == MAP_FAILED)
+      return;
+    fdp->mbase = (unsigned char *) addr;
+  }
+#endif
+  if (fdp->mbase != NULL)
+    fdp->mlen = (size_t) flen;
+#endif
+}
+
+/* closes an sweph file and drops its mapping, if any */
+static void close_ephe_file(struct file_data *fdp)
+{
+  int i;
+  struct plan_data *pdp;
+  /* cached segments of every body in the file go with it: the next file
+   * of a body has its own segments (and ncoe) for the same dates. the
+   * current segment may point into the cache, so it is dropped first */
+  if (fdp->fptr != NULL) {
+    for (i = 0; i < fdp->npl; i++) {
+      pdp = flat_plan(fdp->ipl[i]);
+      seg_use(pdp, NULL, NULL);
+      pdp->tseg0 = pdp->tseg1 = 0;
+      segcache_free(pdp);
+    }
+  }
+  close_flat_file(fdp);
+#ifndef SWE_NO_MMAP
+  if (fdp->mbase != NULL) {
+#ifdef _WIN32
+    UnmapViewOfFile(fdp->mbase);
+#else
+    munmap(fdp->mbase, fdp->mlen);
+#endif
+  }
+#endif
+  fdp->mbase = NULL;
+  fdp->mlen = 0;
+  if (fdp->fptr != NULL)
+    fclose(fdp->fptr);
   fdp->fptr = NULL;
+}
+
+/* flat ephemeris files
+ * ---------------------
+ * xxx.sef holds, for every body of xxx.se1, the coefficients of every
+ * segment exactly as sweph() evaluates them: unpacked and, with
+ * SEI_FLG_ROTATE, after rot_back(). All numbers are little-endian;
+ * offsets count from the start of the file:
+ *   struct flat_header
+ *   nbody x struct flat_body
+ *   per body: nseg segments of stride doubles at coef_off (x, y and z
+ *             coefficients one after the other, as in pdp->segp), then
+ *             nseg int32 neval at neval_off
+ * Segments start on SEI_FLAT_ALIGN boundaries. A segment switch only
+ * repoints pdp->segc into the image.
+ */
+#define SEI_FLAT_MAGIC	"SWEFLAT"
+#define SEI_FLAT_VERSION	1
+#define SEI_FLAT_ENDIAN	0x01020304
+#define SEI_FLAT_ALIGN	64
+#define SEI_FLAT_SUFFIX	"sef"
+
+struct flat_header {
+  char magic[8];
+  uint32 endian;	/* SEI_FLAT_ENDIAN, as written by the host */
+  uint32 version;
+  int64 srcsize;	/* size of the sweph file it was made from */
+  int32 nbody;
+  int32 unused;
+  double tfstart, tfend;
+  char pad[16];
+};
+
+struct flat_body {
+  int32 ibdy;		/* body number as in file_data.ipl */
+  int32 ncoe;
+  int32 nseg;
+  int32 stride;		/* doubles per segment, >= 3 * ncoe */
+  double tfstart;
+  double dseg;
+  int64 coef_off;
+  int64 neval_off;
+  char pad[16];
+};
+
+void CALL_CONV swe_set_ephe_flat(AS_BOOL use_flat)
+{
+  ephe_switch_set(&ephe_use_flat, use_flat);
+}
+
+/* xxx.se1 -> xxx.sef */
+static void flat_file_name(const char *fnam, char *out)
+{
+  char *sp, *dot;
+  strcpy(out, fnam);
+  sp = strrchr(out, (int) *DIR_GLUE);
+  dot = strrchr(sp != NULL ? sp : out, '.');
+  if (dot == NULL)
+    dot = out + strlen(out);
+  strcpy(dot, "." SEI_FLAT_SUFFIX);
+}
+
+static int64 flat_file_size(FILE *fp)
+{
+  long pos = ftell(fp), len;
+  if (fseek(fp, 0L, SEEK_END) != 0)
+    return -1;
+  len = ftell(fp);
+  fseek(fp, pos, SEEK_SET);
+  return (int64) len;
+}
+
+/* the struct plan_data read_const() fills for body ibdy of a file */
+static struct plan_data *flat_plan(int ibdy)
+{
+  if (ibdy >= SE_PLMOON_OFFSET)
+    return &swed.pldat[SEI_ANYBODY];
+  return &swed.pldat[ibdy];
+}
+
+/* maps xxx.sef next to an sweph file that has just passed read_const(),
+ * if there is one and it was made from this very file */
+static void open_flat_file(struct file_data *fdp)
+{
+  char fnam[AS_MAXCH + 8];
+  FILE *fp;
+  int64 flen, srclen;
+  int i;
+  const struct flat_header *h;
+  const struct flat_body *b;
+  const union { uint32 u; unsigned char c[4]; } host = { SEI_FLAT_ENDIAN };
+  if (!ephe_switch_get(&ephe_use_flat) || fdp->fptr == NULL || fdp->flat != NULL || host.c[0] != 0x04)
+    return;
+  if (strlen(fdp->fnam) + 4 >= AS_MAXCH)
+    return;
+  flat_file_name(fdp->fnam, fnam);
+  if ((fp = fopen(fnam, BFILE_R_ACCESS)) == NULL)
+    return;
+  flen = flat_file_size(fp);
+  srclen = flat_file_size(fdp->fptr);
+  if (flen < (int64) sizeof(struct flat_header) || (int64) (size_t) flen != flen) {
+    fclose(fp);
+    return;
+  }
+#ifndef SWE_NO_MMAP
+#ifdef _WIN32
+  {
+    HANDLE hfile = (HANDLE) _get_osfhandle(_fileno(fp));
+    HANDLE hmap = CreateFileMappingA(hfile, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (hmap != NULL) {
+      fdp->flat = (const unsigned char *) MapViewOfFile(hmap, FILE_MAP_READ, 0, 0, 0);
+      CloseHandle(hmap);
+    }
+  }
+#else
+  {
+    void *addr = mmap(NULL, (size_t) flen, PROT_READ, MAP_SHARED, fileno(fp), 0);
+    if (addr != MAP_FAILED)
+      fdp->flat = (const unsigned char *) addr;
+  }
+#endif
+#endif
+  if (fdp->flat == NULL) {	/* no mappings: read it */
+    unsigned char *buf = (unsigned char *) malloc((size_t) flen);
+    if (buf != NULL && fseek(fp, 0L, SEEK_SET) == 0
+        && fread((void *) buf, 1, (size_t) flen, fp) == (size_t) flen) {
+      fdp->flat = buf;
+      fdp->flatheap = TRUE;
+    } else if (buf != NULL) {
+      free((void *) buf);
+    }
+  }
+  fclose(fp);
+  if (fdp->flat == NULL)
+    return;
+  fdp->flatlen = (size_t) flen;
+  /* check it against the constants read_const() just read */
+  h = (const struct flat_header *) fdp->flat;
+  if (memcmp(h->magic, SEI_FLAT_MAGIC, 8) != 0 || h->endian != SEI_FLAT_ENDIAN
+      || h->version != SEI_FLAT_VERSION || h->srcsize != srclen
+      || h->nbody != fdp->npl || h->tfstart != fdp->tfstart || h->tfend != fdp->tfend
+      || flen < (int64) (sizeof(struct flat_header) + h->nbody * sizeof(struct flat_body)))
+    goto stale;
+  b = (const struct flat_body *) (h + 1);
+  for (i = 0; i < h->nbody; i++, b++) {
+    struct plan_data *pdp = flat_plan(b->ibdy);
+    if (b->ibdy != fdp->ipl[i] || b->ncoe != pdp->ncoe || b->tfstart != pdp->tfstart
+        || b->dseg != pdp->dseg || b->nseg < 0 || b->stride < 3 * b->ncoe
+        || b->coef_off % SEI_FLAT_ALIGN != 0 || b->neval_off % 4 != 0
+        || b->coef_off < 0 || b->coef_off + (int64) b->nseg * b->stride * 8 > flen
+        || b->neval_off < 0 || b->neval_off + (int64) b->nseg * 4 > flen)
+      goto stale;
+  }
+  return;
+stale:
+  close_flat_file(fdp);
+}
+
+static void close_flat_file(struct file_data *fdp)
+{
+  int i;
+  if (fdp->flat == NULL)
+    return;
+  /* no body may keep evaluating the image */
+  for (i = 0; i < SEI_NPLANETS; i++) {
+    const unsigned char *c = (const unsigned char *) swed.pldat[i].segc;
+    if (c >= fdp->flat && c < fdp->flat + fdp->flatlen)
+      seg_use(&swed.pldat[i], NULL, NULL);
+  }
+  if (fdp->flatheap) {
+    free((void *) fdp->flat);
+  } else {
+#ifndef SWE_NO_MMAP
+#ifdef _WIN32
+    UnmapViewOfFile((LPCVOID) fdp->flat);
+#else
+    munmap((void *) fdp->flat, fdp->flatlen);
+#endif
+#endif
+  }
+  fdp->flat = NULL;
+  fdp->flatlen = 0;
+  fdp->flatheap = FALSE;
+}
+
+/* makes the segment containing tjd the current one, straight from the
+ * .sef image. FALSE if the image does not have it. */
+static AS_BOOL flat_segment(struct file_data *fdp, struct plan_data *pdp, double tjd)
+{
+  const struct flat_header *h = (const struct flat_header *) fdp->flat;
+  const struct flat_body *b = (const struct flat_body *) (h + 1);
+  int32 i, iseg;
+  for (i = 0; i < h->nbody && b->ibdy != pdp->ibdy; i++)
+    b++;
+  if (i == h->nbody)
+    return FALSE;
+  iseg = (int32) ((tjd - pdp->tfstart) / pdp->dseg);
+  if (iseg < 0 || iseg >= b->nseg)
+    return FALSE;
+  seg_use(pdp, (double *) (fdp->flat + b->coef_off + (int64) iseg * b->stride * 8), NULL);
+  pdp->tseg0 = pdp->tfstart + iseg * pdp->dseg;
+  pdp->tseg1 = pdp->tseg0 + pdp->dseg;
+  pdp->neval = ((const int32 *) (fdp->flat + b->neval_off))[iseg];
+  return TRUE;
+}
+
+/* writes n zero bytes */
+static AS_BOOL flat_pad(FILE *fp, int64 n)
+{
+  static const char zero[SEI_FLAT_ALIGN];
+  for (; n > 0; n -= SEI_FLAT_ALIGN)
+    if (fwrite(zero, 1, (size_t) (n < SEI_FLAT_ALIGN ? n : SEI_FLAT_ALIGN), fp) == 0)
+      return FALSE;
+  return TRUE;
+}
+
+int32 CALL_CONV swe_repack_ephe_file(const char *fname, const char *outname, char *serr)
+{
+  char fout[AS_MAXCH + 8];
+  const char *sp;
+  int ifno, k;
+  int32 iseg, *neval = NULL;
+  int64 off, srclen;
+  FILE *fp = NULL;
+  struct file_data *fdp;
+  struct flat_header h;
+  struct flat_body b[SEI_FILE_NMAXPLAN];
+  const union { uint32 u; unsigned char c[4]; } host = { SEI_FLAT_ENDIAN };
+  if (serr != NULL)
+    *serr = '\0';
+  if (host.c[0] != 0x04) {
+    if (serr != NULL)
+      strcpy(serr, "flat ephemeris files need a little-endian host");
+    return ERR;
+  }
+  if (strlen(fname) + 4 >= AS_MAXCH || (outname != NULL && strlen(outname) >= AS_MAXCH)) {
+    if (serr != NULL)
+      strcpy(serr, "file name too long");
+    return ERR;
+  }
+  /* the slot sweph() would open the file in */
+  sp = strrchr(fname, (int) *DIR_GLUE);
+  sp = sp != NULL ? sp + 1 : fname;
+  if (strncmp(sp, "sepl", 4) == 0)
+    ifno = SEI_FILE_PLANET;
+  else if (strncmp(sp, "semo", 4) == 0)
+    ifno = SEI_FILE_MOON;
+  else if (strncmp(sp, "seas", 4) == 0)
+    ifno = SEI_FILE_MAIN_AST;
+  else
+    ifno = SEI_FILE_ANY_AST;
+  fdp = &swed.fidat[ifno];
+  close_ephe_file(fdp);
+  free_planets();
+  strcpy(fdp->fnam, fname);
+  if ((fdp->fptr = fopen(fname, BFILE_R_ACCESS)) == NULL) {
+    if (serr != NULL)
+      sprintf(serr, "cannot open %s", fname);
+    return ERR;
+  }
+  if (read_const(ifno, serr) != OK)
+    return ERR;
+  srclen = flat_file_size(fdp->fptr);
+  /* layout */
+  memset((void *) &h, 0, sizeof(h));
+  memcpy(h.magic, SEI_FLAT_MAGIC, 8);
+  h.endian = SEI_FLAT_ENDIAN;
+  h.version = SEI_FLAT_VERSION;
+  h.srcsize = srclen;
+  h.nbody = fdp->npl;
+  h.tfstart = fdp->tfstart;
+  h.tfend = fdp->tfend;
+  memset((void *) b, 0, sizeof(b));
+  off = (int64) (sizeof(h) + fdp->npl * sizeof(struct flat_body));
+  for (k = 0; k < fdp->npl; k++) {
+    struct plan_data *pdp = flat_plan(fdp->ipl[k]);
+    b[k].ibdy = fdp->ipl[k];
+    b[k].ncoe = pdp->ncoe;
+    b[k].nseg = pdp->nndx;
+    b[k].stride = ((3 * pdp->ncoe * 8 + SEI_FLAT_ALIGN - 1) / SEI_FLAT_ALIGN) * SEI_FLAT_ALIGN / 8;
+    b[k].tfstart = pdp->tfstart;
+    b[k].dseg = pdp->dseg;
+    off = (off + SEI_FLAT_ALIGN - 1) / SEI_FLAT_ALIGN * SEI_FLAT_ALIGN;
+    b[k].coef_off = off;
+    off += (int64) b[k].nseg * b[k].stride * 8;
+    b[k].neval_off = off;
+    off += (int64) b[k].nseg * 4;
+  }
+  if (outname != NULL)
+    strcpy(fout, outname);
+  else
+    flat_file_name(fname, fout);
+  if ((fp = fopen(fout, BFILE_W_CREATE)) == NULL) {
+    if (serr != NULL)
+      sprintf(serr, "cannot create %s", fout);
+    goto return_error;
+  }
+  if (fwrite((void *) &h, sizeof(h), 1, fp) != 1
+      || fwrite((void *) b, sizeof(struct flat_body), (size_t) fdp->npl, fp) != (size_t) fdp->npl)
+    goto write_error;
+  off = (int64) (sizeof(h) + fdp->npl * sizeof(struct flat_body));
+  /* segments, in the order sweph() would decode them */
+  for (k = 0; k < fdp->npl; k++) {
+    int ipl = (int) (flat_plan(b[k].ibdy) - swed.pldat);
+    struct plan_data *pdp = &swed.pldat[ipl];
+    if (!flat_pad(fp, b[k].coef_off - off))
+      goto write_error;
+    off = b[k].coef_off;
+    neval = (int32 *) realloc((void *) neval, (size_t) (b[k].nseg > 0 ? b[k].nseg : 1) * sizeof(int32));
+    if (neval == NULL) {
+      if (serr != NULL)
+	strcpy(serr, "out of memory");
+      goto return_error;
+    }
+    for (iseg = 0; iseg < b[k].nseg; iseg++) {
+      seg_use(pdp, NULL, NULL);
+      if (get_new_segment(pdp->tfstart + (iseg + 0.5) * pdp->dseg, ipl, ifno, serr) != OK)
+	goto return_error;
+      if (pdp->iflg & SEI_FLG_ROTATE)
+	rot_back(ipl);
+      else
+	pdp->neval = pdp->ncoe;
+      neval[iseg] = pdp->neval;
+      if (fwrite((void *) pdp->segp, 8, (size_t) (3 * pdp->ncoe), fp) != (size_t) (3 * pdp->ncoe)
+          || !flat_pad(fp, (int64) (b[k].stride - 3 * pdp->ncoe) * 8))
+	goto write_error;
+      off += (int64) b[k].stride * 8;
+    }
+    if (b[k].nseg > 0 && fwrite((void *) neval, sizeof(int32), (size_t) b[k].nseg, fp) != (size_t) b[k].nseg)
+      goto write_error;
+    off += (int64) b[k].nseg * 4;
+  }
+  free((void *) neval);
+  neval = NULL;
+  if (fclose(fp) != 0) {
+    fp = NULL;
+    goto write_error;
+  }
+  close_ephe_file(fdp);
+  free_planets();
+  return OK;
+write_error:
+  if (serr != NULL)
+    sprintf(serr, "cannot write %s", fout);
+return_error:
+  if (neval != NULL)
+    free((void *) neval);
+  if (fp != NULL) {
+    fclose(fp);
+    remove(fout);
+  }
+  close_ephe_file(fdp);
   free_planets();
   return ERR;
 }
 
+/* segment cache
+ * --------------
+ * Each body keeps up to segcache_cap decoded segments of its current
+ * file, so that alternating between distant dates (natal vs. transit,
+ * synastry) does not decode the same segments over and over. Entries
+ * hold coefficients after rot_back() - a private copy, or a reference
+ * into the shared segment store - so a hit only repoints pdp->segc.
+ * close_ephe_file() drops the current segments and empties the caches of
+ * all bodies of the file.
+ */
+static int32 segcache_cap = SEI_SEGCACHE_DEFAULT;
+
+void CALL_CONV swe_set_segment_cache(int32 nseg)
+{
+  segcache_cap = nseg < 0 ? 0 : nseg;
+}
+
+void CALL_CONV swe_get_segment_cache_stats(int64 *hits, int64 *misses, AS_BOOL reset)
+{
+  if (hits != NULL)
+    *hits = swed.segcache_hits;
+  if (misses != NULL)
+    *misses = swed.segcache_misses;
+  if (reset) {
+    swed.segcache_hits = 0;
+    swed.segcache_misses = 0;
+  }
+}
+
+static void segcache_free(struct plan_data *pdp)
+{
+  int i;
+  if (pdp->segcache != NULL) {
+    for (i = 0; i < pdp->nsegalloc; i++) {
+      if (pdp->segcache[i].coef != NULL)
+	free((void *) pdp->segcache[i].coef);
+      segshared_release(pdp->segcache[i].sh);
+    }
+    free((void *) pdp->segcache);
+  }
+  pdp->segcache = NULL;
+  pdp->nsegcache = 0;
+  pdp->nsegalloc = 0;
+}
+
+/* makes the cached segment containing tjd the current one */
+static AS_BOOL segcache_fetch(struct plan_data *pdp, double tjd)
+{
+  int i;
+  struct seg_cache_entry *e;
+  if (pdp->nsegcache == 0)
+    return FALSE;
+  for (i = 0; i < pdp->nsegcache; i++) {
+    e = &pdp->segcache[i];
+    if (tjd >= e->tseg0 && tjd <= e->tseg1) {
+      if (e->sh != NULL) {
+	swi_atomic_inc(&e->sh->nref);
+	seg_use(pdp, e->sh->coef, e->sh);
+      } else {
+	seg_use(pdp, e->coef, NULL);
+      }
+      pdp->tseg0 = e->tseg0;
+      pdp->tseg1 = e->tseg1;
+      pdp->neval = e->neval;
+      e->stamp = ++pdp->segclock;
+      swed.segcache_hits++;
+      SWI_INSTR_COUNT(segcache_hits, 1);
+      return TRUE;
+    }
+  }
+  return FALSE;
+}
+
+/* remembers the current segment, just decoded or taken from the store */
+static void segcache_store(struct plan_data *pdp)
+{
+  int i, ilru;
+  struct seg_cache_entry *e;
+  swed.segcache_misses++;
+  SWI_INSTR_COUNT(segcache_misses, 1);
+  if (segcache_cap == 0 || pdp->segc == NULL)
+    return;
+  if (pdp->nsegalloc != segcache_cap) {	/* first use, or capacity changed */
+    segcache_free(pdp);
+    pdp->segcache = (struct seg_cache_entry *) calloc((size_t) segcache_cap, sizeof(struct seg_cache_entry));
+    if (pdp->segcache == NULL)
+      return;
+    pdp->nsegalloc = segcache_cap;
+  }
+  if (pdp->nsegcache < pdp->nsegalloc) {
+    e = &pdp->segcache[pdp->nsegcache];
+  } else {
+    for (i = 1, ilru = 0; i < pdp->nsegcache; i++)
+      if (pdp->segcache[i].stamp < pdp->segcache[ilru].stamp)
+	ilru = i;
+    e = &pdp->segcache[ilru];
+  }
+  if (pdp->segsh != NULL) {
+    swi_atomic_inc(&pdp->segsh->nref);
+    segshared_release(e->sh);
+    e->sh = pdp->segsh;
+  } else {
+    if (e->coef == NULL
+      && (e->coef = (double *) malloc((size_t) pdp->ncoe * 3 * 8)) == NULL)
+      return;
+    memcpy((void *) e->coef, (void *) pdp->segc, (size_t) pdp->ncoe * 3 * 8);
+    segshared_release(e->sh);
+    e->sh = NULL;
+  }
+  if (e == &pdp->segcache[pdp->nsegcache])
+    pdp->nsegcache++;
+  e->tseg0 = pdp->tseg0;
+  e->tseg1 = pdp->tseg1;
+  e->neval = pdp->neval;
+  e->stamp = ++pdp->segclock;
+}
+
+/* points the body's current segment at coef; takes over the caller's
+ * reference to sh (may be NULL) and drops the previous one */
+static void seg_use(struct plan_data *pdp, double *coef, struct shared_seg *sh)
+{
+  segshared_release(pdp->segsh);
+  pdp->segsh = sh;
+  pdp->segc = coef;
+}
+
+/* drops every segment of a body: current, private buffer and cache */
+static void seg_free_all(struct plan_data *pdp)
+{
+  seg_use(pdp, NULL, NULL);
+  if (pdp->segp != NULL)
+    free((void *) pdp->segp);
+  pdp->segp = NULL;
+  segcache_free(pdp);
+}
+
+/* shared segment store
+ * ---------------------
+ * swed is thread-local, so every thread would otherwise decode the same
+ * segments into private buffers. With the store enabled, a segment is
+ * decoded once and published into a process-wide open-addressing table;
+ * every other thread finds it there and only keeps a pointer to it.
+ * Published segments are immutable and reference counted: the table
+ * holds one reference, and so does every plan_data and cache entry that
+ * points at the segment. Lookups and inserts are lock-free (acquire load
+ * of a slot, compare-and-swap into an empty one). When the probe run is
+ * full, the segment simply stays private to the thread.
+ */
+static struct shared_seg *volatile *segstore = NULL;
+static uint32 segstore_mask = 0;
+
+#ifdef _MSC_VER
+static long swi_atomic_inc(volatile long *p) { return _InterlockedIncrement(p); }
+static long swi_atomic_dec(volatile long *p) { return _InterlockedDecrement(p); }
+static struct shared_seg *segstore_load(uint32 i)
+{
+  return (struct shared_seg *) _InterlockedCompareExchangePointer((void *volatile *) &segstore[i], NULL, NULL);
+}
+/* returns the previous slot value: NULL if sh went in */
+static struct shared_seg *segstore_cas(uint32 i, struct shared_seg *sh)
+{
+  return (struct shared_seg *) _InterlockedCompareExchangePointer((void *volatile *) &segstore[i], sh, NULL);
+}
+#else
+static long swi_atomic_inc(volatile long *p) { return __sync_add_and_fetch(p, 1); }
+static long swi_atomic_dec(volatile long *p) { return __sync_sub_and_fetch(p, 1); }
+static struct shared_seg *segstore_load(uint32 i)
+{
+  return __atomic_load_n(&segstore[i], __ATOMIC_ACQUIRE);
+}
+static struct shared_seg *segstore_cas(uint32 i, struct shared_seg *sh)
+{
+  return __sync_val_compare_and_swap(&segstore[i], (struct shared_seg *) NULL, sh);
+}
+#endif
+
+static void segshared_release(struct shared_seg *sh)
+{
+  if (sh != NULL && swi_atomic_dec(&sh->nref) == 0)
+    free((void *) sh);
+}
+
+/* FNV-1a of the file path; files of the same name in different
+ * directories get different keys */
+static int64 segstore_filekey(const char *fnam)
+{
+  unsigned long long h = 14695981039346656037ULL;
+  for (; *fnam != '\0'; fnam++) {
+    h ^= (unsigned char) *fnam;
+    h *= 1099511628211ULL;
+  }
+  return (int64) h;
+}
+
+static uint32 segstore_hash(int64 fkey, int ipli, int32 iseg)
+{
+  unsigned long long h = (unsigned long long) fkey;
+  h ^= (unsigned long long) (uint32) ipli * 0x9E3779B97F4A7C15ULL;
+  h ^= (unsigned long long) (uint32) iseg * 0xC2B2AE3D27D4EB4FULL;
+  h ^= h >> 29;
+  h *= 0xBF58476D1CE4E5B9ULL;
+  h ^= h >> 32;
+  return (uint32) h;
+}
+
+int32 CALL_CONV swe_set_segment_store(int32 nslots)
+{
+  uint32 i, n;
+  if (nslots <= 0) {
+    n = 0;
+  } else {
+    for (n = 1; n < (uint32) nslots && n < 0x40000000; n <<= 1)
+      ;
+  }
+  if (segstore != NULL && n == segstore_mask + 1)
+    return (int32) n;
+  if (segstore != NULL) {
+    for (i = 0; i <= segstore_mask; i++)
+      segshared_release(segstore[i]);	/* threads may still hold theirs */
+    free((void *) segstore);
+    segstore = NULL;
+    segstore_mask = 0;
+  }
+  if (n == 0)
+    return 0;
+  segstore = (struct shared_seg *volatile *) calloc((size_t) n, sizeof(struct shared_seg *));
+  if (segstore == NULL)
+    return 0;
+  segstore_mask = n - 1;
+  return (int32) n;
+}
+
+void CALL_CONV swe_get_segment_store_stats(int64 *hits, int64 *published, AS_BOOL reset)
+{
+  if (hits != NULL)
+    *hits = swed.segstore_hits;
+  if (published != NULL)
+    *published = swed.segstore_published;
+  if (reset) {
+    swed.segstore_hits = 0;
+    swed.segstore_published = 0;
+  }
+}
+
+/* walks the window in steps that end just past the earliest end of a
+ * current segment: after each swe_calc(), the next position lies in a new
+ * segment of at least one file body. segments left over from an earlier
+ * walk start after t and are not taken for boundaries. */
+int32 CALL_CONV swe_preload(int32 ipl, double tjd_start, double tjd_end, int32 iflag, char *serr)
+{
+  int i;
+  int32 n = 0, retflag;
+  double t, tnext, xx[6];
+  struct plan_data *pdp;
+  iflag = (iflag & ~(SEFLG_JPLEPH|SEFLG_SWIEPH|SEFLG_MOSEPH)) | SEFLG_SWIEPH;
+  if (serr != NULL)
+    *serr = '\0';
+  for (t = tjd_start; t <= tjd_end; t = tnext) {
+    retflag = swe_calc(t, ipl, iflag, xx, serr);
+    if (retflag == ERR)
+      return ERR;
+    n++;
+    if (!(retflag & SEFLG_SWIEPH))	/* fell back to Moshier: no file here */
+      break;
+    tnext = tjd_end + 1;
+    for (i = 0; i < SEI_NPLANETS; i++) {
+      pdp = &swed.pldat[i];
+      if (pdp->segc != NULL && pdp->tseg0 <= t + 1 && pdp->tseg1 > t && pdp->tseg1 < tnext)
+	tnext = pdp->tseg1;
+    }
+    tnext += 1e-6;
+    if (tnext <= t)
+      break;
+  }
+  return n;
+}
+
+/* instrumentation blocks
+ * ------------------------
+ * a thread's first instrumented call allocates its block and pushes it
+ * onto a lock-free list, where it stays after the thread exits, so that
+ * totals never go down. only the owning thread writes a block; readers
+ * add them up without locking and may see a thread a few calls behind.
+ */
+#ifdef SWE_INSTRUMENT
+struct instr_block {
+  struct swe_instr c;	/* first: a block is also its counters */
+  struct instr_block *next;
+};
+static struct instr_block *volatile instr_blocks = NULL;
+TLS struct swe_instr *swi_instr_cur = NULL;
+
+struct swe_instr *swi_instr_attach(void)
+{
+  static struct swe_instr lost;	/* counts of threads without a block */
+  struct instr_block *b = (struct instr_block *) calloc(1, sizeof(struct instr_block));
+  if (b == NULL) {
+    swi_instr_cur = &lost;
+    return swi_instr_cur;
+  }
+#ifdef _MSC_VER
+  do {
+    b->next = instr_blocks;
+  } while (_InterlockedCompareExchangePointer((void *volatile *) &instr_blocks, b, b->next) != b->next);
+#else
+  do {
+    b->next = instr_blocks;
+  } while (!__sync_bool_compare_and_swap(&instr_blocks, b->next, b));
+#endif
+  swi_instr_cur = &b->c;
+  return swi_instr_cur;
+}
+
+/* swecalc() slot of a body number */
+static int swi_instr_body(int ipl)
+{
+  if (ipl >= 0 && ipl < SE_NPLANETS)
+    return ipl;
+  if (ipl == SE_ECL_NUT)
+    return SE_INSTR_ECL_NUT;
+  if (ipl > SE_AST_OFFSET)
+    return SE_INSTR_AST;
+  return SE_INSTR_FICT;
+}
+#endif
+
+AS_BOOL CALL_CONV swe_get_instr(struct swe_instr *out, AS_BOOL this_thread_only)
+{
+#ifdef SWE_INSTRUMENT
+  struct instr_block *b;
+  size_t i, n = sizeof(struct swe_instr) / sizeof(int64);	/* all fields are int64 */
+#endif
+  memset((void *) out, 0, sizeof(struct swe_instr));
+#ifdef SWE_INSTRUMENT
+#ifdef _MSC_VER
+  b = instr_blocks;
+#else
+  b = __atomic_load_n(&instr_blocks, __ATOMIC_ACQUIRE);
+#endif
+  for (; b != NULL; b = b->next) {
+    const volatile int64 *src = (const volatile int64 *) &b->c;
+    int64 *dst = (int64 *) out;
+    if (this_thread_only && &b->c != swi_instr_cur)
+      continue;
+    for (i = 0; i < n; i++)
+      dst[i] += src[i];
+    out->threads++;
+  }
+  return TRUE;
+#else
+  (void) this_thread_only;
+  return FALSE;
+#endif
+}
+
+int64 CALL_CONV swe_instr_ticks(void)
+{
+#if defined(SWE_INSTRUMENT) && ((defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))) \
+    || (defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))))
+  return swi_instr_now();
+#elif defined(CLOCK_MONOTONIC)
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64) ts.tv_sec * 1000000000 + ts.tv_nsec;
+#else
+  struct timespec ts;
+  timespec_get(&ts, TIME_UTC);
+  return (int64) ts.tv_sec * 1000000000 + ts.tv_nsec;
+#endif
+}
+
+static AS_BOOL segshared_match(struct shared_seg *sh, int64 fkey, int ipli, int32 iseg, int ncoe)
+{
+  return sh->fkey == fkey && sh->ipli == ipli && sh->iseg == iseg && sh->ncoe == ncoe;
+}
+
+/* makes the published segment containing tjd the current one */
+static AS_BOOL segstore_fetch(struct plan_data *pdp, int ipli, int ifno, double tjd)
+{
+  int64 fkey = swed.fidat[ifno].fkey;
+  int32 iseg;
+  uint32 h, k;
+  struct shared_seg *sh;
+  if (segstore == NULL)
+    return FALSE;
+  iseg = (int32) ((tjd - pdp->tfstart) / pdp->dseg);	/* as in get_new_segment() */
+  h = segstore_hash(fkey, ipli, iseg);
+  for (k = 0; k < SEI_SEGSTORE_PROBES; k++) {
+    sh = segstore_load((h + k) & segstore_mask);
+    if (sh == NULL)
+      return FALSE;
+    if (segshared_match(sh, fkey, ipli, iseg, pdp->ncoe)) {
+      swi_atomic_inc(&sh->nref);
+      seg_use(pdp, sh->coef, sh);
+      pdp->tseg0 = sh->tseg0;
+      pdp->tseg1 = sh->tseg1;
+      pdp->neval = sh->neval;
+      swed.segstore_hits++;
+      SWI_INSTR_COUNT(segstore_hits, 1);
+      return TRUE;
+    }
+  }
+  return FALSE;
+}
+
+/* publishes the segment just decoded into pdp->segp and switches the
+ * body over to the shared copy (or to the one another thread raced in) */
+static void segstore_publish(struct plan_data *pdp, int ipli, int ifno)
+{
+  int64 fkey = swed.fidat[ifno].fkey;
+  int32 iseg;
+  uint32 h, k, islot;
+  size_t ncoef = (size_t) pdp->ncoe * 3;
+  struct shared_seg *sh, *cur;
+  if (segstore == NULL || pdp->segp == NULL)
+    return;
+  iseg = (int32) ((pdp->tseg0 - pdp->tfstart) / pdp->dseg + 0.5);
+  sh = (struct shared_seg *) malloc(sizeof(struct shared_seg) + (ncoef - 1) * sizeof(double));
+  if (sh == NULL)
+    return;
+  sh->fkey = fkey;
+  sh->ipli = ipli;
+  sh->iseg = iseg;
+  sh->ncoe = pdp->ncoe;
+  sh->neval = pdp->neval;
+  sh->tseg0 = pdp->tseg0;
+  sh->tseg1 = pdp->tseg1;
+  sh->nref = 2;		/* the store's and pdp's */
+  memcpy((void *) sh->coef, (void *) pdp->segp, ncoef * sizeof(double));
+  h = segstore_hash(fkey, ipli, iseg);
+  for (k = 0; k < SEI_SEGSTORE_PROBES; k++) {
+    islot = (h + k) & segstore_mask;
+    cur = segstore_load(islot);
+    if (cur == NULL && (cur = segstore_cas(islot, sh)) == NULL) {
+      seg_use(pdp, sh->coef, sh);
+      swed.segstore_published++;
+      SWI_INSTR_COUNT(segstore_published, 1);
+      return;
+    }
+    if (segshared_match(cur, fkey, ipli, iseg, pdp->ncoe)) {
+      free((void *) sh);
+      swi_atomic_inc(&cur->nref);
+      seg_use(pdp, cur->coef, cur);
+      return;
+    }
+  }
+  free((void *) sh);	/* no free slot nearby: keep the private copy */
+}
+
 /* SWISSEPH
  * reads constants on ephemeris file
  * ifno         file #
@@ -4855,10 +6074,7 @@ fendian, ifno, serr);
       if (pdp->refep != NULL) { /* if switch to other eph. file */
         free((void *) pdp->refep);
 	pdp->refep = NULL;    /* 2015-may-5 */  
-        if (pdp->segp != NULL) {        
-          free((void *) pdp->segp);     /* array of coefficients of */
-          pdp->segp = NULL;     /* ephemeris segment        */  
-        }
+        seg_free_all(pdp);	/* coefficients of ephemeris segment(s) */
       }
       pdp->refep = (double *) malloc((size_t) pdp->ncoe * 2 * 8); 
       retc = do_fread((void *) pdp->refep, 8, 2*pdp->ncoe, 8, fp,
@@ -4879,9 +6095,7 @@ file_damage:
     }
   }
 return_error:
-  fclose(fdp->fptr);
-  // free(fdp->fptr);  is not from malloc(), must not be freed by us
-  fdp->fptr = NULL;
+  close_ephe_file(fdp);
   free_planets();
   return(ERR);
 }
@@ -6432,8 +7646,7 @@ static int32 fixstar_calc_from_struct(struct fixed_star *stardata, double tjd, i
       swed.jpl_file_is_open = FALSE;
     }
     for (i = 0; i < SEI_NEPHFILES; i ++) {
-      if (swed.fidat[i].fptr != NULL) 
-	fclose(swed.fidat[i].fptr);
+      close_ephe_file(&swed.fidat[i]);
       memset((void *) &swed.fidat[i], 0, sizeof(struct file_data));
     }
     swed.last_epheflag = epheflag;
@@ -6814,8 +8027,18 @@ static AS_BOOL get_builtin_star(char *star, char *sstar, char *srecord)
  * x		pointer to 6 doubles for returning position coordinates
  * serr		error return string
 **********************************************************/
+#ifdef SWE_INSTRUMENT
+static int32 swe_fixstar2_body(char *star, double tjd, int32 iflag, 
+  double *xx, char *serr);
+int32 CALL_CONV swe_fixstar2(char *star, double tjd, int32 iflag, 
+  double *xx, char *serr)
+  SWI_INSTR_RETURN(fixstar, int32, swe_fixstar2_body(star, tjd, iflag, xx, serr))
+static int32 swe_fixstar2_body(char *star, double tjd, int32 iflag, 
+  double *xx, char *serr)
+#else
 int32 CALL_CONV swe_fixstar2(char *star, double tjd, int32 iflag, 
   double *xx, char *serr)
+#endif
 {
   int i;
   AS_BOOL is_builtin_star = FALSE;
@@ -7640,8 +8863,7 @@ static int32 swi_fixstar_calc_from_record(char *srecord, double tjd, int32 iflag
       swed.jpl_file_is_open = FALSE;
     }
     for (i = 0; i < SEI_NEPHFILES; i ++) {
-      if (swed.fidat[i].fptr != NULL) 
-	fclose(swed.fidat[i].fptr);
+      close_ephe_file(&swed.fidat[i]);
       memset((void *) &swed.fidat[i], 0, sizeof(struct file_data));
     }
     swed.last_epheflag = epheflag;
@@ -7892,8 +9114,18 @@ if ((0)) {
  * x		pointer for returning the ecliptic coordinates
  * serr		error return string
 **********************************************************/
+#ifdef SWE_INSTRUMENT
+static int32 swe_fixstar_body(char *star, double tjd, int32 iflag, 
+  double *xx, char *serr);
+int32 CALL_CONV swe_fixstar(char *star, double tjd, int32 iflag, 
+  double *xx, char *serr)
+  SWI_INSTR_RETURN(fixstar, int32, swe_fixstar_body(star, tjd, iflag, xx, serr))
+static int32 swe_fixstar_body(char *star, double tjd, int32 iflag, 
+  double *xx, char *serr)
+#else
 int32 CALL_CONV swe_fixstar(char *star, double tjd, int32 iflag, 
   double *xx, char *serr)
+#endif
 {
   int i;
   char sstar[SWI_STAR_LENGTH + 1];
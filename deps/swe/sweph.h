@@ -607,6 +607,31 @@ extern struct epsilon oec2000;
 extern struct epsilon oec;
 */
 
+/* decoded (and rotated back) chebyshew segment kept for reuse,
+ * see swe_set_segment_cache() */
+#define SEI_SEGCACHE_DEFAULT	8
+struct seg_cache_entry {
+  double tseg0, tseg1;	/* time range of the segment */
+  int neval;		/* # of coefficients to evaluate */
+  uint32 stamp;		/* last use, for LRU eviction */
+  double *coef;		/* 3 x ncoe coefficients, private copy */
+  struct shared_seg *sh;	/* or a reference into the segment store */
+};
+
+/* decoded (and rotated back) segment in the process-wide segment store,
+ * see swe_set_segment_store(). immutable once published; freed when the
+ * last reference is released. */
+#define SEI_SEGSTORE_PROBES	16
+struct shared_seg {
+  int64 fkey;		/* file key, see file_data.fkey */
+  int ipli;		/* body number as passed to sweph() */
+  int32 iseg;		/* segment number within the file */
+  int ncoe, neval;
+  double tseg0, tseg1;
+  volatile long nref;	/* references: store, cache entries, plan_data */
+  double coef[1];	/* 3 x ncoe coefficients */
+};
+
 struct plan_data {
   /* the following data are read from file only once, immediately after 
    * file has been opened */
@@ -640,6 +665,10 @@ struct plan_data {
   double tseg0, tseg1;	/* start and end jd of current segment */
   double *segp;         /* pointer to unpacked cheby coeffs of segment;
 			 * the size is 3 x ncoe */
+  double *segc;		/* coefficients of the current segment: segp,
+			 * a segment cache entry or a shared segment */
+  struct shared_seg *segsh;	/* shared segment behind segc (holds a
+				 * reference), or NULL */
   int neval;		/* how many coefficients to evaluate. this may
 			 * be less than ncoe */
   /* result of most recent data evaluation for this body: */
@@ -653,6 +682,12 @@ struct plan_data {
 			 * xreturn+12	equatorial polar coordinates
 			 * xreturn+18	equatorial cartesian coordinates
 			 */
+  /* LRU cache of recently used segments of the current file;
+   * flushed whenever the file or the body changes */
+  struct seg_cache_entry *segcache;
+  int nsegcache;	/* entries in use */
+  int nsegalloc;	/* entries allocated */
+  uint32 segclock;	/* LRU clock */
 };
 
 /*
@@ -717,6 +752,14 @@ struct file_data {
   int32 iflg; 		/* byte reorder flag and little/bigendian flag */
   short npl;		/* how many planets in file */
   int ipl[SEI_FILE_NMAXPLAN];	/* planet numbers */
+  unsigned char *mbase;	/* read-only mapping of the whole file, or NULL;
+			 * see swe_set_ephe_mmap() */
+  size_t mlen;		/* length of the mapping */
+  const unsigned char *flat;	/* image of the matching .sef file, or NULL;
+				 * see swe_repack_ephe_file() */
+  size_t flatlen;
+  AS_BOOL flatheap;	/* flat was read into memory, not mapped */
+  int64 fkey;		/* hash of fnam, keys the shared segment store */
 };
  
 struct gen_const {
@@ -787,6 +830,15 @@ struct interpol {
   double nut_deps0, nut_deps1, nut_deps2;
 };
 
+/* last precession matrix of pre_pmat() (Vondrak 2011), which only
+ * depends on the date. swe_calc() precesses several times per body
+ * and every body of a chart at the same date. */
+struct prec_matrix {
+  AS_BOOL valid;
+  double tjd;
+  double pmat[9];
+};
+
 /* if this is changed, then also update initialisation in sweph.c */
 struct swe_data {
   AS_BOOL ephe_path_is_set;
@@ -844,6 +896,40 @@ struct swe_data {
   AS_BOOL n_fixstars_named;  // number of fixed stars with tradtional name
   AS_BOOL n_fixstars_records;// number of fixed stars records in fixed_stars
   struct fixed_star *fixed_stars;
+  int64 segcache_hits;	/* segment cache statistics of this thread */
+  int64 segcache_misses;
+  int64 segstore_hits;	/* segments taken from the shared store */
+  int64 segstore_published;	/* segments this thread decoded and published */
+  struct prec_matrix precmat;
 };
 
 extern TLS struct swe_data swed;
+
+/* instrumentation, see swe_get_instr(). SWI_INSTR is the calling thread's
+ * block; SWI_INSTR_RETURN(timer, type, call) is the body of a wrapper that
+ * times `call` into SWI_INSTR->timer and returns its result. */
+#ifdef SWE_INSTRUMENT
+extern TLS struct swe_instr *swi_instr_cur;
+struct swe_instr *swi_instr_attach(void);
+#define SWI_INSTR	(swi_instr_cur != NULL ? swi_instr_cur : swi_instr_attach())
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define swi_instr_now()	((int64) __rdtsc())
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define swi_instr_now()	((int64) __builtin_ia32_rdtsc())
+#else
+#define swi_instr_now()	swe_instr_ticks()
+#endif
+#define SWI_INSTR_COUNT(field, n)	(SWI_INSTR->field += (n))
+#define SWI_INSTR_RETURN(timer, type, call) \
+  { \
+    int64 t0_ = swi_instr_now(); \
+    type rc_ = (call); \
+    struct swe_instr_timer *tm_ = &SWI_INSTR->timer; \
+    tm_->calls++; \
+    tm_->ticks += swi_instr_now() - t0_; \
+    return rc_; \
+  }
+#else
+#define SWI_INSTR_COUNT(field, n)
+#endif
@@ -702,6 +702,16 @@ ext_def( int32 ) swe_calc(
 ext_def(int32) swe_calc_ut(double tjd_ut, int32 ipl, int32 iflag, 
 	double *xx, char *serr);
 
+/* swe_calc_ut() for all bodies in body_mask (1 << ipl, ipl < SE_NPLANETS)
+ * at one instant; body ipl goes to xx[6 * ipl] and retflag[ipl] */
+ext_def(int32) swe_calc_all_ut(double tjd_ut, int32 body_mask, int32 iflag, 
+	double *xx, int32 *retflag, char *serr);
+
+/* swe_calc_ut() over njd times (ascending is fastest) x nipl bodies;
+ * results body-major: xx[6 * (k * njd + i)], retflag[k * njd + i] */
+ext_def(int32) swe_calc_ut_batch(double *tjd_ut, int32 njd, int32 *ipl, int32 nipl, 
+	int32 iflag, double *xx, int32 *retflag, char *serr);
+
 ext_def(int32) swe_calc_pctr(double tjd, int32 ipl, int32 iplctr, int32 iflag, double *xxret, char *serr);
 
 ext_def(double) swe_solcross(double x2cross, double jd_et, int32 flag, char *serr);
@@ -740,6 +750,85 @@ ext_def( void ) swe_close(void);
 /* set directory path of ephemeris files */
 ext_def( void ) swe_set_ephe_path(const char *path);
 
+/* read SWISSEPH files through read-only memory mappings instead of stdio
+ * (default FALSE); process-wide and safe to call from any thread, applies
+ * to files opened afterwards: set it before worker threads open files */
+ext_def( void ) swe_set_ephe_mmap(AS_BOOL do_mmap);
+
+/* flat ephemeris files. swe_repack_ephe_file() converts the sweph file
+ * fname (xxx.se1) into outname (NULL: xxx.sef next to it), which holds
+ * every segment's chebyshew coefficients as they are evaluated: unpacked,
+ * rotated, little-endian doubles, 64-byte aligned, with a flat index.
+ * several times larger than the .se1. when an sweph file is opened and a
+ * matching xxx.sef lies next to it, segments are evaluated in place from
+ * a mapping of that file and nothing is decoded; the .se1 is still read
+ * for the constants. swe_repack_ephe_file() closes the calling thread's
+ * sweph files. returns OK or ERR with serr set. */
+ext_def( int32 ) swe_repack_ephe_file(const char *fname, const char *outname, char *serr);
+/* use xxx.sef files when present (default TRUE); process-wide and safe to
+ * call from any thread, applies to files opened afterwards */
+ext_def( void ) swe_set_ephe_flat(AS_BOOL use_flat);
+
+/* number of decoded SWISSEPH segments kept per body (LRU), default 8;
+ * 0 keeps only the current segment. process-wide, set before computing */
+ext_def( void ) swe_set_segment_cache(int32 nseg);
+/* segment cache hits/misses of the calling thread */
+ext_def( void ) swe_get_segment_cache_stats(int64 *hits, int64 *misses, AS_BOOL reset);
+/* process-wide store of decoded SWISSEPH segments shared by all threads,
+ * with room for nslots segments (rounded up to a power of 2); 0 disables
+ * it. keeps an existing store of the same size. must not be called while
+ * other threads are computing. returns the number of slots. */
+ext_def( int32 ) swe_set_segment_store(int32 nslots);
+/* segment store hits and segments published by the calling thread */
+ext_def( void ) swe_get_segment_store_stats(int64 *hits, int64 *published, AS_BOOL reset);
+/* warmup: computes body ipl from tjd_start to tjd_end (ET) once per
+ * SWISSEPH segment, so that every segment of the body (and of the bodies
+ * it depends on, e.g. the earth) in that window is decoded, and published
+ * into the segment store if there is one. also opens the files and reads
+ * their constants. iflag as for swe_calc(); SEFLG_SWIEPH is forced. stops
+ * early where the files do not reach. returns the number of positions
+ * computed, or ERR with serr set. */
+ext_def( int32 ) swe_preload(int32 ipl, double tjd_start, double tjd_end, int32 iflag, char *serr);
+
+/* opt-in instrumentation, compiled in with -DSWE_INSTRUMENT. every thread
+ * counts into a block of its own; swe_get_instr() adds up the blocks of all
+ * threads (this_thread_only: just the caller's), including threads that
+ * have exited. counters only grow: a reader resets by subtracting an
+ * earlier snapshot. ticks come from swe_instr_ticks() (the CPU time stamp
+ * counter where there is one, else nanoseconds) and include nested calls.
+ * without SWE_INSTRUMENT nothing is counted and swe_get_instr() returns
+ * FALSE with *out zeroed. */
+#define SE_INSTR_NBODIES	(SE_NPLANETS + 3)	/* swecalc slots: SE body numbers, */
+#define SE_INSTR_ECL_NUT	(SE_NPLANETS)		/* SE_ECL_NUT, */
+#define SE_INSTR_FICT		(SE_NPLANETS + 1)	/* fictitious bodies, */
+#define SE_INSTR_AST		(SE_NPLANETS + 2)	/* asteroids */
+#define SE_INSTR_APP_PLAN	0	/* app_pos_etc_*() slots */
+#define SE_INSTR_APP_PLAN_OSC	1
+#define SE_INSTR_APP_SUN	2
+#define SE_INSTR_APP_MOON	3
+#define SE_INSTR_APP_SBAR	4
+#define SE_INSTR_APP_MEAN	5
+#define SE_INSTR_NAPP		6
+struct swe_instr_timer {
+  int64 calls;
+  int64 ticks;
+};
+struct swe_instr {
+  struct swe_instr_timer swecalc[SE_INSTR_NBODIES];
+  struct swe_instr_timer segment;	/* get_new_segment(): segments decoded */
+  int64 segment_bytes;		/* file bytes those decodes read */
+  int64 segcache_hits, segcache_misses;	/* see swe_set_segment_cache() */
+  int64 segstore_hits, segstore_published;	/* see swe_set_segment_store() */
+  struct swe_instr_timer nutation;	/* swi_nutation() */
+  struct swe_instr_timer precess;	/* swi_precess() */
+  struct swe_instr_timer deltat;	/* calc_deltat() */
+  struct swe_instr_timer app_pos[SE_INSTR_NAPP];
+  struct swe_instr_timer fixstar;	/* swe_fixstar(), swe_fixstar2() */
+  int64 threads;		/* blocks added up */
+};
+ext_def( AS_BOOL ) swe_get_instr(struct swe_instr *out, AS_BOOL this_thread_only);
+ext_def( int64 ) swe_instr_ticks(void);
+
 /* set file name of JPL file */
 ext_def( void ) swe_set_jpl_file(const char *fname);
 
@@ -77,6 +77,22 @@
 #include "swephexp.h"
 #include "sweph.h"
 #include "swephlib.h"
+
+/* AVX2 kernel for swi_echeb3(), chosen at run time; -DSWE_NO_SIMD
+ * builds the portable code only */
+#if !defined(SWE_NO_SIMD) && (defined(__x86_64__) || defined(_M_X64)) \
+  && (defined(__GNUC__) || defined(_MSC_VER))
+# define SWI_CHEB_AVX2 1
+# include <immintrin.h>
+# ifdef _MSC_VER
+#  include <intrin.h>
+#  define SWI_TARGET_AVX2
+# else
+#  define SWI_TARGET_AVX2 __attribute__((target("avx2")))
+# endif
+#else
+# define SWI_CHEB_AVX2 0
+#endif
 #if MSDOS
 # include <process.h>
 # define strdup _strdup
@@ -212,6 +228,143 @@ double swi_edcheb(double x, double *coef, int ncf)
   return (bj - bf) * .5;
 }
 
+/*
+ * evaluates the three chebyshev series of a segment - coef[0..ncf-1],
+ * coef[ncoe..] and coef[2*ncoe..] - in one pass: x, y, z go to xp[0..2]
+ * and, if dxp != NULL, the derivatives to dxp[0..2]. same arithmetic,
+ * in the same order, as swi_echeb() and swi_edcheb(), so the results are
+ * identical; the six recurrences just run side by side instead of one
+ * after the other. on x86 with AVX2 the coordinates share one vector.
+ */
+static void echeb3_scalar(double x, double *coef, int ncoe, int ncf, double *xp, double *dxp)
+{
+  int i, j;
+  double x2 = x * 2., dj;
+  double br[3], brpp[3], brp2[3];
+  double bj[3], bf[3], bjpl[3], bjp2[3], xj, xjpl[3], xjp2[3];
+  double *c[3];
+  for (i = 0; i < 3; i++) {
+    c[i] = coef + i * ncoe;
+    br[i] = brpp[i] = brp2[i] = 0.;
+    bj[i] = bf[i] = bjpl[i] = bjp2[i] = xjpl[i] = xjp2[i] = 0.;
+  }
+  for (j = ncf - 1; j >= 0; j--) {
+    for (i = 0; i < 3; i++) {
+      brp2[i] = brpp[i];
+      brpp[i] = br[i];
+      br[i] = x2 * brpp[i] - brp2[i] + c[i][j];
+    }
+    if (dxp == NULL || j == 0)
+      continue;
+    dj = (double) (j + j);
+    for (i = 0; i < 3; i++) {
+      xj = c[i][j] * dj + xjp2[i];
+      bj[i] = x2 * bjpl[i] - bjp2[i] + xj;
+      bf[i] = bjp2[i];
+      bjp2[i] = bjpl[i];
+      bjpl[i] = bj[i];
+      xjp2[i] = xjpl[i];
+      xjpl[i] = xj;
+    }
+  }
+  for (i = 0; i < 3; i++) {
+    xp[i] = (br[i] - brp2[i]) * .5;
+    if (dxp != NULL)
+      dxp[i] = (bj[i] - bf[i]) * .5;
+  }
+}
+
+#if SWI_CHEB_AVX2
+/* no FMA on purpose: a*b+c must round twice, as in the scalar code */
+SWI_TARGET_AVX2 static void echeb3_avx2(double x, double *coef, int ncoe, int ncf, double *xp, double *dxp)
+{
+  int j;
+  double *c0 = coef, *c1 = coef + ncoe, *c2 = coef + 2 * ncoe;
+  double out[4];
+  __m256d x2 = _mm256_set1_pd(x * 2.), half = _mm256_set1_pd(.5);
+  __m256d c, dj, xj;
+  __m256d br = _mm256_setzero_pd(), brpp = br, brp2 = br;
+  __m256d bj = br, bf = br, bjpl = br, bjp2 = br, xjpl = br, xjp2 = br;
+  for (j = ncf - 1; j >= 0; j--) {
+    c = _mm256_set_pd(0., c2[j], c1[j], c0[j]);
+    brp2 = brpp;
+    brpp = br;
+    br = _mm256_add_pd(_mm256_sub_pd(_mm256_mul_pd(x2, brpp), brp2), c);
+    if (dxp == NULL || j == 0)
+      continue;
+    dj = _mm256_set1_pd((double) (j + j));
+    xj = _mm256_add_pd(_mm256_mul_pd(c, dj), xjp2);
+    bj = _mm256_add_pd(_mm256_sub_pd(_mm256_mul_pd(x2, bjpl), bjp2), xj);
+    bf = bjp2;
+    bjp2 = bjpl;
+    bjpl = bj;
+    xjp2 = xjpl;
+    xjpl = xj;
+  }
+  _mm256_storeu_pd(out, _mm256_mul_pd(_mm256_sub_pd(br, brp2), half));
+  xp[0] = out[0]; xp[1] = out[1]; xp[2] = out[2];
+  if (dxp != NULL) {
+    _mm256_storeu_pd(out, _mm256_mul_pd(_mm256_sub_pd(bj, bf), half));
+    dxp[0] = out[0]; dxp[1] = out[1]; dxp[2] = out[2];
+  }
+  _mm256_zeroupper();
+}
+
+static AS_BOOL cpu_has_avx2(void)
+{
+#ifdef _MSC_VER
+  /* cpuid is slow; the answer never changes, so a racy cache is fine */
+  static volatile int has = -1;
+  if (has < 0) {
+    int r[4], ok = 0;
+    __cpuid(r, 0);
+    if (r[0] >= 7) {
+      __cpuid(r, 1);
+      /* OSXSAVE and AVX, and the OS saves the YMM state */
+      if ((r[2] & (1 << 27)) && (r[2] & (1 << 28)) && (_xgetbv(0) & 6) == 6) {
+	__cpuidex(r, 7, 0);
+	ok = (r[1] & (1 << 5)) != 0;
+      }
+    }
+    has = ok;
+  }
+  return has != 0;
+#else
+  return __builtin_cpu_supports("avx2") != 0;
+#endif
+}
+#endif /* SWI_CHEB_AVX2 */
+
+void swi_echeb3(double x, double *coef, int ncoe, int ncf, double *xp, double *dxp)
+{
+#if SWI_CHEB_AVX2
+  if (cpu_has_avx2()) {
+    echeb3_avx2(x, coef, ncoe, ncf, xp, dxp);
+    return;
+  }
+#endif
+  echeb3_scalar(x, coef, ncoe, ncf, xp, dxp);
+}
+
+/* the two kernels of swi_echeb3() by name, for tests/echeb3_test */
+void swi_echeb3_scalar(double x, double *coef, int ncoe, int ncf, double *xp, double *dxp)
+{
+  echeb3_scalar(x, coef, ncoe, ncf, xp, dxp);
+}
+
+AS_BOOL swi_echeb3_avx2(double x, double *coef, int ncoe, int ncf, double *xp, double *dxp)
+{
+#if SWI_CHEB_AVX2
+  if (cpu_has_avx2()) {
+    echeb3_avx2(x, coef, ncoe, ncf, xp, dxp);
+    return TRUE;
+  }
+#else
+  (void) x; (void) coef; (void) ncoe; (void) ncf; (void) xp; (void) dxp;
+#endif
+  return FALSE;
+}
+
 /*
  * conversion between ecliptical and equatorial polar coordinates.
  * for users of SWISSEPH, not used by our routines.
@@ -1336,10 +1489,17 @@ static int precess_3(double *R, double J, int direction, int iflag, int prec_met
    * T = Julian centuries from J2000.0.  See AA page B18.
    */
   //T = (J - J2000)/36525.0;
-  if (prec_meth == SEMOD_PREC_OWEN_1990)
+  if (prec_meth == SEMOD_PREC_OWEN_1990) {
     owen_pre_matrix(J, pmat, iflag);
-  else
-    pre_pmat(J, pmat);
+  } else {
+    if (!swed.precmat.valid || swed.precmat.tjd != J) {
+      pre_pmat(J, swed.precmat.pmat);
+      swed.precmat.tjd = J;
+      swed.precmat.valid = TRUE;
+    }
+    for (i = 0; i < 9; i++)
+      pmat[i] = swed.precmat.pmat[i];
+  }
   if (direction == -1) {
     for (i = 0, j = 0; i <= 2; i++, j = i * 3) {
       x[i] = R[0] *  pmat[j + 0] +
@@ -1370,7 +1530,14 @@ static int precess_3(double *R, double J, int direction, int iflag, int prec_met
  * first go from J1 to J2000, then call the program again
  * to go from J2000 to J2.
  */
+#ifdef SWE_INSTRUMENT
+static int swi_precess_body(double *R, double J, int32 iflag, int direction );
 int swi_precess(double *R, double J, int32 iflag, int direction )
+  SWI_INSTR_RETURN(precess, int, swi_precess_body(R, J, iflag, direction))
+static int swi_precess_body(double *R, double J, int32 iflag, int direction )
+#else
+int swi_precess(double *R, double J, int32 iflag, int direction )
+#endif
 {
   double T = (J - J2000)/36525.0;
   int prec_model = swed.astro_models[SE_MODEL_PREC_LONGTERM];
@@ -2123,7 +2290,14 @@ static double quadratic_intp(double ym, double y0, double yp, double x)
   return y;
 }
 
+#ifdef SWE_INSTRUMENT
+static int swi_nutation_body(double tjd, int32 iflag, double *nutlo);
 int swi_nutation(double tjd, int32 iflag, double *nutlo)
+  SWI_INSTR_RETURN(nutation, int, swi_nutation_body(tjd, iflag, nutlo))
+static int swi_nutation_body(double tjd, int32 iflag, double *nutlo)
+#else
+int swi_nutation(double tjd, int32 iflag, double *nutlo)
+#endif
 {
   int retc = OK;
   double dnut[2], dx;
@@ -2542,7 +2716,14 @@ static const short dt97[TAB97_SIZ] = {
  * that of DE431).
  */
 #define DEMO 0
+#ifdef SWE_INSTRUMENT
+static int32 calc_deltat_body(double tjd, int32 iflag, double *deltat, char *serr);
 static int32 calc_deltat(double tjd, int32 iflag, double *deltat, char *serr)
+  SWI_INSTR_RETURN(deltat, int32, calc_deltat_body(tjd, iflag, deltat, serr))
+static int32 calc_deltat_body(double tjd, int32 iflag, double *deltat, char *serr)
+#else
+static int32 calc_deltat(double tjd, int32 iflag, double *deltat, char *serr)
+#endif
 {
   double ans = 0;
   double B, Y, Ygreg, dd;
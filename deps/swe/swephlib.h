@@ -147,6 +147,13 @@ extern double swi_mod2PI(double x);
 /* evaluation of chebyshew series and derivative */
 extern double swi_echeb(double x, double *coef, int ncf);
 extern double swi_edcheb(double x, double *coef, int ncf);
+/* the x, y, z series of a segment (stride ncoe) and their derivatives
+ * (dxp may be NULL) in one pass; same results as echeb/edcheb */
+extern void swi_echeb3(double x, double *coef, int ncoe, int ncf, double *xp, double *dxp);
+/* its portable and AVX2 kernels; the latter returns FALSE without
+ * evaluating if it is not compiled in (SWE_NO_SIMD) or the CPU lacks AVX2 */
+extern void swi_echeb3_scalar(double x, double *coef, int ncoe, int ncf, double *xp, double *dxp);
+extern AS_BOOL swi_echeb3_avx2(double x, double *coef, int ncoe, int ncf, double *xp, double *dxp);
 
 /* cross product of vectors */
 extern void swi_cross_prod(double *a, double *b, double *x);
@@ -0,0 +1,177 @@
+// Aspects.cpp — sweep-line aspect engine (C++17)
+
+#include "Aspects.hpp"
+#include "Trace.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+// ---- Ids, classes, weights ----
+const char* aspect_point_name(int id) {
+    if (id == ASP_ASC) return "ASC";
+    if (id == ASP_MC) return "MC";
+    return body_name(id);
+}
+
+OrbClass orb_class(int id) {
+    if (id == ASP_ASC || id == ASP_MC || id == SE_MEAN_NODE) return ORB_POINT;
+    const BodyId b = body_from_ipl(id);
+    return b == kNoBody ? ORB_OTHER : kBodyInfo[b].orbClass;
+}
+
+const double kDefaultOrbClassWeights[kNumOrbClasses] = { 1.60, 1.25, 1.10, 0.95, 0.90, 1.00 };
+
+OrbWeights OrbWeights::fromClasses(const double cls[kNumOrbClasses], double global) {
+    OrbWeights t;
+    for (int id = 0; id < kNumAspectIds; ++id) t.w[id] = global * cls[orb_class(id)];
+    return t;
+}
+
+const AspectDef kDefaultAspects[6] = {
+    { "Conjunction",   0.0, 6.0 },
+    { "Opposition",  180.0, 5.0 },
+    { "Trine",       120.0, 5.0 },
+    { "Square",       90.0, 5.0 },
+    { "Sextile",      60.0, 4.0 },
+    { "Quincunx",    150.0, 2.5 },
+};
+
+// ---- AspectFinder ----
+namespace {
+
+// forward distance from a to b, 0..360
+inline double fwd(double a, double b) {
+    double d = b - a;
+    if (d < 0) d += 360.0;
+    return d >= 360.0 ? d - 360.0 : d;
+}
+
+double max_weight(const AspectPoint* pts, size_t n, const OrbWeights& w) {
+    double m = 0;
+    for (size_t k = 0; k < n; ++k) m = std::max(m, w[pts[k].id]);
+    return m;
+}
+
+} // namespace
+
+void AspectFinder::sortPoints(const AspectPoint* pts, size_t n) {
+    order.resize(n);
+    for (size_t k = 0; k < n; ++k) order[k] = (uint32_t)k;
+    std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+        double la = norm360(pts[a].lon), lb = norm360(pts[b].lon);
+        return la < lb || (la == lb && a < b);
+    });
+    lon.resize(n);
+    for (size_t r = 0; r < n; ++r) lon[r] = norm360(pts[order[r]].lon);
+}
+
+// Calls f(rank) for every sorted point whose longitude lies on the arc
+// [from, from + len], walking forward and wrapping at 360.
+template <class F>
+void AspectFinder::scanArc(double from, double len, F&& f) const {
+    const size_t n = lon.size();
+    if (n == 0) return;
+    if (len >= 360.0) {
+        for (size_t r = 0; r < n; ++r) f(r);
+        return;
+    }
+    from = norm360(from);
+    size_t k0 = (size_t)(std::lower_bound(lon.begin(), lon.end(), from) - lon.begin());
+    for (size_t c = 0; c < n; ++c) {
+        size_t k = k0 + c;
+        double x = k < n ? lon[k] : lon[k - n] + 360.0;
+        if (x - from > len) break;
+        f(k < n ? k : k - n);
+    }
+}
+
+void AspectFinder::finish(bool bestOnly) {
+    std::sort(out.begin(), out.end(), [](const AspectHit& a, const AspectHit& b) {
+        if (a.i != b.i) return a.i < b.i;
+        if (a.j != b.j) return a.j < b.j;
+        return a.orb < b.orb;
+    });
+    if (bestOnly)
+        out.erase(std::unique(out.begin(), out.end(),
+            [](const AspectHit& a, const AspectHit& b) { return a.i == b.i && a.j == b.j; }), out.end());
+}
+
+const std::vector<AspectHit>& AspectFinder::find(const AspectPoint* pts, size_t n,
+    const AspectDef* aspects, size_t naspects, const OrbWeights& w, bool bestOnly) {
+    TRACE_SPAN("aspects", n);
+    out.clear();
+    sortPoints(pts, n);
+    const double wmax = max_weight(pts, n, w);
+
+    // Each unordered pair is visited once, from the end that sees the other
+    // at a forward distance d <= 180 (ties at 0 and 180 go to the lower rank).
+    for (size_t ai = 0; ai < naspects; ++ai) {
+        const double angle = aspects[ai].angle, reach = aspects[ai].orb * wmax;
+        const double lo = std::max(0.0, angle - reach), hi = std::min(180.0, angle + reach);
+        if (lo > hi) continue;
+        for (size_t r = 0; r < n; ++r) {
+            const AspectPoint& p = pts[order[r]];
+            scanArc(lon[r] + lo, hi - lo, [&](size_t k) {
+                if (k == r) return;
+                double d = fwd(lon[r], lon[k]);
+                if (d > 180.0 || ((d == 0.0 || d == 180.0) && k < r)) return;
+                const AspectPoint& q = pts[order[k]];
+                double dev = d - angle;
+                if (std::fabs(dev) > aspects[ai].orb * std::min(w[p.id], w[q.id])) return;
+                int i = (int)order[r], j = (int)order[k];
+                out.push_back({ std::min(i, j), std::max(i, j), (int)ai, std::fabs(dev),
+                                dev * (q.speed - p.speed) < 0 });
+            });
+        }
+    }
+    finish(bestOnly);
+    return out;
+}
+
+const std::vector<AspectHit>& AspectFinder::findCross(const AspectPoint* a, size_t na, const AspectPoint* b, size_t nb,
+    const AspectDef* aspects, size_t naspects, const OrbWeights& w, bool bestOnly) {
+    TRACE_SPAN("aspects", na + nb);
+    out.clear();
+    sortPoints(b, nb);
+    const double wmax = std::max(max_weight(a, na, w), max_weight(b, nb, w));
+
+    for (size_t ai = 0; ai < naspects; ++ai) {
+        const double angle = aspects[ai].angle, reach = aspects[ai].orb * wmax;
+        for (size_t i = 0; i < na; ++i) {
+            const AspectPoint& p = a[i];
+            const double lp = norm360(p.lon);
+            auto test = [&](size_t k) {
+                const AspectPoint& q = b[order[k]];
+                double d = fwd(lp, lon[k]);
+                bool back = d > 180.0;          // partner is behind p
+                double sep = back ? 360.0 - d : d;
+                double dev = sep - angle;
+                if (std::fabs(dev) > aspects[ai].orb * std::min(w[p.id], w[q.id])) return;
+                double rate = back ? p.speed - q.speed : q.speed - p.speed;
+                out.push_back({ (int)i, (int)order[k], (int)ai, std::fabs(dev), dev * rate < 0 });
+            };
+            // Partners lie at +angle and -angle; the two arcs merge near 0 and 180.
+            if (angle - reach <= 0.0 || angle + reach >= 180.0) {
+                double from = angle - reach <= 0.0 ? -(angle + reach) : angle - reach;
+                double to = angle - reach <= 0.0 ? angle + reach : 360.0 - angle + reach;
+                scanArc(lp + from, to - from, test);
+            } else {
+                scanArc(lp + angle - reach, 2 * reach, test);
+                scanArc(lp - angle - reach, 2 * reach, test);
+            }
+        }
+    }
+    finish(bestOnly);
+    return out;
+}
+
+std::vector<AspectPoint> aspect_points(const ChartBodies& bodies, const Houses* H) {
+    std::vector<AspectPoint> pts;
+    pts.reserve(bodies.size() + 2);
+    for (const auto& b : bodies) pts.push_back({ b.ipl(), b.lon, b.speed });
+    if (H) {
+        pts.push_back({ ASP_ASC, H->ascmc[SE_ASC], 0.0 });
+        pts.push_back({ ASP_MC, H->ascmc[SE_MC], 0.0 });
+    }
+    return pts;
+}
@@ -0,0 +1,88 @@
+#pragma once
+// Aspects.hpp — sweep-line aspect engine shared by the UI, the console app and batch jobs (C++17)
+//
+// Points are sorted by longitude once. For every aspect angle each point then
+// binary-searches the arc where a partner can lie and only tests the points
+// inside it, instead of testing every pair against every aspect. Orb
+// multipliers are a numeric table indexed by body id, filled once from the
+// per-class weights, so the inner loop does no string work.
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "AstrologyChart.hpp"
+
+// Aspectable ids: SE body numbers (0..SE_NPLANETS-1) plus the chart angles.
+enum : int {
+    ASP_ASC = SE_NPLANETS,
+    ASP_MC,
+    kNumAspectIds
+};
+
+const char* aspect_point_name(int id);
+
+// The orb class of an aspect id: kBodyInfo's for bodies, ORB_POINT for the angles.
+OrbClass orb_class(int id);
+
+// Default multipliers per OrbClass (the UI's defaults).
+extern const double kDefaultOrbClassWeights[kNumOrbClasses];
+
+struct OrbWeights {
+    double w[kNumAspectIds];
+
+    // w[id] = global * cls[orb_class(id)]
+    static OrbWeights fromClasses(const double cls[kNumOrbClasses], double global = 1.0);
+    double operator[](int id) const { return id >= 0 && id < kNumAspectIds ? w[id] : 1.0; }
+};
+
+struct AspectDef {
+    const char* name;
+    double angle;   // exact angle, 0..180
+    double orb;     // base orb in degrees, scaled by the weaker body's weight
+};
+
+// Conjunction, opposition, trine, square, sextile, quincunx with the UI's default orbs.
+extern const AspectDef kDefaultAspects[6];
+static const int kNumDefaultAspects = 6;
+
+struct AspectPoint {
+    int id;         // body id, indexes OrbWeights
+    double lon;     // degrees
+    double speed;   // degrees/day; 0 if unknown
+};
+
+struct AspectHit {
+    int i, j;       // point indices; i < j for find(), i in a / j in b for findCross()
+    int aspect;     // index into the aspect list
+    double orb;     // |separation - angle|
+    bool applying;  // the orb is shrinking
+};
+
+class AspectFinder {
+public:
+    // All aspects among pts[0..n). With bestOnly, only the tightest aspect of
+    // each pair is kept. Hits are sorted by (i, j, orb). The returned vector
+    // is reused by the next call.
+    const std::vector<AspectHit>& find(const AspectPoint* pts, size_t n,
+        const AspectDef* aspects, size_t naspects, const OrbWeights& w, bool bestOnly = false);
+
+    // All aspects between a[i] and b[j] (synastry, transits to natal).
+    const std::vector<AspectHit>& findCross(const AspectPoint* a, size_t na, const AspectPoint* b, size_t nb,
+        const AspectDef* aspects, size_t naspects, const OrbWeights& w, bool bestOnly = false);
+
+    const std::vector<AspectHit>& hits() const { return out; }
+
+private:
+    // scratch, kept between calls
+    std::vector<uint32_t> order;  // point index by rank
+    std::vector<double> lon;      // normalized longitude by rank
+    std::vector<AspectHit> out;
+
+    void sortPoints(const AspectPoint* pts, size_t n);
+    template <class F> void scanArc(double from, double len, F&& f) const;
+    void finish(bool bestOnly);
+};
+
+// Bodies (and optionally ASC/MC) of a computed chart as aspect points.
+std::vector<AspectPoint> aspect_points(const ChartBodies& bodies, const Houses* H = nullptr);
@@ -0,0 +1,145 @@
+// AstrologyChart.cpp — shared chart core used by the console app and the ImGui UI (C++17)
+
+#include "AstrologyChart.hpp"
+#include "Aspects.hpp"
+#include "Trace.hpp"
+
+#include <charconv>
+#include <cstring>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+// ---- Helpers ----
+DMS toDMS(double degrees) {
+    double d = std::floor(degrees);
+    double mfull = (degrees - d) * 60.0;
+    double m = std::floor(mfull);
+    double s = (mfull - m) * 60.0;
+    return { (int)d, (int)m, s };
+}
+
+const char* SIGN_NAMES[12] = {
+  "Aries","Taurus","Gemini","Cancer","Leo","Virgo",
+  "Libra","Scorpio","Sagittarius","Capricorn","Aquarius","Pisces"
+};
+
+// Whole value rounded to 0.01" first, so 29°59'59.999" carries into the next sign.
+size_t fmtLongitude(double lon, char* buf, size_t cap, bool asciiDegrees) {
+    const int64_t kCentiPerDeg = 360000, kCentiPerSign = 30 * kCentiPerDeg;
+    if (cap < kLongitudeChars) {
+        if (cap) buf[0] = 0;
+        return 0;
+    }
+    char* p = buf;
+    auto put = [&p](const char* s, size_t n) { std::memcpy(p, s, n); p += n; };
+    if (!std::isfinite(lon)) {
+        put("n/a", 4);
+        return 3;
+    }
+    int64_t c = std::llround(norm360(lon) * (double)kCentiPerDeg) % (12 * kCentiPerSign);
+    const char* sign = SIGN_NAMES[c / kCentiPerSign];
+    c %= kCentiPerSign;
+    const int deg = (int)(c / kCentiPerDeg);
+    c %= kCentiPerDeg;
+    const int min = (int)(c / 6000);
+    c %= 6000;
+
+    put(sign, std::strlen(sign));
+    *p++ = ' ';
+    p = std::to_chars(p, buf + cap, deg).ptr;
+    if (asciiDegrees) put(" deg ", 5);
+    else put("° ", sizeof("° ") - 1);
+    *p++ = (char)('0' + min / 10);
+    *p++ = (char)('0' + min % 10);
+    put("' ", 2);
+    p = std::to_chars(p, buf + cap, (int)(c / 100)).ptr;
+    *p++ = '.';
+    *p++ = (char)('0' + c % 100 / 10);
+    *p++ = (char)('0' + c % 10);
+    *p++ = '"';
+    *p = 0;
+    return (size_t)(p - buf);
+}
+
+std::string fmtLongitude(double lon, bool asciiDegrees) {
+    char buf[kLongitudeChars];
+    return std::string(buf, fmtLongitude(lon, buf, sizeof(buf), asciiDegrees));
+}
+
+void fmtLongitudes(const double* lon, size_t n, char* out, size_t stride, bool asciiDegrees, uint8_t* len) {
+    for (size_t i = 0; i < n; ++i) {
+        const size_t k = fmtLongitude(lon[i], out + i * stride, stride, asciiDegrees);
+        if (len) len[i] = (uint8_t)k;
+    }
+}
+
+// ---- AstrologyChart class ----
+AstrologyChart::AstrologyChart(int Y, int M, int D, double hour_utc, double lat_deg, double lon_deg, char house)
+    : Y(Y), M(M), D(D), hour(hour_utc), lat(lat_deg), lon(lon_deg), hsys(house) {
+    jd_ut = swe_julday(Y, M, D, hour, SE_GREG_CAL);
+}
+
+void AstrologyChart::print(bool asciiDegrees) const {
+    char buf[kLongitudeChars];
+    std::cout << "Planets:\n";
+    for (const auto& b : bodies) {
+        std::cout << std::left << std::setw(11) << b.name();
+        std::cout.write(buf, (std::streamsize)fmtLongitude(b.lon, buf, sizeof(buf), asciiDegrees));
+        std::cout << (b.retro ? " [R]" : "") << "\n";
+    }
+    std::cout << "\nHouses (" << houseName() << "):\n";
+    for (int i = 1; i <= 12; ++i) {
+        std::cout << "House " << std::setw(2) << i << ": ";
+        std::cout.write(buf, (std::streamsize)fmtLongitude(H.cusps[i], buf, sizeof(buf), asciiDegrees));
+        std::cout << "\n";
+    }
+    std::cout << "\nAscendant: ";
+    std::cout.write(buf, (std::streamsize)fmtLongitude(H.ascmc[SE_ASC], buf, sizeof(buf), asciiDegrees));
+    std::cout << "\nMidheaven: ";
+    std::cout.write(buf, (std::streamsize)fmtLongitude(H.ascmc[SE_MC], buf, sizeof(buf), asciiDegrees));
+    std::cout << "\n";
+
+    std::vector<AspectPoint> pts = aspect_points(bodies, &H);
+    AspectFinder finder;
+    const auto& hits = finder.find(pts.data(), pts.size(), kDefaultAspects, kNumDefaultAspects,
+        OrbWeights::fromClasses(kDefaultOrbClassWeights), true);
+    std::cout << "\nAspects:\n";
+    for (const auto& a : hits) {
+        std::cout << std::left << std::setw(11) << aspect_point_name(pts[a.i].id)
+            << std::setw(13) << kDefaultAspects[a.aspect].name
+            << std::setw(11) << aspect_point_name(pts[a.j].id)
+            << "orb " << std::fixed << std::setprecision(2) << a.orb << (asciiDegrees ? " deg" : "°")
+            << (a.applying ? " applying" : " separating") << "\n";
+    }
+}
+
+const char* AstrologyChart::houseName() const {
+    switch (hsys) {
+    case 'P': return "Placidus";
+    case 'W': return "Whole Sign";
+    case 'E': return "Equal";
+    case 'K': return "Koch";
+    default:  return "Custom";
+    }
+}
+
+void AstrologyChart::computePlanets() {
+    TRACE_SPAN("computePlanets");
+    // One call for all bodies: delta-T and the frame for jd_ut are set up once.
+    double all[6 * SE_NPLANETS]; char serr[AS_MAXCH] = { 0 };
+    int32 nfail = swe_calc_all_ut(jd_ut, kBodyMask, SEFLG_SWIEPH | SEFLG_SPEED, all, nullptr, serr);
+    if (nfail != 0) throw std::runtime_error(std::string("swe_calc_all_ut: ") + serr);
+
+    for (int b = 0; b < kNumBodies; ++b) {
+        const double* xx = &all[6 * kBodyInfo[b].ipl];
+        bodies[b] = { (BodyId)b, norm360(xx[0]), xx[1], xx[3], xx[3] < 0 };
+    }
+}
+
+void AstrologyChart::computeHouses() {
+    TRACE_SPAN("computeHouses");
+    int rc = swe_houses_ex(jd_ut, SEFLG_SWIEPH, lat, lon, hsys, H.cusps, H.ascmc);
+    if (rc == -1) throw std::runtime_error("swe_houses_ex failed");
+}
@@ -0,0 +1,86 @@
+#pragma once
+// AstrologyChart.hpp — shared chart core used by the console app and the ImGui UI (C++17)
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <cmath>
+#include <type_traits>
+
+#include "Bodies.hpp"
+
+// ---- Helpers ----
+static inline double norm360(double x) { double y = fmod(x, 360.0); if (y < 0) y += 360.0; return y; }
+
+struct DMS { int deg; int min; double sec; };
+DMS toDMS(double degrees);
+
+extern const char* SIGN_NAMES[12];
+
+// "Sign D° MM' S.ss\"" (or "D deg" with asciiDegrees). The buffer form
+// writes a NUL-terminated string without allocating and returns its length,
+// or 0 if cap < kLongitudeChars.
+static const size_t kLongitudeChars = 32;
+size_t fmtLongitude(double lon, char* buf, size_t cap, bool asciiDegrees = false);
+std::string fmtLongitude(double lon, bool asciiDegrees = false);
+
+// Formats a column: lon[i] goes to out + i * stride (stride >= kLongitudeChars);
+// its length to len[i] if len is given.
+void fmtLongitudes(const double* lon, size_t n, char* out, size_t stride = kLongitudeChars,
+                   bool asciiDegrees = false, uint8_t* len = nullptr);
+
+// ---- Core data ----
+
+// One computed body. Trivially copyable, like the chart's whole body array,
+// so charts can be memcpy'd through queues and caches.
+struct Body {
+    BodyId id{};
+    double lon{};
+    double lat{};
+    double speed{};
+    bool retro{};
+
+    const BodyInfo& info() const { return kBodyInfo[id]; }
+    const char* name() const { return kBodyInfo[id].name; }
+    int ipl() const { return kBodyInfo[id].ipl; }
+};
+
+// Indexed by BodyId.
+using ChartBodies = std::array<Body, kNumBodies>;
+
+static_assert(std::is_trivially_copyable<ChartBodies>::value, "chart bodies must stay memcpy-able");
+
+struct Houses {
+    double cusps[13]{}; // 1..12
+    double ascmc[10]{}; // [SE_ASC], [SE_MC], ...
+};
+
+// ---- AstrologyChart class ----
+class AstrologyChart {
+public:
+    AstrologyChart(int Y, int M, int D, double hour_utc, double lat_deg, double lon_deg, char house = 'P');
+
+    void compute() { computePlanets(); computeHouses(); }
+
+    void print(bool asciiDegrees = false) const;
+
+    const ChartBodies& getBodies() const { return bodies; }
+    const Houses& getHouses() const { return H; }
+    double getJulianDayUT() const { return jd_ut; }
+    double getJDUT() const { return jd_ut; }
+    char getHouse() const { return hsys; }
+
+private:
+    int Y, M, D;
+    double hour, lat, lon;
+    char hsys;
+    double jd_ut{};
+    ChartBodies bodies{};
+    Houses H{};
+
+    const char* houseName() const;
+    void computePlanets();
+    void computeHouses();
+};
@@ -0,0 +1,93 @@
+#pragma once
+// Bodies.hpp — compile-time registry of the bodies every chart computes (C++17)
+//
+// A BodyId indexes kBodyInfo, which holds everything keyed on a body: its SE
+// number, name, glyph, display color, orb class and flags. Code that used
+// to identify bodies by comparing names indexes this table instead, and a
+// Body in a chart carries only its id next to the numbers.
+
+#include <cstdint>
+
+extern "C" {
+#include "swephexp.h"
+}
+
+// Orb classes: the weaker body of a pair scales the orb.
+enum OrbClass { ORB_LUMINARY, ORB_PERSONAL, ORB_SOCIAL, ORB_OUTER, ORB_POINT, ORB_OTHER, kNumOrbClasses };
+
+// In output order.
+enum BodyId : uint8_t {
+    BODY_SUN, BODY_MOON, BODY_MERCURY, BODY_VENUS, BODY_MARS,
+    BODY_JUPITER, BODY_SATURN, BODY_URANUS, BODY_NEPTUNE, BODY_PLUTO,
+    BODY_NODE, BODY_CHIRON, BODY_LILITH,
+    kNumBodyIds,
+    kNoBody = 0xFF
+};
+
+enum BodyFlags : uint8_t {
+    BODY_PLANET   = 1,      // a physical body (Sun and Moon included)
+    BODY_CALC     = 2,      // a calculated point (node, apogee)
+    BODY_OPTIONAL = 4       // may be left out of aspects (UI toggles)
+};
+
+struct BodyInfo {
+    int ipl;                // SE body number
+    const char* name;
+    const char* key;        // lowercase identifier for flags, columns and JSON keys
+    const char* glyph;      // UTF-8
+    uint32_t rgb;           // display color, 0xRRGGBB
+    OrbClass orbClass;
+    uint8_t flags;          // BodyFlags
+};
+
+constexpr BodyInfo kBodyInfo[kNumBodyIds] = {
+    { SE_SUN,         "Sun",       "sun",     "☉", 0xFFD400, ORB_LUMINARY, BODY_PLANET },
+    { SE_MOON,        "Moon",      "moon",    "☽", 0xD2D2D2, ORB_LUMINARY, BODY_PLANET },
+    { SE_MERCURY,     "Mercury",   "mercury", "☿", 0xA0A0A0, ORB_PERSONAL, BODY_PLANET },
+    { SE_VENUS,       "Venus",     "venus",   "♀", 0xFF8CAA, ORB_PERSONAL, BODY_PLANET },
+    { SE_MARS,        "Mars",      "mars",    "♂", 0xE63C3C, ORB_PERSONAL, BODY_PLANET },
+    { SE_JUPITER,     "Jupiter",   "jupiter", "♃", 0xEBAA3C, ORB_SOCIAL,   BODY_PLANET },
+    { SE_SATURN,      "Saturn",    "saturn",  "♄", 0xA07846, ORB_SOCIAL,   BODY_PLANET },
+    { SE_URANUS,      "Uranus",    "uranus",  "♅", 0x50C8C8, ORB_OUTER,    BODY_PLANET },
+    { SE_NEPTUNE,     "Neptune",   "neptune", "♆", 0x508CDC, ORB_OUTER,    BODY_PLANET },
+    { SE_PLUTO,       "Pluto",     "pluto",   "♇", 0xAA50BE, ORB_OUTER,    BODY_PLANET },
+    { SE_TRUE_NODE,   "True Node", "node",    "☊", 0x787878, ORB_POINT,    BODY_CALC | BODY_OPTIONAL },
+    { SE_CHIRON,      "Chiron",    "chiron",  "⚷", 0x78AA50, ORB_POINT,    BODY_PLANET | BODY_OPTIONAL },
+    { SE_MEAN_APOG,   "Lilith",    "lilith",  "⚸", 0xD250B4, ORB_POINT,    BODY_CALC | BODY_OPTIONAL },
+};
+
+static const int kNumBodies = kNumBodyIds;
+
+constexpr const BodyInfo& body_info(BodyId id) { return kBodyInfo[id]; }
+
+// SE body number -> BodyId (kNoBody if not in the registry), as a table.
+struct BodyByIpl {
+    BodyId id[SE_NPLANETS];
+    constexpr BodyByIpl() : id() {
+        for (int i = 0; i < SE_NPLANETS; ++i) id[i] = kNoBody;
+        for (int b = 0; b < kNumBodyIds; ++b) id[kBodyInfo[b].ipl] = (BodyId)b;
+    }
+};
+constexpr BodyByIpl kBodyByIpl{};
+
+constexpr BodyId body_from_ipl(int ipl) {
+    return ipl >= 0 && ipl < SE_NPLANETS ? kBodyByIpl.id[ipl] : kNoBody;
+}
+
+// Name by SE body number; "Body" for bodies outside the registry.
+constexpr const char* body_name(int ipl) {
+    return body_from_ipl(ipl) == kNoBody ? "Body" : kBodyInfo[body_from_ipl(ipl)].name;
+}
+
+// A set of bodies: bit i is BodyId i.
+using BodySet = uint32_t;
+static const BodySet kAllBodies = (1u << kNumBodyIds) - 1;
+
+// A body set as a swe_calc_all_ut() body mask.
+constexpr int32 body_mask(BodySet set) {
+    int32 m = 0;
+    for (int b = 0; b < kNumBodyIds; ++b)
+        if (set >> b & 1) m |= (int32)1 << kBodyInfo[b].ipl;
+    return m;
+}
+static const int32 kBodyMask = body_mask(kAllBodies);
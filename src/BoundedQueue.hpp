@@ -0,0 +1,61 @@
+#pragma once
+// BoundedQueue.hpp — blocking FIFO with a fixed capacity for pipeline stages (C++17)
+//
+// push() blocks while the queue is full and pop() while it is empty, so a
+// fast producer cannot run ahead of a slow consumer by more than the
+// capacity. close() wakes everyone: pushes fail from then on, and pops
+// drain what is left before failing.
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <utility>
+
+template <class T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(size_t capacity) : cap(capacity ? capacity : 1) {}
+
+    bool push(T v) {
+        std::unique_lock<std::mutex> lk(mu);
+        notFull.wait(lk, [&] { return closed || items.size() < cap; });
+        if (closed) return false;
+        items.push_back(std::move(v));
+        lk.unlock();
+        notEmpty.notify_one();
+        return true;
+    }
+
+    bool pop(T& out) {
+        std::unique_lock<std::mutex> lk(mu);
+        notEmpty.wait(lk, [&] { return closed || !items.empty(); });
+        if (items.empty()) return false;
+        out = std::move(items.front());
+        items.pop_front();
+        lk.unlock();
+        notFull.notify_one();
+        return true;
+    }
+
+    void close() {
+        {
+            std::lock_guard<std::mutex> lk(mu);
+            closed = true;
+        }
+        notFull.notify_all();
+        notEmpty.notify_all();
+    }
+
+    size_t size() const {
+        std::lock_guard<std::mutex> lk(mu);
+        return items.size();
+    }
+
+private:
+    const size_t cap;
+    mutable std::mutex mu;
+    std::condition_variable notFull, notEmpty;
+    std::deque<T> items;
+    bool closed{};
+};
@@ -0,0 +1,153 @@
+// ChartBatch.cpp — batched AstrologyChart engine with structure-of-arrays output (C++17)
+
+#include "ChartBatch.hpp"
+#include "Trace.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <numeric>
+
+extern "C" {
+#include "sweph.h"
+#include "swephlib.h"
+}
+
+void ChartBatch::reserve(size_t cap) {
+    in_jd.reserve(cap); in_lat.reserve(cap); in_lon.reserve(cap); in_hsys.reserve(cap);
+}
+
+void ChartBatch::clear() {
+    in_jd.clear(); in_lat.clear(); in_lon.clear(); in_hsys.clear();
+    fails.clear();
+    n = 0;
+}
+
+size_t ChartBatch::add(double jd_ut, double lat_deg, double lon_deg, char house) {
+    in_jd.push_back(jd_ut);
+    in_lat.push_back(lat_deg);
+    in_lon.push_back(lon_deg);
+    in_hsys.push_back(house);
+    return in_jd.size() - 1;
+}
+
+void ChartBatch::fail(std::vector<Failure>& out, size_t i, int rc, const char* what, const char* serr) {
+    out_status[i] = rc;
+    std::string msg = what;
+    if (serr && *serr) { msg += ": "; msg += serr; }
+    out.push_back({ i, rc, std::move(msg) });
+}
+
+size_t ChartBatch::compute() {
+    prepare();
+    computeRange(0, n, fails);
+    return fails.size();
+}
+
+void ChartBatch::prepare() {
+    n = size();
+    out_lon.assign((size_t)kNumBodies * n, 0.0);
+    out_lat.assign((size_t)kNumBodies * n, 0.0);
+    out_speed.assign((size_t)kNumBodies * n, 0.0);
+    out_cusp.assign((size_t)12 * n, 0.0);
+    out_ascmc.assign((size_t)SE_NASCMC * n, 0.0);
+    out_status.assign(n, OK);
+    fails.clear();
+    order.resize(n);
+}
+
+void ChartBatch::computeRange(size_t lo, size_t hi, std::vector<Failure>& out) {
+    TRACE_SPAN("chunk", hi - lo);
+    // Walk the charts in time order; equal instants form one run.
+    std::iota(order.begin() + lo, order.begin() + hi, lo);
+    std::stable_sort(order.begin() + lo, order.begin() + hi, [&](size_t a, size_t b) { return in_jd[a] < in_jd[b]; });
+
+    const int32 hflag = iflag & (SEFLG_JPLEPH | SEFLG_SWIEPH | SEFLG_MOSEPH);
+    double cusps[37], ascmc[10];
+    char serr[AS_MAXCH];
+
+    for (size_t r0 = lo; r0 < hi;) {
+        const double jd = in_jd[order[r0]];
+        size_t r1 = r0 + 1;
+        while (r1 < hi && in_jd[order[r1]] == jd) ++r1;
+        const size_t first = order[r0];
+
+        // ---- per-instant work, shared by every location in the run ----
+        double all[6 * SE_NPLANETS];
+        int planet_rc;
+        {
+            TRACE_SPAN("computePlanets");
+            planet_rc = swe_calc_all_ut(jd, body_mask(bodies), iflag, all, nullptr, serr) == 0 ? OK : ERR;
+        }
+        for (int b = 0; b < kNumBodies; ++b) {
+            if (!(bodies >> b & 1)) continue;
+            const double* xx = &all[6 * kBodyInfo[b].ipl];
+            out_lon[(size_t)b * n + first] = norm360(xx[0]);
+            out_lat[(size_t)b * n + first] = xx[1];
+            out_speed[(size_t)b * n + first] = xx[3];
+        }
+        if (planet_rc < 0) {
+            for (size_t r = r0; r < r1; ++r) fail(out, order[r], planet_rc, "swe_calc_all_ut", serr);
+            r0 = r1;
+            continue;
+        }
+
+        TRACE_SPAN("computeHouses", r1 - r0);
+        // Same frame swe_houses_ex2() derives internally for a tropical chart.
+        double tjde = jd + swe_deltat_ex(jd, hflag, NULL);
+        double eps_mean = swi_epsiln(tjde, 0) * RADTODEG;
+        double nutlo[2];
+        swi_nutation(tjde, 0, nutlo);
+        nutlo[0] *= RADTODEG;
+        nutlo[1] *= RADTODEG;
+        if (hflag & SEFLG_NONUT) nutlo[0] = nutlo[1] = 0;
+        const double eps = eps_mean + nutlo[1];
+        const double sidt = swe_sidtime0(jd, eps, nutlo[0]);
+        double sundec = 99;  // only needed for Sunshine houses, fetched on demand
+        int sundec_rc = OK;
+
+        // ---- per-location work ----
+        for (size_t r = r0; r < r1; ++r) {
+            const size_t i = order[r];
+            if (i != first) {
+                for (int b = 0; b < kNumBodies; ++b) {
+                    out_lon[(size_t)b * n + i] = out_lon[(size_t)b * n + first];
+                    out_lat[(size_t)b * n + i] = out_lat[(size_t)b * n + first];
+                    out_speed[(size_t)b * n + i] = out_speed[(size_t)b * n + first];
+                }
+            }
+
+            int hsys = in_hsys[i];
+            int rc;
+            serr[0] = '\0';
+            if (iflag & SEFLG_SIDEREAL) {
+                rc = swe_houses_ex2(jd, hflag | SEFLG_SIDEREAL, in_lat[i], in_lon[i], hsys, cusps, ascmc, NULL, NULL, serr);
+            } else {
+                if (toupper(hsys) == 'I') {
+                    if (sundec == 99) {
+                        double xp[6];
+                        sundec_rc = swe_calc_ut(jd, SE_SUN, SEFLG_SPEED | SEFLG_EQUATORIAL, xp, NULL);
+                        sundec = xp[1];
+                    }
+                    if (sundec_rc < 0) hsys = 'O';
+                    ascmc[9] = sundec;
+                }
+                double armc = swe_degnorm(sidt * 15 + in_lon[i]);
+                rc = swe_houses_armc_ex2(armc, in_lat[i], eps, hsys, cusps, ascmc, NULL, NULL, serr);
+                if (sundec_rc < 0) rc = sundec_rc;
+            }
+            if (rc == ERR) { fail(out, i, rc, "swe_houses_ex failed", serr); continue; }
+
+            for (int h = 1; h <= 12; ++h) out_cusp[(size_t)(h - 1) * n + i] = cusps[h];
+            for (int k = 0; k < SE_NASCMC; ++k) out_ascmc[(size_t)k * n + i] = ascmc[k];
+        }
+        r0 = r1;
+    }
+}
+
+void ChartBatch::get(size_t i, ChartBodies& bodies, Houses& H) const {
+    for (int b = 0; b < kNumBodies; ++b)
+        bodies[b] = { (BodyId)b, bodyLon(b)[i], bodyLat(b)[i], bodySpeed(b)[i], retro(b, i) };
+    H = Houses{};
+    for (int h = 1; h <= 12; ++h) H.cusps[h] = cusp(h)[i];
+    for (int k = 0; k < SE_NASCMC; ++k) H.ascmc[k] = ascmc(k)[i];
+}
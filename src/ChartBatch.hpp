@@ -0,0 +1,83 @@
+#pragma once
+// ChartBatch.hpp — batched AstrologyChart engine with structure-of-arrays output (C++17)
+//
+// Queue any number of (jd_ut, lat, lon, hsys) inputs, call compute() once, then
+// read whole columns back. Charts are evaluated in time order so that ephemeris
+// segments stay hot, and everything that only depends on the instant (planet
+// positions, delta-T, obliquity, nutation, sidereal time, Sun declination for
+// Sunshine houses) is computed once per distinct jd_ut and shared by every
+// location queued at that instant. Results are written back in input order.
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "AstrologyChart.hpp"
+
+class ChartPool;
+
+class ChartBatch {
+public:
+    struct Failure { size_t index; int rc; std::string message; };
+
+    // Only the bodies in `bodies` are computed; the other columns stay 0.
+    explicit ChartBatch(int32 iflag = SEFLG_SWIEPH | SEFLG_SPEED, BodySet bodies = kAllBodies)
+        : iflag(iflag), bodies(bodies) {}
+
+    BodySet bodySet() const { return bodies; }
+
+    void reserve(size_t n);
+    void clear();
+    // Returns the index of the queued chart.
+    size_t add(double jd_ut, double lat_deg, double lon_deg, char house = 'P');
+    size_t size() const { return in_jd.size(); }
+
+    // Computes every queued chart. A failing chart does not abort the batch; it
+    // gets a negative status() and an entry in failures(). Returns the number
+    // of failed charts. ChartPool::compute() does the same across threads.
+    size_t compute();
+
+    // ---- Outputs (valid after compute()) ----
+    // Body columns are indexed by BodyId; each holds size() values.
+    const double* bodyLon(int b) const { return &out_lon[(size_t)b * n]; }
+    const double* bodyLat(int b) const { return &out_lat[(size_t)b * n]; }
+    const double* bodySpeed(int b) const { return &out_speed[(size_t)b * n]; }
+    bool retro(int b, size_t i) const { return out_speed[(size_t)b * n + i] < 0; }
+    // House cusp columns, h = 1..12.
+    const double* cusp(int h) const { return &out_cusp[(size_t)(h - 1) * n]; }
+    // ascmc columns, k = SE_ASC, SE_MC, SE_ARMC, SE_VERTEX, ...
+    const double* ascmc(int k) const { return &out_ascmc[(size_t)k * n]; }
+    const int* status() const { return out_status.data(); }
+    const std::vector<Failure>& failures() const { return fails; }
+
+    // Gathers one chart back into the AstrologyChart row types.
+    void get(size_t i, ChartBodies& bodies, Houses& H) const;
+
+private:
+    friend class ChartPool;
+
+    int32 iflag;
+    BodySet bodies;
+    size_t n{};
+
+    // inputs
+    std::vector<double> in_jd, in_lat, in_lon;
+    std::vector<char> in_hsys;
+
+    // outputs
+    std::vector<double> out_lon, out_lat, out_speed; // [kNumBodies][n]
+    std::vector<double> out_cusp;                    // [12][n]
+    std::vector<double> out_ascmc;                   // [SE_NASCMC][n]
+    std::vector<int> out_status;
+    std::vector<Failure> fails;
+
+    std::vector<size_t> order;
+
+    // Sizes the outputs for the queued inputs.
+    void prepare();
+    // Computes charts [lo, hi). Disjoint ranges may run concurrently on threads
+    // with their own swed state; failures go to `out` rather than fails.
+    void computeRange(size_t lo, size_t hi, std::vector<Failure>& out);
+    void fail(std::vector<Failure>& out, size_t i, int rc, const char* what, const char* serr);
+};
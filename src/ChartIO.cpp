@@ -0,0 +1,557 @@
+// ChartIO.cpp — birth records in, chart rows out, for batch jobs (C++17)
+
+#include "ChartIO.hpp"
+#include "DateTime.hpp"
+#include "TimeZones.hpp"
+#include "Trace.hpp"
+
+#include <charconv>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+const char* const kFieldNames[] = { "id", "datetime", "jd", "lat", "lon", "hsys", "tz" };
+
+inline std::string_view trim(std::string_view s) {
+    while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) s.remove_prefix(1);
+    while (!s.empty() && (s.back() == ' ' || s.back() == '\t' || s.back() == '\r')) s.remove_suffix(1);
+    return s;
+}
+
+bool parse_double(std::string_view s, double& out) {
+    s = trim(s);
+    if (!s.empty() && s.front() == '+') s.remove_prefix(1);
+    if (s.empty()) return false;
+    auto r = std::from_chars(s.data(), s.data() + s.size(), out);
+    return r.ec == std::errc() && r.ptr == s.data() + s.size() && std::isfinite(out);
+}
+
+// ---- Output helpers ----
+
+inline void put_num(std::string& out, double v) {
+    char b[32];
+    out.append(b, std::to_chars(b, b + sizeof(b), v).ptr);
+}
+
+void put_csv_text(std::string& out, std::string_view s) {
+    if (s.find_first_of(",\"\r\n") == std::string_view::npos) {
+        out.append(s);
+        return;
+    }
+    out.push_back('"');
+    for (char c : s) {
+        if (c == '"') out.push_back('"');
+        out.push_back(c);
+    }
+    out.push_back('"');
+}
+
+void put_json_text(std::string& out, std::string_view s) {
+    static const char* const kHex = "0123456789abcdef";
+    out.push_back('"');
+    for (char c : s) {
+        switch (c) {
+        case '"':  out.append("\\\""); break;
+        case '\\': out.append("\\\\"); break;
+        case '\n': out.append("\\n"); break;
+        case '\r': out.append("\\r"); break;
+        case '\t': out.append("\\t"); break;
+        default:
+            if ((unsigned char)c < 0x20) {
+                out.append("\\u00");
+                out.push_back(kHex[(unsigned char)c >> 4]);
+                out.push_back(kHex[c & 15]);
+            } else {
+                out.push_back(c);
+            }
+        }
+    }
+    out.push_back('"');
+}
+
+template <class T>
+inline void put_raw(std::string& out, T v) {
+    out.append((const char*)&v, sizeof(v));
+}
+
+// ---- JSON input ----
+
+struct Json {
+    const char* p;
+    const char* e;
+
+    void ws() { while (p < e && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')) ++p; }
+    bool eat(char c) {
+        ws();
+        if (p < e && *p == c) { ++p; return true; }
+        return false;
+    }
+
+    static void put_utf8(std::string& s, uint32_t cp) {
+        if (cp < 0x80) s.push_back((char)cp);
+        else if (cp < 0x800) { s.push_back((char)(0xC0 | cp >> 6)); s.push_back((char)(0x80 | (cp & 63))); }
+        else if (cp < 0x10000) {
+            s.push_back((char)(0xE0 | cp >> 12));
+            s.push_back((char)(0x80 | (cp >> 6 & 63)));
+            s.push_back((char)(0x80 | (cp & 63)));
+        } else {
+            s.push_back((char)(0xF0 | cp >> 18));
+            s.push_back((char)(0x80 | (cp >> 12 & 63)));
+            s.push_back((char)(0x80 | (cp >> 6 & 63)));
+            s.push_back((char)(0x80 | (cp & 63)));
+        }
+    }
+
+    bool hex4(uint32_t& v) {
+        if (e - p < 4) return false;
+        v = 0;
+        for (int i = 0; i < 4; ++i, ++p) {
+            const char c = *p;
+            v <<= 4;
+            if (c >= '0' && c <= '9') v |= (uint32_t)(c - '0');
+            else if (c >= 'a' && c <= 'f') v |= (uint32_t)(c - 'a' + 10);
+            else if (c >= 'A' && c <= 'F') v |= (uint32_t)(c - 'A' + 10);
+            else return false;
+        }
+        return true;
+    }
+
+    // A string at p (after ws). Plain strings stay views into the line; ones
+    // with escapes are decoded into buf.
+    bool string(std::string_view& out, std::string& buf) {
+        ws();
+        if (p >= e || *p != '"') return false;
+        const char* s = ++p;
+        while (p < e && *p != '"' && *p != '\\') ++p;
+        if (p < e && *p == '"') {
+            out = { s, (size_t)(p++ - s) };
+            return true;
+        }
+        buf.assign(s, p);
+        while (p < e && *p != '"') {
+            if (*p != '\\') { buf.push_back(*p++); continue; }
+            if (++p >= e) return false;
+            switch (*p++) {
+            case '"': buf.push_back('"'); break;
+            case '\\': buf.push_back('\\'); break;
+            case '/': buf.push_back('/'); break;
+            case 'b': buf.push_back('\b'); break;
+            case 'f': buf.push_back('\f'); break;
+            case 'n': buf.push_back('\n'); break;
+            case 'r': buf.push_back('\r'); break;
+            case 't': buf.push_back('\t'); break;
+            case 'u': {
+                uint32_t cp;
+                if (!hex4(cp)) return false;
+                if (cp >= 0xD800 && cp < 0xDC00) {      // surrogate pair
+                    uint32_t lo;
+                    if (e - p < 6 || p[0] != '\\' || p[1] != 'u') return false;
+                    p += 2;
+                    if (!hex4(lo) || lo < 0xDC00 || lo > 0xDFFF) return false;
+                    cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+                }
+                put_utf8(buf, cp);
+                break;
+            }
+            default: return false;
+            }
+        }
+        if (p >= e) return false;
+        ++p;
+        out = buf;
+        return true;
+    }
+
+    // A scalar as text (numbers, true/false/null); nested values are skipped.
+    bool value(std::string_view& out, std::string& buf, bool& isNull) {
+        ws();
+        isNull = false;
+        if (p >= e) return false;
+        if (*p == '"') return string(out, buf);
+        if (*p == '{' || *p == '[') {
+            int depth = 0;
+            std::string_view tmp;
+            while (p < e) {
+                if (*p == '"') {
+                    if (!string(tmp, buf)) return false;
+                    continue;
+                }
+                if (*p == '{' || *p == '[') ++depth;
+                else if ((*p == '}' || *p == ']') && --depth == 0) { ++p; break; }
+                ++p;
+            }
+            isNull = true;
+            return depth == 0;
+        }
+        const char* s = p;
+        while (p < e && *p != ',' && *p != '}' && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n') ++p;
+        out = { s, (size_t)(p - s) };
+        if (out == "null") isNull = true;
+        return !out.empty();
+    }
+};
+
+} // namespace
+
+// ---- Options ----
+
+bool parse_input_format(std::string_view s, InputFormat& f) {
+    if (s == "csv") f = InputFormat::Csv;
+    else if (s == "ndjson" || s == "jsonl") f = InputFormat::Ndjson;
+    else return false;
+    return true;
+}
+
+bool parse_output_format(std::string_view s, OutputFormat& f) {
+    if (s == "csv") f = OutputFormat::Csv;
+    else if (s == "ndjson" || s == "jsonl") f = OutputFormat::Ndjson;
+    else if (s == "bin" || s == "binary") f = OutputFormat::Binary;
+    else return false;
+    return true;
+}
+
+bool parse_body_set(std::string_view s, BodySet& out, std::string* err) {
+    if (s == "all") {
+        out = kAllBodies;
+        return true;
+    }
+    BodySet set = 0;
+    while (!s.empty()) {
+        const size_t comma = s.find(',');
+        const std::string_view key = trim(s.substr(0, comma));
+        s = comma == std::string_view::npos ? std::string_view() : s.substr(comma + 1);
+        int b = 0;
+        while (b < kNumBodyIds && key != kBodyInfo[b].key) ++b;
+        if (b == kNumBodyIds) {
+            if (err) *err = "unknown body '" + std::string(key) + "'";
+            return false;
+        }
+        set |= 1u << b;
+    }
+    if (!set) {
+        if (err) *err = "empty body set";
+        return false;
+    }
+    out = set;
+    return true;
+}
+
+bool parse_year_window(std::string_view s, double& jdFrom, double& jdTo, std::string* err) {
+    s = trim(s);
+    int from = 0, to = 0;
+    const char* end = s.data() + s.size();
+    auto r = std::from_chars(s.data(), end, from);
+    bool ok = r.ec == std::errc() && r.ptr != end && *r.ptr == '-';
+    if (ok) {
+        r = std::from_chars(r.ptr + 1, end, to);
+        ok = r.ec == std::errc() && r.ptr == end && from <= to;
+    }
+    if (!ok) {
+        if (err) *err = "expected FROM-TO years, e.g. 1900-2100";
+        return false;
+    }
+    jdFrom = swe_julday(from, 1, 1, 0.0, SE_GREG_CAL);
+    jdTo = swe_julday(to + 1, 1, 1, 0.0, SE_GREG_CAL);
+    return true;
+}
+
+// ---- BirthParser ----
+
+BirthParser::BirthParser(InputFormat f, char h) : fmt(f), hsys(h) {
+    for (int& c : column) c = -1;
+}
+
+bool BirthParser::header(std::string_view line, std::string* err) {
+    for (int& c : column) c = -1;
+    if (!line.empty() && line.size() >= 3 && std::memcmp(line.data(), "\xEF\xBB\xBF", 3) == 0) line.remove_prefix(3);
+    int col = 0;
+    while (true) {
+        const size_t comma = line.find(',');
+        const std::string_view name = trim(line.substr(0, comma));
+        for (int f = 0; f < kNumFields; ++f)
+            if (name == kFieldNames[f] && column[f] < 0) column[f] = col;
+        ++col;
+        if (comma == std::string_view::npos) break;
+        line.remove_prefix(comma + 1);
+    }
+    if (column[F_LAT] < 0 || column[F_LON] < 0 || (column[F_DATETIME] < 0 && column[F_JD] < 0)) {
+        if (err) *err = "header needs lat, lon and datetime or jd columns";
+        return false;
+    }
+    haveHeader = true;
+    return true;
+}
+
+bool BirthParser::splitCsv(std::string_view line, std::string* err) {
+    const char* p = line.data();
+    const char* e = p + line.size();
+    for (int col = 0;; ++col) {
+        std::string_view v;
+        int field = -1;
+        for (int f = 0; f < kNumFields; ++f)
+            if (column[f] == col) field = f;
+        if (p < e && *p == '"') {
+            const char* s = ++p;
+            bool escaped = false;
+            while (p < e) {
+                if (*p == '"') {
+                    if (p + 1 < e && p[1] == '"') { escaped = true; p += 2; continue; }
+                    break;
+                }
+                ++p;
+            }
+            if (p >= e) {
+                if (err) *err = "unterminated quoted field";
+                return false;
+            }
+            v = { s, (size_t)(p++ - s) };
+            if (escaped && field >= 0) {
+                std::string& buf = scratch[field];
+                buf.clear();
+                for (size_t k = 0; k < v.size(); ++k) {
+                    buf.push_back(v[k]);
+                    if (v[k] == '"') ++k;
+                }
+                v = buf;
+            }
+        } else {
+            const char* s = p;
+            while (p < e && *p != ',') ++p;
+            v = trim({ s, (size_t)(p - s) });
+        }
+        if (field >= 0) {
+            val[field] = v;
+            has[field] = !v.empty();
+        }
+        if (p >= e) return true;
+        if (*p != ',') {
+            if (err) *err = "unexpected text after a closing quote";
+            return false;
+        }
+        ++p;
+    }
+}
+
+bool BirthParser::splitJson(std::string_view line, std::string* err) {
+    Json j{ line.data(), line.data() + line.size() };
+    std::string keyBuf, skipBuf;
+    auto fail = [&](const char* msg) {
+        if (err) *err = msg;
+        return false;
+    };
+    if (!j.eat('{')) return fail("expected a JSON object");
+    if (j.eat('}')) return true;
+    do {
+        std::string_view key, v;
+        bool isNull;
+        if (!j.string(key, keyBuf) || !j.eat(':')) return fail("expected \"key\": value");
+        int field = -1;
+        for (int f = 0; f < kNumFields; ++f)
+            if (key == kFieldNames[f]) field = f;
+        if (!j.value(v, field >= 0 ? scratch[field] : skipBuf, isNull)) return fail("bad JSON value");
+        if (field >= 0 && !isNull) {
+            val[field] = v;
+            has[field] = !v.empty();
+        }
+    } while (j.eat(','));
+    if (!j.eat('}')) return fail("expected , or } in object");
+    j.ws();
+    if (j.p != j.e) return fail("text after the object");
+    return true;
+}
+
+bool BirthParser::parse(std::string_view line, BirthInput& out, std::string* err) {
+    TRACE_SPAN("parse_birth");
+    for (int f = 0; f < kNumFields; ++f) {
+        val[f] = {};
+        has[f] = false;
+    }
+    if (fmt == InputFormat::Csv) {
+        if (!haveHeader) {
+            if (err) *err = "no header line";
+            return false;
+        }
+        if (!splitCsv(line, err)) return false;
+    } else if (!splitJson(line, err)) {
+        return false;
+    }
+    return build(out, err);
+}
+
+bool BirthParser::build(BirthInput& out, std::string* err) const {
+    auto fail = [&](std::string msg) {
+        if (err) *err = std::move(msg);
+        return false;
+    };
+    out.id.assign(val[F_ID].data(), val[F_ID].size());
+    if (!has[F_LAT] || !parse_double(val[F_LAT], out.lat) || out.lat < -90.0 || out.lat > 90.0)
+        return fail("bad lat '" + std::string(val[F_LAT]) + "'");
+    if (!has[F_LON] || !parse_double(val[F_LON], out.lon) || out.lon < -180.0 || out.lon > 180.0)
+        return fail("bad lon '" + std::string(val[F_LON]) + "'");
+    out.hsys = has[F_HSYS] ? val[F_HSYS][0] : hsys;
+
+    if (has[F_DATETIME]) {
+        DateTime t;
+        DateStatus st;
+        {
+            TRACE_SPAN("parse_datetime");
+            st = parse_iso_datetime(val[F_DATETIME], t);
+        }
+        if (st != DT_OK) return fail("bad datetime '" + std::string(val[F_DATETIME]) + "': " + date_status_text(st));
+        if (t.hasOffset || !has[F_TZ]) {
+            out.jd = julian_day(t);
+            return true;
+        }
+        TRACE_SPAN("local_to_utc");
+        const TzZone* z = tz_database().zone(trim(val[F_TZ]));
+        if (!z) return fail("unknown time zone '" + std::string(val[F_TZ]) + "'");
+        const double secs = t.hour * 3600.0;
+        const double whole = std::floor(secs);
+        TzStatus ts;
+        const int64_t utc = z->toUtc(days_from_civil(t.year, t.month, t.day) * 86400 + (int64_t)whole, &ts);
+        if (ts == TZ_AMBIGUOUS) return fail("ambiguous local time (DST ends) in " + std::string(val[F_TZ]));
+        if (ts == TZ_NONEXISTENT) return fail("nonexistent local time (DST starts) in " + std::string(val[F_TZ]));
+        out.jd = 2440587.5 + ((double)utc + (secs - whole)) / 86400.0;
+        return true;
+    }
+    if (!has[F_JD] || !parse_double(val[F_JD], out.jd)) return fail("bad or missing datetime / jd");
+    return true;
+}
+
+// ---- ChartWriter ----
+
+ChartWriter::ChartWriter(OutputFormat f, BodySet b) : fmt(f), bodies(b) {}
+
+uint32_t ChartWriter::recordBytes() const {
+    int nb = 0;
+    for (int b = 0; b < kNumBodies; ++b) nb += bodies >> b & 1;
+    return (uint32_t)(8 + 3 * 8 + nb * 3 * 8 + 14 * 8);
+}
+
+void ChartWriter::header(std::string& out) const {
+    if (fmt == OutputFormat::Csv) {
+        out.append("id,jd,lat,lon,hsys");
+        for (int b = 0; b < kNumBodies; ++b) {
+            if (!(bodies >> b & 1)) continue;
+            for (const char* suffix : { "_lon", "_lat", "_speed" }) {
+                out.push_back(',');
+                out.append(kBodyInfo[b].key).append(suffix);
+            }
+        }
+        for (int h = 1; h <= 12; ++h) out.append(",cusp").append(std::to_string(h));
+        out.append(",asc,mc,error\n");
+    } else if (fmt == OutputFormat::Binary) {
+        BinHeader h{};
+        std::memcpy(h.magic, "ASTROOUT", 8);
+        h.version = 1;
+        h.byteOrder = 0x01020304;
+        h.bodies = bodies;
+        h.recordBytes = recordBytes();
+        put_raw(out, h);
+    }
+}
+
+void ChartWriter::row(std::string& out, const BirthInput& in, const ChartBatch* batch, size_t i,
+                      const char* error, bool badInput) const {
+    if (error || !batch) {
+        row(out, in, nullptr, nullptr, error, badInput);
+        return;
+    }
+    ChartBodies bodies;
+    Houses houses;
+    batch->get(i, bodies, houses);
+    row(out, in, &bodies, &houses);
+}
+
+void ChartWriter::row(std::string& out, const BirthInput& in, const ChartBodies* chart, const Houses* houses,
+                      const char* error, bool badInput) const {
+    TRACE_SPAN("format_row");
+    const bool ok = !error && chart && houses;
+    switch (fmt) {
+    case OutputFormat::Csv:
+        put_csv_text(out, in.id);
+        out.push_back(',');
+        if (!badInput) {
+            put_num(out, in.jd); out.push_back(',');
+            put_num(out, in.lat); out.push_back(',');
+            put_num(out, in.lon); out.push_back(',');
+            out.push_back(in.hsys);
+        } else {
+            out.append(",,,");
+        }
+        for (int b = 0; b < kNumBodies; ++b) {
+            if (!(bodies >> b & 1)) continue;
+            if (!ok) { out.append(",,,"); continue; }
+            out.push_back(','); put_num(out, (*chart)[b].lon);
+            out.push_back(','); put_num(out, (*chart)[b].lat);
+            out.push_back(','); put_num(out, (*chart)[b].speed);
+        }
+        for (int h = 1; h <= 12; ++h) {
+            out.push_back(',');
+            if (ok) put_num(out, houses->cusps[h]);
+        }
+        out.push_back(',');
+        if (ok) put_num(out, houses->ascmc[SE_ASC]);
+        out.push_back(',');
+        if (ok) put_num(out, houses->ascmc[SE_MC]);
+        out.push_back(',');
+        if (error) put_csv_text(out, error);
+        out.push_back('\n');
+        break;
+
+    case OutputFormat::Ndjson:
+        out.append("{\"id\":");
+        put_json_text(out, in.id);
+        if (!badInput) {
+            out.append(",\"jd\":"); put_num(out, in.jd);
+            out.append(",\"lat\":"); put_num(out, in.lat);
+            out.append(",\"lon\":"); put_num(out, in.lon);
+            out.append(",\"hsys\":\""); out.push_back(in.hsys); out.push_back('"');
+        }
+        if (!ok) {
+            out.append(",\"error\":");
+            put_json_text(out, error ? error : "no chart");
+            out.append("}\n");
+            break;
+        }
+        out.append(",\"bodies\":{");
+        for (int b = 0, first = 1; b < kNumBodies; ++b) {
+            if (!(bodies >> b & 1)) continue;
+            if (!first) out.push_back(',');
+            first = 0;
+            out.push_back('"'); out.append(kBodyInfo[b].key); out.append("\":{\"lon\":");
+            put_num(out, (*chart)[b].lon);
+            out.append(",\"lat\":"); put_num(out, (*chart)[b].lat);
+            out.append(",\"speed\":"); put_num(out, (*chart)[b].speed);
+            out.push_back('}');
+        }
+        out.append("},\"cusps\":[");
+        for (int h = 1; h <= 12; ++h) {
+            if (h > 1) out.push_back(',');
+            put_num(out, houses->cusps[h]);
+        }
+        out.append("],\"asc\":"); put_num(out, houses->ascmc[SE_ASC]);
+        out.append(",\"mc\":"); put_num(out, houses->ascmc[SE_MC]);
+        out.append("}\n");
+        break;
+
+    case OutputFormat::Binary: {
+        put_raw(out, (int32_t)(ok ? 0 : badInput ? -2 : -1));
+        put_raw(out, (int32_t)0);
+        put_raw(out, badInput ? 0.0 : in.jd);
+        put_raw(out, badInput ? 0.0 : in.lat);
+        put_raw(out, badInput ? 0.0 : in.lon);
+        for (int b = 0; b < kNumBodies; ++b) {
+            if (!(bodies >> b & 1)) continue;
+            put_raw(out, ok ? (*chart)[b].lon : 0.0);
+            put_raw(out, ok ? (*chart)[b].lat : 0.0);
+            put_raw(out, ok ? (*chart)[b].speed : 0.0);
+        }
+        for (int h = 1; h <= 12; ++h) put_raw(out, ok ? houses->cusps[h] : 0.0);
+        put_raw(out, ok ? houses->ascmc[SE_ASC] : 0.0);
+        put_raw(out, ok ? houses->ascmc[SE_MC] : 0.0);
+        break;
+    }
+    }
+}
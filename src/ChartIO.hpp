@@ -0,0 +1,105 @@
+#pragma once
+// ChartIO.hpp — birth records in, chart rows out, for batch jobs (C++17)
+//
+// Inputs hold one record per line, as CSV (the first line names the
+// columns) or NDJSON (one flat object per line). Both use the same fields:
+//
+//   id        copied to the output (optional)
+//   datetime  ISO-8601 (DateTime.hpp); with no UTC offset it is local time
+//             in tz if tz is given, else UTC
+//   jd        Julian day UT, instead of datetime
+//   lat, lon  degrees, south and west negative
+//   hsys      house system letter (optional)
+//   tz        IANA zone of a local datetime (optional)
+//
+// Outputs are CSV (a header, then one row per chart), NDJSON (one object
+// per chart) or fixed-size binary records. Writers format numbers with
+// std::to_chars (shortest round-trip form) into a caller-owned string.
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "ChartBatch.hpp"
+
+enum class InputFormat { Csv, Ndjson };
+enum class OutputFormat { Csv, Ndjson, Binary };
+
+bool parse_input_format(std::string_view s, InputFormat& f);
+bool parse_output_format(std::string_view s, OutputFormat& f);
+
+// "all", or a comma-separated list of kBodyInfo keys such as "sun,moon,node".
+bool parse_body_set(std::string_view s, BodySet& out, std::string* err = nullptr);
+
+// "FROM-TO" in years, e.g. "1900-2100": Julian days (UT) from 1 January of
+// FROM to the end of TO, for ChartPool::warmup().
+bool parse_year_window(std::string_view s, double& jdFrom, double& jdTo, std::string* err = nullptr);
+
+struct BirthInput {
+    std::string id;
+    double jd{};
+    double lat{}, lon{};
+    char hsys{ 'P' };
+};
+
+class BirthParser {
+public:
+    explicit BirthParser(InputFormat fmt, char hsys = 'P');
+
+    // CSV wants its header line before the first record.
+    bool needsHeader() const { return fmt == InputFormat::Csv && !haveHeader; }
+    bool header(std::string_view line, std::string* err = nullptr);
+
+    // One record. False with *err set if it is malformed.
+    bool parse(std::string_view line, BirthInput& out, std::string* err = nullptr);
+
+private:
+    enum Field { F_ID, F_DATETIME, F_JD, F_LAT, F_LON, F_HSYS, F_TZ, kNumFields };
+
+    InputFormat fmt;
+    char hsys;
+    bool haveHeader{};
+    int column[kNumFields];             // CSV column of each field, -1 if absent
+    std::string_view val[kNumFields];
+    bool has[kNumFields]{};
+    std::string scratch[kNumFields];    // unquoted / unescaped values
+
+    bool splitCsv(std::string_view line, std::string* err);
+    bool splitJson(std::string_view line, std::string* err);
+    bool build(BirthInput& out, std::string* err) const;
+};
+
+// Binary output: one BinHeader, then recordBytes per chart: int32 status
+// (0 ok, -1 chart failed, -2 bad input), int32 0, double jd, lat, lon,
+// lon/lat/speed of every body in the set (BodyId order), cusps 1..12, ASC,
+// MC. Native byte order; byteOrder reads 0x01020304 when it matches yours.
+struct BinHeader {
+    char magic[8];          // "ASTROOUT"
+    uint32_t version;
+    uint32_t byteOrder;
+    uint32_t bodies;        // BodySet
+    uint32_t recordBytes;
+};
+
+class ChartWriter {
+public:
+    ChartWriter(OutputFormat fmt, BodySet bodies);
+
+    // CSV header line or BinHeader; nothing for NDJSON.
+    void header(std::string& out) const;
+
+    // The row for input `in`: chart i of batch, or, if error is set, the error.
+    void row(std::string& out, const BirthInput& in, const ChartBatch* batch, size_t i,
+             const char* error = nullptr, bool badInput = false) const;
+    // The same for a chart gathered with ChartBatch::get(), e.g. on another
+    // thread than the batch's.
+    void row(std::string& out, const BirthInput& in, const ChartBodies* bodies, const Houses* houses,
+             const char* error = nullptr, bool badInput = false) const;
+
+    uint32_t recordBytes() const;
+
+private:
+    OutputFormat fmt;
+    BodySet bodies;
+};
@@ -0,0 +1,178 @@
+// ChartPool.cpp — multi-threaded ChartBatch service (C++17)
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "ChartPool.hpp"
+#include "Trace.hpp"
+
+#include <algorithm>
+
+bool pin_current_thread(unsigned cpu) {
+#ifdef _WIN32
+    if (cpu >= 64) return false;
+    return SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << cpu) != 0;
+#elif defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    (void)cpu;
+    return false;
+#endif
+}
+
+ChartPool::ChartPool(const std::string& path, unsigned threads, bool pin_threads)
+    : ephe_path(path), pin(pin_threads) {
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    // Before any worker starts: the store must not be resized under them.
+    // Keeps the store of an existing pool, which asks for the same size.
+    swe_set_segment_store(kSegmentStoreSlots);
+    workers.reserve(threads);
+    for (unsigned i = 0; i < threads; ++i)
+        workers.emplace_back(&ChartPool::workerMain, this, i);
+
+    // Don't hand out work until every worker has its ephemeris open.
+    std::unique_lock<std::mutex> lk(mu);
+    cv_done.wait(lk, [&] { return ready == workers.size(); });
+}
+
+ChartPool::~ChartPool() {
+    {
+        std::lock_guard<std::mutex> lk(mu);
+        stopping = true;
+    }
+    cv_work.notify_all();
+    for (auto& t : workers) t.join();
+}
+
+void ChartPool::run(ChartBatch* batch, size_t chunk, const std::function<void(unsigned)>* task) {
+    {
+        std::lock_guard<std::mutex> lk(mu);
+        job = batch;
+        job_task = task;
+        job_chunk = std::max<size_t>(chunk, 1);
+        next.store(0);
+        job_fails.clear();
+        busy = (unsigned)workers.size();
+        ++generation;
+    }
+    cv_work.notify_all();
+    std::unique_lock<std::mutex> lk(mu);
+    cv_done.wait(lk, [&] { return busy == 0; });
+    job = nullptr;
+    job_task = nullptr;
+}
+
+size_t ChartPool::compute(ChartBatch& batch, size_t chunk) {
+    std::lock_guard<std::mutex> one_job(submit_mu);
+    batch.prepare();
+    if (batch.n == 0) return 0;
+    run(&batch, chunk, nullptr);
+
+    // Chunks finish in any order; report failures in input order.
+    std::sort(job_fails.begin(), job_fails.end(),
+        [](const ChartBatch::Failure& a, const ChartBatch::Failure& b) { return a.index < b.index; });
+    batch.fails = std::move(job_fails);
+    job_fails.clear();
+    return batch.fails.size();
+}
+
+size_t ChartPool::warmup(double jdFrom, double jdTo, BodySet bodies, std::string* err) {
+    std::lock_guard<std::mutex> one_job(submit_mu);
+    TRACE_SPAN("warmup");
+    if (jdTo < jdFrom) std::swap(jdFrom, jdTo);
+    // Slices are in ET; a day of margin covers light time.
+    const double from = jdFrom + swe_deltat(jdFrom) - 1, to = jdTo + swe_deltat(jdTo) + 1;
+    const double slice = (to - from) / workers.size();
+    std::atomic<size_t> done{ 0 };
+    std::mutex err_mu;
+    std::string first_err;
+    const std::function<void(unsigned)> task = [&](unsigned id) {
+        const double lo = from + slice * id, hi = id + 1 == workers.size() ? to : lo + slice;
+        char serr[AS_MAXCH];
+        for (int b = 0; b < kNumBodyIds; ++b) {
+            if (!(bodies >> b & 1)) continue;
+            const int32 n = swe_preload(kBodyInfo[b].ipl, lo, hi, SEFLG_SWIEPH | SEFLG_SPEED, serr);
+            if (n == ERR) {
+                std::lock_guard<std::mutex> lk(err_mu);
+                if (first_err.empty()) first_err = std::string(kBodyInfo[b].name) + ": " + serr;
+                return;
+            }
+            done += (size_t)n;
+        }
+    };
+    run(nullptr, 0, &task);
+    if (!first_err.empty()) {
+        if (err) *err = first_err;
+        return 0;
+    }
+    return done.load();
+}
+
+void ChartPool::workerMain(unsigned id) {
+    trace_thread_name(("chart worker " + std::to_string(id)).c_str());
+    if (pin) {
+        unsigned ncpu = std::max(1u, std::thread::hardware_concurrency());
+        pin_current_thread(id % ncpu);
+    }
+
+    // Private ephemeris state: swed is thread-local, so this thread gets its
+    // own path, file handles and segment buffers. Warm them on the bodies we
+    // serve so the first real chart doesn't pay for fopen + read_const.
+    swe_set_ephe_path(ephe_path.c_str());
+    {
+        double xx[6]; char serr[AS_MAXCH];
+        for (const BodyInfo& b : kBodyInfo) swe_calc_ut(2451545.0 /* J2000 */, b.ipl, SEFLG_SWIEPH | SEFLG_SPEED, xx, serr);
+    }
+    {
+        std::lock_guard<std::mutex> lk(mu);
+        ++ready;
+    }
+    cv_done.notify_all();
+
+    unsigned seen = 0;
+    std::vector<ChartBatch::Failure> local;
+    for (;;) {
+        ChartBatch* batch;
+        const std::function<void(unsigned)>* task;
+        size_t step;
+        {
+            std::unique_lock<std::mutex> lk(mu);
+            cv_work.wait(lk, [&] { return stopping || generation != seen; });
+            if (stopping) break;
+            seen = generation;
+            batch = job;
+            task = job_task;
+            step = job_chunk;
+        }
+
+        local.clear();
+        if (task) {
+            (*task)(id);
+        } else {
+            for (;;) {
+                size_t lo = next.fetch_add(step);
+                if (lo >= batch->n) break;
+                batch->computeRange(lo, std::min(lo + step, batch->n), local);
+            }
+        }
+
+        bool last;
+        {
+            std::lock_guard<std::mutex> lk(mu);
+            job_fails.insert(job_fails.end(), local.begin(), local.end());
+            last = (--busy == 0);
+        }
+        if (last) cv_done.notify_all();
+    }
+
+    swe_close();
+}
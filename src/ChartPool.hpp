@@ -0,0 +1,83 @@
+#pragma once
+// ChartPool.hpp — multi-threaded ChartBatch service (C++17)
+//
+// Swiss Ephemeris keeps all of its state in the thread-local `swed`
+// (sweph.h), so every worker here owns a private ephemeris: it runs its own
+// swe_set_ephe_path(), opens and warms its own file handles once at startup
+// and closes them with swe_close() on shutdown. Workers are optionally pinned
+// to one CPU each. compute() shards a ChartBatch into chunks of consecutive
+// charts; results are written by input index, so the output is identical for
+// any thread count or scheduling.
+//
+// File handles stay per thread, but decoded ephemeris segments do not: the
+// pool turns on the process-wide segment store (swe_set_segment_store), so a
+// segment is decoded by whichever worker needs it first and every other
+// worker evaluates the same immutable copy.
+//
+// Note: the swe sources only use TLS when WIN32 is not defined (see
+// sweodef.h); 32-bit Windows builds must run the pool with one thread.
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ChartBatch.hpp"
+
+class ChartPool {
+public:
+    // Slots of the shared segment store; plenty for every kBodyInfo body over the
+    // whole sepl/semo file range.
+    static constexpr int32 kSegmentStoreSlots = 1 << 16;
+
+    // threads == 0 uses std::thread::hardware_concurrency().
+    explicit ChartPool(const std::string& ephe_path, unsigned threads = 0, bool pin = true);
+    ~ChartPool();
+
+    ChartPool(const ChartPool&) = delete;
+    ChartPool& operator=(const ChartPool&) = delete;
+
+    unsigned threads() const { return (unsigned)workers.size(); }
+
+    // Computes every chart queued in `batch` on the workers and blocks until
+    // done. Same contract as ChartBatch::compute(); failures() come back
+    // sorted by input index. Returns the number of failed charts.
+    size_t compute(ChartBatch& batch, size_t chunk = 256);
+
+    // Decodes every ephemeris segment that `bodies` need between jdFrom and
+    // jdTo (UT) into the shared segment store, the window split evenly
+    // across the workers, and blocks until done. Call before taking traffic
+    // so the first charts in the window decode nothing. Returns the number
+    // of positions computed; 0 with *err set if a body fails.
+    size_t warmup(double jdFrom, double jdTo, BodySet bodies = kAllBodies, std::string* err = nullptr);
+
+private:
+    std::string ephe_path;
+    bool pin;
+    std::vector<std::thread> workers;
+
+    std::mutex submit_mu;    // one job at a time
+    std::mutex mu;
+    std::condition_variable cv_work, cv_done;
+    unsigned generation{};   // bumped once per job
+    unsigned busy{};         // workers still inside the current job
+    unsigned ready{};        // workers past startup
+    bool stopping{};
+
+    // current job: a batch, or a task every worker runs once with its id
+    ChartBatch* job{};
+    const std::function<void(unsigned)>* job_task{};
+    size_t job_chunk{};
+    std::atomic<size_t> next{};
+    std::vector<ChartBatch::Failure> job_fails;
+
+    void run(ChartBatch* batch, size_t chunk, const std::function<void(unsigned)>* task);
+    void workerMain(unsigned id);
+};
+
+// Pins the calling thread to one CPU. Returns false where unsupported.
+bool pin_current_thread(unsigned cpu);
@@ -0,0 +1,141 @@
+// ChartService.cpp — coalesces concurrent chart requests into micro-batches (C++17)
+
+#include "ChartService.hpp"
+#include "Trace.hpp"
+
+#include <algorithm>
+#include <vector>
+
+ChartService::ChartService(const Config& c)
+    : cfg(c), pool(c.ephe_path, c.threads, c.pin), started(Clock::now()) {
+    if (cfg.maxBatch == 0) cfg.maxBatch = 1;
+    batcher = std::thread(&ChartService::batcherMain, this);
+}
+
+ChartService::~ChartService() {
+    stop();
+}
+
+void ChartService::stop() {
+    {
+        std::lock_guard<std::mutex> lk(mu);
+        if (stopping && !batcher.joinable()) return;
+        stopping = true;
+    }
+    cv_work.notify_all();
+    if (batcher.joinable()) batcher.join();
+}
+
+double ChartService::uptime() const {
+    return std::chrono::duration<double>(Clock::now() - started).count();
+}
+
+const char* ChartService::error(const ChartBatch& batch, size_t i) {
+    if (batch.status()[i] >= 0) return nullptr;
+    // ChartPool reports failures sorted by index.
+    const auto& f = batch.failures();
+    auto it = std::lower_bound(f.begin(), f.end(), i,
+        [](const ChartBatch::Failure& a, size_t idx) { return a.index < idx; });
+    return it != f.end() && it->index == i ? it->message.c_str() : "chart failed";
+}
+
+bool ChartService::compute(const BirthInput* in, size_t n, const Done& done) {
+    Pending p;
+    p.in = in;
+    p.n = n;
+    p.done = &done;
+    p.queued = Clock::now();
+    std::unique_lock<std::mutex> lk(mu);
+    if (stopping) return false;
+    queue.push_back(&p);
+    queuedCharts += n;
+    const bool wake = queue.size() == 1 || queuedCharts >= cfg.maxBatch;
+    if (wake) {
+        lk.unlock();
+        cv_work.notify_one();
+        lk.lock();
+    }
+    p.cv.wait(lk, [&] { return p.finished; });
+    lk.unlock();
+    st.requestNs.record((uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - p.queued).count());
+    return true;
+}
+
+void ChartService::batcherMain() {
+    trace_thread_name("batcher");
+    ChartBatch batch(SEFLG_SWIEPH | SEFLG_SPEED, cfg.bodies);
+    batch.reserve(cfg.maxBatch);
+    std::vector<Pending*> taken;
+    std::vector<size_t> first;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lk(mu);
+            cv_work.wait(lk, [&] { return stopping || !queue.empty(); });
+            if (queue.empty()) break;       // stopping, and nothing left
+            if (cfg.maxDelayUs && queuedCharts < cfg.maxBatch && !stopping) {
+                const auto deadline = queue.front()->queued + std::chrono::microseconds(cfg.maxDelayUs);
+                cv_work.wait_until(lk, deadline, [&] { return stopping || queuedCharts >= cfg.maxBatch; });
+            }
+            // Whole requests in arrival order; the first one always fits.
+            size_t charts = 0;
+            taken.clear();
+            while (!queue.empty() && (taken.empty() || charts + queue.front()->n <= cfg.maxBatch)) {
+                charts += queue.front()->n;
+                taken.push_back(queue.front());
+                queue.pop_front();
+            }
+            queuedCharts -= charts;
+        }
+
+        TraceSpan span("batch");
+        const Clock::time_point t0 = Clock::now();
+        batch.clear();
+        first.clear();
+        for (Pending* p : taken) {
+            first.push_back(batch.size());
+            for (size_t k = 0; k < p->n; ++k) batch.add(p->in[k].jd, p->in[k].lat, p->in[k].lon, p->in[k].hsys);
+            st.queueNs.record((uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(t0 - p->queued).count());
+        }
+        span.setArg(batch.size());
+        // Small batches are split evenly so that every worker shares the latency.
+        const size_t per = (batch.size() + pool.threads() - 1) / pool.threads();
+        const size_t failed = pool.compute(batch, std::min<size_t>(256, std::max<size_t>(per, 1)));
+        st.computeNs.record((uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - t0).count());
+        st.batchCharts.record(batch.size());
+        st.batches.fetch_add(1, std::memory_order_relaxed);
+        st.requests.fetch_add(taken.size(), std::memory_order_relaxed);
+        st.charts.fetch_add(batch.size(), std::memory_order_relaxed);
+        st.failed.fetch_add(failed, std::memory_order_relaxed);
+
+        for (size_t r = 0; r < taken.size(); ++r) {
+            Pending* p = taken[r];
+            (*p->done)(batch, first[r]);
+            // Notify under the lock: p lives on the caller's stack, which may
+            // unwind as soon as it sees finished.
+            std::lock_guard<std::mutex> lk(mu);
+            p->finished = true;
+            p->cv.notify_one();
+        }
+    }
+}
+
+void ChartService::statsJson(std::string& out) const {
+    const double up = uptime();
+    const uint64_t charts = st.charts.load();
+    out.append("{\"uptime_s\":").append(std::to_string(up));
+    out.append(",\"threads\":").append(std::to_string(pool.threads()));
+    out.append(",\"requests\":").append(std::to_string(st.requests.load()));
+    out.append(",\"charts\":").append(std::to_string(charts));
+    out.append(",\"failed\":").append(std::to_string(st.failed.load()));
+    out.append(",\"batches\":").append(std::to_string(st.batches.load()));
+    out.append(",\"charts_per_s\":").append(std::to_string(up > 0 ? (uint64_t)(charts / up) : 0));
+    out.append(",\"batch_charts\":");
+    st.batchCharts.json(out);
+    out.append(",\"queue_us\":");
+    st.queueNs.json(out, 1000.0);
+    out.append(",\"compute_us\":");
+    st.computeNs.json(out, 1000.0);
+    out.append(",\"request_us\":");
+    st.requestNs.json(out, 1000.0);
+    out.push_back('}');
+}
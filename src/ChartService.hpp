@@ -0,0 +1,110 @@
+#pragma once
+// ChartService.hpp — coalesces concurrent chart requests into micro-batches (C++17)
+//
+// Any number of threads call compute() with a few births each. One batcher
+// thread takes everything queued so far (up to maxBatch charts), runs it as a
+// single ChartBatch on a ChartPool, and hands every caller its slice of the
+// result. Requests that arrive while a batch computes form the next one, so
+// batches grow with the load by themselves: a lone request is computed at
+// once, and under concurrency the per-instant work and the warm ephemeris
+// segments are shared. maxDelayUs makes a small batch wait for company
+// instead, trading latency for throughput.
+//
+// The pool, and with it every worker's open ephemeris files, lives as long
+// as the service.
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "ChartIO.hpp"
+#include "ChartPool.hpp"
+#include "LatencyHistogram.hpp"
+
+class ChartService {
+public:
+    struct Config {
+        std::string ephe_path;
+        unsigned threads = 0;           // ChartPool workers, 0 = all cores
+        bool pin = false;
+        BodySet bodies = kAllBodies;
+        size_t maxBatch = 4096;         // charts per batch; a larger request runs alone
+        unsigned maxDelayUs = 0;        // how long a batch below maxBatch waits for more
+    };
+
+    // Counters since start. Times are nanoseconds.
+    struct Stats {
+        std::atomic<uint64_t> requests{ 0 }, charts{ 0 }, failed{ 0 }, batches{ 0 };
+        LatencyHistogram batchCharts;   // charts per batch
+        LatencyHistogram queueNs;       // request queued -> its batch starts
+        LatencyHistogram computeNs;     // per batch
+        LatencyHistogram requestNs;     // compute() call -> done() returns
+    };
+
+    // Called on the batcher thread with the computed batch; the request's
+    // charts are batch indices first..first+n-1. error(batch, i) names a
+    // failed chart.
+    using Done = std::function<void(const ChartBatch& batch, size_t first)>;
+
+    explicit ChartService(const Config& cfg);
+    ~ChartService();
+
+    ChartService(const ChartService&) = delete;
+    ChartService& operator=(const ChartService&) = delete;
+
+    // Computes n charts and calls done before returning. Blocks the caller.
+    // Returns false without calling done once the service is stopping.
+    bool compute(const BirthInput* in, size_t n, const Done& done);
+
+    // ChartPool::warmup() for the configured bodies; safe while serving.
+    size_t warmup(double jdFrom, double jdTo, std::string* err = nullptr) {
+        return pool.warmup(jdFrom, jdTo, cfg.bodies, err);
+    }
+
+    // Stops taking requests, finishes the queued ones and joins the batcher.
+    void stop();
+
+    // The failure message of chart i, or null if it succeeded.
+    static const char* error(const ChartBatch& batch, size_t i);
+
+    const Config& config() const { return cfg; }
+    unsigned threads() const { return pool.threads(); }
+    const Stats& stats() const { return st; }
+    double uptime() const;
+
+    // Stats as one JSON object (times in microseconds).
+    void statsJson(std::string& out) const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Pending {
+        const BirthInput* in;
+        size_t n;
+        const Done* done;
+        Clock::time_point queued;
+        bool finished{};
+        std::condition_variable cv;
+    };
+
+    Config cfg;
+    ChartPool pool;
+    Stats st;
+    const Clock::time_point started;
+
+    std::mutex mu;
+    std::condition_variable cv_work;
+    std::deque<Pending*> queue;
+    size_t queuedCharts{};
+    bool stopping{};
+    std::thread batcher;
+
+    void batcherMain();
+};
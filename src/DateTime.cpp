@@ -0,0 +1,128 @@
+// DateTime.cpp — ISO-8601 timestamp parsing for chart input (C++17)
+
+#include "DateTime.hpp"
+#include "TimeZones.hpp"
+
+#include <cmath>
+#include <limits>
+
+namespace {
+
+const double kJdUnixEpoch = 2440587.5;      // 1970-01-01 00:00 UT
+
+inline bool digit(char c) { return c >= '0' && c <= '9'; }
+
+// Exactly n digits at p.
+inline bool fixed(const char*& p, const char* e, int n, int& out) {
+    if (e - p < n) return false;
+    out = 0;
+    for (int i = 0; i < n; ++i, ++p) {
+        if (!digit(*p)) return false;
+        out = out * 10 + (*p - '0');
+    }
+    return true;
+}
+
+inline int days_in_month(int y, int m) {
+    static const int kDays[12] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+    return m == 2 && ((y % 4 == 0 && y % 100 != 0) || y % 400 == 0) ? 29 : kDays[m - 1];
+}
+
+} // namespace
+
+const char* date_status_text(DateStatus s) {
+    switch (s) {
+    case DT_OK:         return "ok";
+    case DT_SYNTAX:     return "expected YYYY-MM-DD[ HH:MM[:SS[.fff]]][Z|+HH:MM]";
+    case DT_BAD_DATE:   return "month or day out of range";
+    case DT_BAD_TIME:   return "hour, minute or second out of range";
+    case DT_BAD_OFFSET: return "UTC offset out of range";
+    default:            return "bad timestamp";
+    }
+}
+
+DateStatus parse_iso_datetime(std::string_view s, DateTime& out) {
+    const char* p = s.data();
+    const char* e = p + s.size();
+    while (p < e && (*p == ' ' || *p == '\t')) ++p;
+    while (e > p && (e[-1] == ' ' || e[-1] == '\t' || e[-1] == '\r' || e[-1] == '\n')) --e;
+
+    DateTime t;
+    if (!fixed(p, e, 4, t.year) || p == e || *p++ != '-' ||
+        !fixed(p, e, 2, t.month) || p == e || *p++ != '-' ||
+        !fixed(p, e, 2, t.day)) return DT_SYNTAX;
+    if (t.month < 1 || t.month > 12 || t.day < 1 || t.day > days_in_month(t.year, t.month)) return DT_BAD_DATE;
+
+    if (p < e && (*p == 'T' || *p == 't' || *p == ' ')) {
+        ++p;
+        int h, m, sec = 0;
+        double frac = 0.0;
+        if (!fixed(p, e, 2, h) || p == e || *p++ != ':' || !fixed(p, e, 2, m)) return DT_SYNTAX;
+        if (p < e && *p == ':') {
+            ++p;
+            if (!fixed(p, e, 2, sec)) return DT_SYNTAX;
+            if (p < e && (*p == '.' || *p == ',')) {
+                ++p;
+                if (p == e || !digit(*p)) return DT_SYNTAX;
+                static const double kPow10[10] = { 1, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9 };
+                uint32_t v = 0;
+                int nd = 0;
+                for (; p < e && digit(*p); ++p)
+                    if (nd < 9) { v = v * 10 + (uint32_t)(*p - '0'); ++nd; }      // beyond 1 ns is noise
+                frac = v / kPow10[nd];
+            }
+        }
+        if (h > 24 || m > 59 || sec > 60 || (h == 24 && (m || sec || frac > 0.0))) return DT_BAD_TIME;
+        t.hour = h + m / 60.0 + (sec + frac) / 3600.0;
+
+        if (p < e && (*p == 'Z' || *p == 'z')) {
+            ++p;
+            t.hasOffset = true;
+        } else if (p < e && (*p == '+' || *p == '-')) {
+            const int sign = *p++ == '-' ? -1 : 1;
+            int oh, om = 0;
+            if (!fixed(p, e, 2, oh)) return DT_SYNTAX;
+            const bool colon = p < e && *p == ':';
+            if (colon) ++p;
+            if ((colon || p < e) && !fixed(p, e, 2, om)) return DT_SYNTAX;
+            if (oh > 23 || om > 59) return DT_BAD_OFFSET;
+            t.offset = sign * (oh * 3600 + om * 60);
+            t.hasOffset = true;
+        }
+    }
+    if (p != e) return DT_SYNTAX;
+    out = t;
+    return DT_OK;
+}
+
+double julian_day(const DateTime& t) {
+    return kJdUnixEpoch + (double)days_from_civil(t.year, t.month, t.day) + (t.hour - t.offset / 3600.0) / 24.0;
+}
+
+size_t parse_iso_to_jd(const std::string_view* ts, size_t n, double* jd, DateStatus* status) {
+    size_t bad = 0;
+    DateTime t;
+    for (size_t i = 0; i < n; ++i) {
+        const DateStatus s = parse_iso_datetime(ts[i], t);
+        jd[i] = s == DT_OK ? julian_day(t) : std::numeric_limits<double>::quiet_NaN();
+        if (status) status[i] = s;
+        bad += s != DT_OK;
+    }
+    return bad;
+}
+
+bool parseUtcDateTime(std::string_view s, int& year, int& month, int& day, double& hour) {
+    DateTime t;
+    if (parse_iso_datetime(s, t) != DT_OK) return false;
+    if (t.offset != 0) {            // shift to UTC, carrying into the date
+        const double h = t.hour - t.offset / 3600.0;
+        const double shift = std::floor(h / 24.0);
+        civil_from_days(days_from_civil(t.year, t.month, t.day) + (int64_t)shift, t.year, t.month, t.day);
+        t.hour = h - shift * 24.0;
+    }
+    year = t.year;
+    month = t.month;
+    day = t.day;
+    hour = t.hour;
+    return true;
+}
@@ -0,0 +1,46 @@
+#pragma once
+// DateTime.hpp — ISO-8601 timestamp parsing for chart input (C++17)
+//
+// One parser for the UI, the console app and batch ingestion. It reads the
+// text in place: no allocations, no exceptions, no locale. Accepted:
+//
+//   YYYY-MM-DD[(T|t| )HH:MM[:SS[(.|,)fff...]]][Z|z|(+|-)HH[[:]MM]]
+//
+// Hours may be 24:00[:00] (end of day) and seconds 60 (a leap second);
+// surrounding blanks are ignored. Dates are proleptic Gregorian.
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+enum DateStatus {
+    DT_OK,
+    DT_SYNTAX,          // not of the form above
+    DT_BAD_DATE,        // month or day out of range
+    DT_BAD_TIME,        // hour, minute or second out of range
+    DT_BAD_OFFSET       // UTC offset out of range
+};
+
+const char* date_status_text(DateStatus s);
+
+struct DateTime {
+    int year{}, month{}, day{};
+    double hour{};          // wall-clock hours, fraction included
+    int32_t offset{};       // seconds east of UTC; 0 if none was given
+    bool hasOffset{};
+};
+
+DateStatus parse_iso_datetime(std::string_view s, DateTime& out);
+
+// Julian day (UT) of a parsed timestamp, offset applied; the same value as
+// swe_julday(..., SE_GREG_CAL) without going through the library.
+double julian_day(const DateTime& t);
+
+// jd[i] = julian_day(parse(ts[i])); bad rows get NaN and their status.
+// Returns the number of bad rows.
+size_t parse_iso_to_jd(const std::string_view* ts, size_t n, double* jd, DateStatus* status = nullptr);
+
+// UTC date and decimal hour for swe_julday(); an offset, if given, is
+// applied. "YYYY-MM-DD HH:MM[:SS]" and the rest of the grammar above.
+bool parseUtcDateTime(std::string_view s, int& year, int& month, int& day, double& hour);
@@ -0,0 +1,193 @@
+// EpheStats.cpp — Swiss Ephemeris instrumentation counters as JSON / Prometheus (C++17)
+
+#include "EpheStats.hpp"
+#include "Bodies.hpp"
+
+#include <cctype>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+namespace {
+
+constexpr size_t kFields = sizeof(swe_instr) / sizeof(int64);
+
+std::mutex g_mu;
+swe_instr g_base{};                 // snapshot taken by the last reset
+
+// Ticks are the CPU time stamp counter on x86 and nanoseconds elsewhere;
+// either way, measured once against steady_clock.
+double ticks_per_second() {
+    static const double tps = [] {
+        using Clock = std::chrono::steady_clock;
+        const Clock::time_point c0 = Clock::now();
+        const int64 t0 = swe_instr_ticks();
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        const int64 t1 = swe_instr_ticks();
+        const double secs = std::chrono::duration<double>(Clock::now() - c0).count();
+        return secs > 0 && t1 > t0 ? (double)(t1 - t0) / secs : 1e9;
+    }();
+    return tps;
+}
+
+// Lowercase identifier of a swecalc() slot: the kBodyInfo key where there
+// is one, else the SE name.
+std::string body_key(int slot) {
+    if (slot == SE_INSTR_ECL_NUT) return "ecl_nut";
+    if (slot == SE_INSTR_FICT) return "fictitious";
+    if (slot == SE_INSTR_AST) return "asteroid";
+    for (const BodyInfo& b : kBodyInfo)
+        if (b.ipl == slot) return b.key;
+    char name[AS_MAXCH];
+    swe_get_planet_name(slot, name);
+    std::string key;
+    for (const char* p = name; *p; ++p)
+        key.push_back(std::isalnum((unsigned char)*p) ? (char)std::tolower((unsigned char)*p) : '_');
+    return key;
+}
+
+const char* const kAppNames[SE_INSTR_NAPP] = { "plan", "plan_osc", "sun", "moon", "sbar", "mean" };
+
+inline void put_int(std::string& out, int64 v) {
+    char b[24];
+    out.append(b, std::to_chars(b, b + sizeof(b), (long long)v).ptr);
+}
+
+inline void put_num(std::string& out, double v) {
+    char b[32];
+    out.append(b, std::to_chars(b, b + sizeof(b), v).ptr);
+}
+
+void put_timer_json(std::string& out, const swe_instr_timer& t, double tps) {
+    const double us = t.ticks * 1e6 / tps;
+    out.append("{\"calls\":");
+    put_int(out, t.calls);
+    out.append(",\"us\":");
+    put_num(out, us);
+    out.append(",\"us_per_call\":");
+    put_num(out, t.calls ? us / t.calls : 0.0);
+    out.push_back('}');
+}
+
+// ---- Prometheus ----
+
+void put_family(std::string& out, const char* name, const char* type, const char* help) {
+    out.append("# HELP ").append(name).push_back(' ');
+    out.append(help).append("\n# TYPE ").append(name).push_back(' ');
+    out.append(type).push_back('\n');
+}
+
+void put_sample(std::string& out, const char* name, const std::string& labels, double v) {
+    out.append(name);
+    if (!labels.empty()) out.append("{").append(labels).push_back('}');
+    out.push_back(' ');
+    put_num(out, v);
+    out.push_back('\n');
+}
+
+template <class F>
+void for_each_timer(const swe_instr& c, F f) {
+    for (int i = 0; i < SE_INSTR_NBODIES; ++i)
+        if (c.swecalc[i].calls) f("fn=\"swecalc\",body=\"" + body_key(i) + "\"", c.swecalc[i]);
+    f("fn=\"get_new_segment\"", c.segment);
+    f("fn=\"nutation\"", c.nutation);
+    f("fn=\"precess\"", c.precess);
+    f("fn=\"deltat\"", c.deltat);
+    for (int i = 0; i < SE_INSTR_NAPP; ++i)
+        f(std::string("fn=\"app_pos_etc_") + kAppNames[i] + "\"", c.app_pos[i]);
+    f("fn=\"fixstar\"", c.fixstar);
+}
+
+} // namespace
+
+EpheStats ephe_stats(bool thisThread) {
+    EpheStats s;
+    s.enabled = swe_get_instr(&s.c, thisThread) != FALSE;
+    if (!s.enabled) return s;
+    s.ticksPerSecond = ticks_per_second();
+    if (!thisThread) {
+        std::lock_guard<std::mutex> lk(g_mu);
+        const int64 threads = s.c.threads;
+        int64* d = reinterpret_cast<int64*>(&s.c);
+        const int64* b = reinterpret_cast<const int64*>(&g_base);
+        for (size_t i = 0; i < kFields; ++i) d[i] -= b[i];
+        s.c.threads = threads;
+    }
+    return s;
+}
+
+void reset_ephe_stats() {
+    swe_instr now{};
+    if (!swe_get_instr(&now, FALSE)) return;
+    std::lock_guard<std::mutex> lk(g_mu);
+    g_base = now;
+}
+
+void ephe_stats_json(const EpheStats& s, std::string& out) {
+    const swe_instr& c = s.c;
+    const double tps = s.ticksPerSecond;
+    out.append("{\"enabled\":").append(s.enabled ? "true" : "false");
+    out.append(",\"threads\":");
+    put_int(out, c.threads);
+    out.append(",\"ticks_per_s\":");
+    put_num(out, tps);
+    out.append(",\"swecalc\":{");
+    bool first = true;
+    for (int i = 0; i < SE_INSTR_NBODIES; ++i) {
+        if (!c.swecalc[i].calls) continue;
+        if (!first) out.push_back(',');
+        first = false;
+        out.append("\"").append(body_key(i)).append("\":");
+        put_timer_json(out, c.swecalc[i], tps);
+    }
+    out.append("},\"segments\":");
+    put_timer_json(out, c.segment, tps);
+    out.pop_back();
+    out.append(",\"bytes\":");
+    put_int(out, c.segment_bytes);
+    out.append(",\"cache_hits\":");
+    put_int(out, c.segcache_hits);
+    out.append(",\"cache_misses\":");
+    put_int(out, c.segcache_misses);
+    out.append(",\"store_hits\":");
+    put_int(out, c.segstore_hits);
+    out.append(",\"store_published\":");
+    put_int(out, c.segstore_published);
+    out.append("},\"nutation\":");
+    put_timer_json(out, c.nutation, tps);
+    out.append(",\"precess\":");
+    put_timer_json(out, c.precess, tps);
+    out.append(",\"deltat\":");
+    put_timer_json(out, c.deltat, tps);
+    out.append(",\"app_pos\":{");
+    for (int i = 0; i < SE_INSTR_NAPP; ++i) {
+        if (i) out.push_back(',');
+        out.append("\"").append(kAppNames[i]).append("\":");
+        put_timer_json(out, c.app_pos[i], tps);
+    }
+    out.append("},\"fixstar\":");
+    put_timer_json(out, c.fixstar, tps);
+    out.push_back('}');
+}
+
+void ephe_stats_prometheus(const EpheStats& s, std::string& out) {
+    const swe_instr& c = s.c;
+    put_family(out, "swe_instrumented", "gauge", "1 if the ephemeris was built with SWE_INSTRUMENT");
+    put_sample(out, "swe_instrumented", "", s.enabled ? 1 : 0);
+    put_family(out, "swe_threads", "gauge", "Threads that have made instrumented calls");
+    put_sample(out, "swe_threads", "", (double)c.threads);
+    put_family(out, "swe_calls_total", "counter", "Calls per ephemeris function");
+    for_each_timer(c, [&](const std::string& l, const swe_instr_timer& t) { put_sample(out, "swe_calls_total", l, (double)t.calls); });
+    put_family(out, "swe_seconds_total", "counter", "Time per ephemeris function, nested calls included");
+    for_each_timer(c, [&](const std::string& l, const swe_instr_timer& t) { put_sample(out, "swe_seconds_total", l, t.ticks / s.ticksPerSecond); });
+    put_family(out, "swe_segment_bytes_total", "counter", "Ephemeris file bytes read by segment decodes");
+    put_sample(out, "swe_segment_bytes_total", "", (double)c.segment_bytes);
+    put_family(out, "swe_segment_cache_total", "counter", "Per-thread segment cache lookups");
+    put_sample(out, "swe_segment_cache_total", "result=\"hit\"", (double)c.segcache_hits);
+    put_sample(out, "swe_segment_cache_total", "result=\"miss\"", (double)c.segcache_misses);
+    put_family(out, "swe_segment_store_total", "counter", "Shared segment store hits and publishes");
+    put_sample(out, "swe_segment_store_total", "result=\"hit\"", (double)c.segstore_hits);
+    put_sample(out, "swe_segment_store_total", "result=\"published\"", (double)c.segstore_published);
+}
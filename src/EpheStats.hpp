@@ -0,0 +1,38 @@
+#pragma once
+// EpheStats.hpp — Swiss Ephemeris instrumentation counters as JSON / Prometheus (C++17)
+//
+// Reads the counters that the swe sources keep when they are compiled with
+// SWE_INSTRUMENT (CMake: -DASTRO_SWE_INSTRUMENT=ON): calls and time per
+// swecalc() body, segments decoded and the bytes they read, segment cache
+// and store hits, nutation, precession, delta T, the app_pos_etc_*() stages
+// and fixed-star lookups. Without SWE_INSTRUMENT the hooks compile to
+// nothing and every snapshot has enabled == false.
+//
+// Times are inclusive: swecalc() of a planet contains its segment decode,
+// nutation and app_pos_etc_plan() time.
+
+#include <string>
+
+extern "C" {
+#include "swephexp.h"
+}
+
+struct EpheStats {
+    swe_instr c{};                  // counts since the last reset_ephe_stats()
+    double ticksPerSecond = 1e9;    // converts the ticks fields to seconds
+    bool enabled = false;           // built with SWE_INSTRUMENT
+};
+
+// All threads (including exited ones), or only the calling thread. The
+// per-thread view counts since the thread's first instrumented call and
+// ignores reset_ephe_stats().
+EpheStats ephe_stats(bool thisThread = false);
+
+// Makes the process-wide counters start again from zero.
+void reset_ephe_stats();
+
+// One JSON object; times in microseconds, bodies with no calls left out.
+void ephe_stats_json(const EpheStats& s, std::string& out);
+
+// Prometheus text exposition format, swe_* metric families.
+void ephe_stats_prometheus(const EpheStats& s, std::string& out);
@@ -0,0 +1,497 @@
+// Gazetteer.cpp — trigram search index and compiled, memory-mapped gazetteer (C++17)
+
+#include "Gazetteer.hpp"
+
+#include <cstring>
+#include <numeric>
+#include <fstream>
+#include <unordered_set>
+#include <utility>
+
+
+namespace {
+
+// ASCII-only lowercase; UTF-8 bytes pass through unchanged.
+inline char fold(char c) {
+    return (c >= 'A' && c <= 'Z') ? (char)(c + ('a' - 'A')) : c;
+}
+
+inline uint32_t trigram(const char* p) {
+    return (uint32_t)(unsigned char)p[0] << 16 | (uint32_t)(unsigned char)p[1] << 8 | (unsigned char)p[2];
+}
+
+inline int popcount64(uint64_t x) {
+#if defined(__GNUC__)
+    return __builtin_popcountll(x);
+#else
+    x -= x >> 1 & 0x5555555555555555ull;
+    x = (x & 0x3333333333333333ull) + (x >> 2 & 0x3333333333333333ull);
+    x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0Full;
+    return (int)(x * 0x0101010101010101ull >> 56);
+#endif
+}
+
+// index of the lowest set bit; x != 0
+inline int ctz64(uint64_t x) { return popcount64((x & (~x + 1)) - 1); }
+
+// distinct trigrams of s[0..n), sorted
+void trigrams(const char* s, size_t n, std::vector<uint32_t>& out) {
+    out.clear();
+    for (size_t k = 0; k + 3 <= n; ++k) out.push_back(trigram(s + k));
+    std::sort(out.begin(), out.end());
+    out.erase(std::unique(out.begin(), out.end()), out.end());
+}
+
+// first element >= id in sorted [b, e), searching outward from b
+inline const uint32_t* gallop(const uint32_t* b, const uint32_t* e, uint32_t id) {
+    if (b == e || *b >= id) return b;
+    size_t step = 1;
+    while (b + step < e && b[step] < id) {
+        b += step;
+        step <<= 1;
+    }
+    return std::lower_bound(b + 1, std::min(b + step + 1, e), id);
+}
+
+inline bool word_start(char prev) {
+    return prev == ' ' || prev == '-' || prev == '\'' || prev == '(' || prev == '.';
+}
+
+} // namespace
+
+// ---- Build ----
+void PlaceIndex::clear(size_t rows, size_t bytes) {
+    own = Storage{};
+    own.text.reserve(bytes);
+    own.off.reserve(rows + 1);
+    own.off.push_back(0);
+    own.nameLen.reserve(rows);
+}
+
+void PlaceIndex::addRow(std::string_view name, std::string_view admin, std::string_view country) {
+    auto put = [&](std::string_view s) { for (char c : s) own.text.push_back(fold(c)); };
+    put(name);
+    own.text.push_back(',');
+    put(admin);
+    own.text.push_back(' ');
+    put(country);
+    own.off.push_back(own.text.size());
+    own.nameLen.push_back((uint32_t)name.size());
+}
+
+void PlaceIndex::build(const std::vector<Place>& all) {
+    size_t bytes = 0;
+    for (const auto& p : all) bytes += p.name.size() + p.adminName().size() + p.countryName().size() + 2;
+    clear(all.size(), bytes);
+    for (const auto& p : all) addRow(p.name, p.adminName(), p.countryName());
+    indexText();
+}
+
+void PlaceIndex::build(const Gazetteer& gaz) {
+    clear(gaz.size(), 0);
+    for (size_t i = 0; i < gaz.size(); ++i) {
+        PlaceView v = gaz[i];
+        addRow(v.name, v.admin, v.country);
+    }
+    indexText();
+}
+
+void PlaceIndex::indexText() {
+    const size_t n = own.nameLen.size();
+    auto row = [&](size_t i) { return own.text.data() + own.off[i]; };
+    auto rowLen = [&](size_t i) { return (size_t)(own.off[i + 1] - own.off[i]); };
+
+    // Posting lists, built in place: a bitmap of the trigrams present (2 MB
+    // for the 24-bit space) with a popcount prefix per word ranks each
+    // trigram to its key. One pass counts the postings of every key, a
+    // second scatters row ids into own.post. Rows are visited in order, so
+    // every list comes out ascending, and nothing per posting is kept
+    // besides the index itself.
+    std::vector<uint64_t> present(1u << 18);
+    std::vector<uint32_t> rank(present.size() + 1), t;
+    for (size_t i = 0; i < n; ++i)
+        for (size_t j = 0; j + 3 <= rowLen(i); ++j) {
+            const uint32_t k = trigram(row(i) + j);
+            present[k >> 6] |= 1ull << (k & 63);
+        }
+    for (size_t w = 0; w < present.size(); ++w) rank[w + 1] = rank[w] + (uint32_t)popcount64(present[w]);
+    auto keyOf = [&](uint32_t k) {
+        return rank[k >> 6] + (uint32_t)popcount64(present[k >> 6] & ((1ull << (k & 63)) - 1));
+    };
+    own.keys.resize(rank.back());
+    for (size_t w = 0, j = 0; w < present.size(); ++w)
+        for (uint64_t bits = present[w]; bits; bits &= bits - 1)
+            own.keys[j++] = (uint32_t)(w << 6) + (uint32_t)ctz64(bits);
+    own.start.assign(own.keys.size() + 1, 0);
+    for (size_t i = 0; i < n; ++i) {
+        trigrams(row(i), rowLen(i), t);
+        for (uint32_t k : t) ++own.start[keyOf(k) + 1];
+    }
+    for (size_t j = 0; j < own.keys.size(); ++j) own.start[j + 1] += own.start[j];
+    own.post.resize(own.start.back());
+    std::vector<uint32_t> fill(own.start.begin(), own.start.end() - 1);
+    for (size_t i = 0; i < n; ++i) {
+        trigrams(row(i), rowLen(i), t);
+        for (uint32_t k : t) own.post[fill[keyOf(k)]++] = (uint32_t)i;
+    }
+
+    own.byName.resize(n);
+    std::iota(own.byName.begin(), own.byName.end(), 0u);
+    std::sort(own.byName.begin(), own.byName.end(), [&](uint32_t a, uint32_t b) {
+        std::string_view na(row(a), own.nameLen[a]), nb(row(b), own.nameLen[b]);
+        return na < nb || (na == nb && a < b);
+    });
+
+    text = { own.text.data(), own.text.size() };
+    off = { own.off.data(), own.off.size() };
+    nameLen = { own.nameLen.data(), own.nameLen.size() };
+    keys = { own.keys.data(), own.keys.size() };
+    start = { own.start.data(), own.start.size() };
+    post = { own.post.data(), own.post.size() };
+    byName = { own.byName.data(), own.byName.size() };
+}
+
+// ---- Query ----
+void PlaceIndex::find(const char* q, std::vector<int>& hits, size_t limit) const {
+    hits.clear();
+    if (!q || !*q || limit == 0 || nameLen.size() == 0) return;
+
+    // scratch, kept per thread so repeated queries do not allocate
+    thread_local std::string needle;
+    thread_local std::vector<uint32_t> tris, cand;
+    thread_local std::vector<std::pair<uint32_t, uint32_t>> lists;
+    thread_local std::vector<uint64_t> ranked;
+
+    needle.clear();
+    for (const char* c = q; *c; ++c) needle.push_back(fold(*c));
+    const std::string_view nv(needle);
+
+    if (nv.size() < 3) {
+        auto name = [&](uint32_t i) { return std::string_view(text.data() + off[i], nameLen[i]); };
+        auto it = std::lower_bound(byName.begin(), byName.end(), nv,
+            [&](uint32_t i, std::string_view v) { return name(i) < v; });
+        for (; it != byName.end() && hits.size() < limit; ++it) {
+            if (name(*it).substr(0, nv.size()) != nv) break;
+            hits.push_back((int)*it);
+        }
+        return;
+    }
+
+    // Intersect the posting lists of the needle's trigrams, shortest first.
+    trigrams(needle.data(), needle.size(), tris);
+    lists.clear();
+    for (uint32_t k : tris) {
+        auto it = std::lower_bound(keys.begin(), keys.end(), k);
+        if (it == keys.end() || *it != k) return;
+        size_t s = (size_t)(it - keys.begin());
+        lists.push_back({ start[s], start[s + 1] });
+    }
+    std::sort(lists.begin(), lists.end(), [](const auto& a, const auto& b) {
+        return a.second - a.first < b.second - b.first;
+    });
+    cand.assign(post.begin() + lists[0].first, post.begin() + lists[0].second);
+    for (size_t l = 1; l < lists.size() && !cand.empty(); ++l) {
+        const uint32_t* b = post.data() + lists[l].first;
+        const uint32_t* e = post.data() + lists[l].second;
+        size_t w = 0;
+        for (uint32_t id : cand) {
+            b = gallop(b, e, id);
+            if (b == e) break;
+            if (*b == id) cand[w++] = id;
+        }
+        cand.resize(w);
+    }
+
+    // Verify and rank: (rank, name length, id) packed into one key.
+    ranked.clear();
+    for (uint32_t id : cand) {
+        std::string_view hay(text.data() + off[id], (size_t)(off[id + 1] - off[id]));
+        size_t pos = hay.find(nv);
+        if (pos == std::string_view::npos) continue;
+        const uint32_t nl = nameLen[id];
+        uint64_t rank;
+        if (pos + nv.size() > nl) rank = 4;             // admin/country
+        else if (pos == 0) rank = nv.size() == nl ? 0 : 1;
+        else rank = word_start(hay[pos - 1]) ? 2 : 3;
+        ranked.push_back(rank << 56 | (uint64_t)std::min(nl, 0xFFFFFFu) << 32 | id);
+    }
+    const size_t k = std::min(limit, ranked.size());
+    std::partial_sort(ranked.begin(), ranked.begin() + k, ranked.end());
+    for (size_t r = 0; r < k; ++r) hits.push_back((int)(uint32_t)ranked[r]);
+}
+
+// ---- Compiled gazetteer: image layout ----
+namespace {
+
+enum GazSection {
+    GZ_RECORDS, GZ_POOL,
+    GZ_TEXT, GZ_OFF, GZ_NAMELEN, GZ_KEYS, GZ_START, GZ_POST, GZ_BYNAME,
+    GZ_GEO,
+    kNumGazSections
+};
+
+const char kGazMagic[8] = { 'A', 'S', 'T', 'R', 'O', 'G', 'A', 'Z' };
+const uint32_t kGazVersion = 2;     // 2: GZ_GEO
+const uint32_t kGazByteOrder = 0x01020304;
+
+struct GazHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;       // kGazByteOrder as written by the host
+    uint64_t count;           // places
+    struct { uint64_t off, size; } sec[kNumGazSections];   // bytes from image start
+};
+
+// appends v to img at an 8-byte boundary and records it in section s
+template <class T>
+void put_section(std::vector<char>& img, int s, const T* v, size_t n) {
+    img.resize((img.size() + 7) & ~(size_t)7);
+    GazHeader h;
+    std::memcpy(&h, img.data(), sizeof h);
+    h.sec[s].off = img.size();
+    h.sec[s].size = n * sizeof(T);
+    std::memcpy(img.data(), &h, sizeof h);
+    img.insert(img.end(), (const char*)v, (const char*)v + n * sizeof(T));
+}
+
+// Every offset, length and row id the accessors follow stays inside its
+// section, and the arrays that are searched are ordered. One pass each.
+bool validate(const char* image, const GazHeader& h) {
+    auto at = [&](int s) { return image + h.sec[s].off; };
+    const uint64_t n = h.count;
+    const uint64_t poolSize = h.sec[GZ_POOL].size, textSize = h.sec[GZ_TEXT].size;
+    const uint64_t nkeys = h.sec[GZ_KEYS].size / 4, npost = h.sec[GZ_POST].size / 4;
+
+    const auto* recs = (const Gazetteer::Record*)at(GZ_RECORDS);
+    auto inPool = [&](uint32_t off, uint16_t len) { return off <= poolSize && len <= poolSize - off; };
+    for (uint64_t i = 0; i < n; ++i) {
+        const Gazetteer::Record& r = recs[i];
+        if (!inPool(r.name, r.nameLen) || !inPool(r.admin, r.adminLen) || !inPool(r.country, r.countryLen) ||
+            !inPool(r.tzid, r.tzidLen))
+            return false;
+    }
+
+    const auto* off = (const uint64_t*)at(GZ_OFF);
+    const auto* nameLen = (const uint32_t*)at(GZ_NAMELEN);
+    if (off[0] != 0 || off[n] > textSize) return false;
+    for (uint64_t i = 0; i < n; ++i)
+        if (off[i + 1] < off[i] || nameLen[i] > off[i + 1] - off[i]) return false;
+
+    const auto* keys = (const uint32_t*)at(GZ_KEYS);
+    const auto* start = (const uint32_t*)at(GZ_START);
+    if (start[0] != 0 || start[nkeys] != npost) return false;
+    for (uint64_t k = 0; k < nkeys; ++k)
+        if (start[k + 1] < start[k] || (k > 0 && keys[k] <= keys[k - 1])) return false;
+    const auto* post = (const uint32_t*)at(GZ_POST);
+    for (uint64_t k = 0; k < nkeys; ++k)
+        for (uint32_t j = start[k]; j < start[k + 1]; ++j)
+            if (post[j] >= n || (j > start[k] && post[j] <= post[j - 1])) return false;
+
+    const auto* byName = (const uint32_t*)at(GZ_BYNAME);
+    for (uint64_t i = 0; i < n; ++i)
+        if (byName[i] >= n) return false;
+
+    const auto* pts = (const GeoIndex::Point*)at(GZ_GEO);
+    for (uint64_t i = 0; i < n; ++i)
+        if (pts[i].id >= n) return false;
+    return true;
+}
+
+} // namespace
+
+bool Gazetteer::buildImage(const std::string& csvPath, std::vector<char>& img, std::string* err,
+                           std::vector<CsvError>* rowErrors) {
+    // String pool: names appended as they come, admin/country/tzid interned.
+    // Interned strings are keyed by their place in the pool, so a repeat
+    // costs a lookup and no allocation.
+    std::string pool;
+    struct Ref { uint32_t off, len; };
+    auto str = [&](Ref r) { return std::string_view(pool.data() + r.off, r.len); };
+    auto hash = [&](Ref r) { return std::hash<std::string_view>()(str(r)); };
+    auto same = [&](Ref a, Ref b) { return str(a) == str(b); };
+    std::unordered_set<Ref, decltype(hash), decltype(same)> interned(1024, hash, same);
+    std::vector<Record> recs;
+    bool full = false;
+
+    auto put = [&](std::string_view s, uint32_t& off, uint16_t& len) {
+        off = (uint32_t)pool.size();
+        len = (uint16_t)s.size();
+        pool.append(s.data(), s.size());
+    };
+    auto intern = [&](std::string_view s, uint32_t& off, uint16_t& len) {
+        Ref r{ (uint32_t)pool.size(), (uint32_t)s.size() };
+        pool.append(s.data(), s.size());
+        auto it = interned.insert(r);
+        if (!it.second) pool.resize(r.off);     // seen before: drop the copy
+        off = it.first->off;
+        len = (uint16_t)s.size();
+    };
+    auto row = [&](const PlaceRow& p) {
+        if (full) return;
+        if (p.name.size() > 0xFFFF || p.admin.size() > 0xFFFF || p.country.size() > 0xFFFF || p.tzid.size() > 0xFFFF) {
+            if (rowErrors) rowErrors->push_back({ p.line, "field longer than 65535 bytes" });
+            return;
+        }
+        if (pool.size() + p.name.size() + p.admin.size() + p.country.size() + p.tzid.size() > 0xFFFFFFFFull) {
+            full = true;
+            return;
+        }
+        Record r{};
+        put(p.name, r.name, r.nameLen);
+        intern(p.admin, r.admin, r.adminLen);
+        intern(p.country, r.country, r.countryLen);
+        intern(p.tzid, r.tzid, r.tzidLen);
+        r.lat = p.lat;
+        r.lon = p.lon;
+        recs.push_back(r);
+    };
+    if (!read_places_csv(csvPath, row, rowErrors, 0, err)) return false;
+    if (full) {
+        if (err) *err = "string pool of '" + csvPath + "' exceeds 4 GB";
+        return false;
+    }
+
+    PlaceIndex idx;
+    idx.clear(recs.size(), pool.size() + recs.size() * 2);
+    for (const Record& r : recs)
+        idx.addRow({ pool.data() + r.name, r.nameLen }, { pool.data() + r.admin, r.adminLen },
+                   { pool.data() + r.country, r.countryLen });
+    idx.indexText();
+
+    GeoIndex geo;
+    geo.own.reserve(recs.size());
+    for (size_t i = 0; i < recs.size(); ++i) geo.add((uint32_t)i, recs[i].lat, recs[i].lon);
+    geo.index();
+
+    GazHeader h{};
+    std::memcpy(h.magic, kGazMagic, sizeof h.magic);
+    h.version = kGazVersion;
+    h.byteOrder = kGazByteOrder;
+    h.count = recs.size();
+    img.assign((const char*)&h, (const char*)&h + sizeof h);
+    put_section(img, GZ_RECORDS, recs.data(), recs.size());
+    put_section(img, GZ_POOL, pool.data(), pool.size());
+    put_section(img, GZ_TEXT, idx.own.text.data(), idx.own.text.size());
+    put_section(img, GZ_OFF, idx.own.off.data(), idx.own.off.size());
+    put_section(img, GZ_NAMELEN, idx.own.nameLen.data(), idx.own.nameLen.size());
+    put_section(img, GZ_KEYS, idx.own.keys.data(), idx.own.keys.size());
+    put_section(img, GZ_START, idx.own.start.data(), idx.own.start.size());
+    put_section(img, GZ_POST, idx.own.post.data(), idx.own.post.size());
+    put_section(img, GZ_BYNAME, idx.own.byName.data(), idx.own.byName.size());
+    put_section(img, GZ_GEO, geo.own.data(), geo.own.size());
+    return true;
+}
+
+bool compile_gazetteer(const std::string& csvPath, const std::string& outPath, std::string* err,
+                       std::vector<CsvError>* rowErrors) {
+    std::vector<char> img;
+    if (!Gazetteer::buildImage(csvPath, img, err, rowErrors)) return false;
+    std::ofstream o(outPath, std::ios::binary | std::ios::trunc);
+    if (!o.write(img.data(), (std::streamsize)img.size())) {
+        if (err) *err = "cannot write '" + outPath + "'";
+        return false;
+    }
+    return true;
+}
+
+// ---- Compiled gazetteer: access ----
+bool Gazetteer::attach(const char* image, size_t len, std::string* err) {
+    auto fail = [&](const char* why) {
+        if (err) *err = why;
+        return false;
+    };
+    GazHeader h;
+    if (len < sizeof h) return fail("not a gazetteer file (too short)");
+    std::memcpy(&h, image, sizeof h);
+    if (std::memcmp(h.magic, kGazMagic, sizeof h.magic) != 0) return fail("not a gazetteer file");
+    if (h.byteOrder != kGazByteOrder) return fail("gazetteer file has the wrong byte order");
+    if (h.version != kGazVersion) return fail("unsupported gazetteer file version");
+    for (const auto& s : h.sec)
+        if (s.off % 8 != 0 || s.off > len || s.size > len - s.off) return fail("corrupt gazetteer file (section bounds)");
+
+    const uint64_t n = h.count;
+    const uint64_t nkeys = h.sec[GZ_KEYS].size / 4;
+    if (h.sec[GZ_RECORDS].size != n * sizeof(Record) || h.sec[GZ_OFF].size != (n + 1) * 8 ||
+        h.sec[GZ_NAMELEN].size != n * 4 || h.sec[GZ_BYNAME].size != n * 4 ||
+        h.sec[GZ_START].size != (nkeys + 1) * 4 || h.sec[GZ_GEO].size != n * sizeof(GeoIndex::Point))
+        return fail("corrupt gazetteer file (section sizes)");
+
+    auto at = [&](int s) { return image + h.sec[s].off; };
+    if (!validate(image, h)) return fail("corrupt gazetteer file");
+    count = (size_t)n;
+    recs = (const Record*)at(GZ_RECORDS);
+    pool = at(GZ_POOL);
+
+    idx.own = PlaceIndex::Storage{};
+    idx.text = { at(GZ_TEXT), (size_t)h.sec[GZ_TEXT].size };
+    idx.off = { (const uint64_t*)at(GZ_OFF), (size_t)n + 1 };
+    idx.nameLen = { (const uint32_t*)at(GZ_NAMELEN), (size_t)n };
+    idx.keys = { (const uint32_t*)at(GZ_KEYS), (size_t)nkeys };
+    idx.start = { (const uint32_t*)at(GZ_START), (size_t)nkeys + 1 };
+    idx.post = { (const uint32_t*)at(GZ_POST), (size_t)(h.sec[GZ_POST].size / 4) };
+    idx.byName = { (const uint32_t*)at(GZ_BYNAME), (size_t)n };
+
+    geoIdx.own.clear();
+    geoIdx.pts = (const GeoIndex::Point*)at(GZ_GEO);
+    geoIdx.n = (size_t)n;
+    return true;
+}
+
+bool Gazetteer::open(const std::string& path, std::string* err) {
+    close();
+    if (!file.open(path, err)) return false;
+    if (!attach(file.data(), file.size(), err)) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool Gazetteer::loadCsv(const std::string& path, std::string* err, std::vector<CsvError>* rowErrors) {
+    close();
+    if (!buildImage(path, mem, err, rowErrors)) return false;
+    return attach(mem.data(), mem.size(), err);
+}
+
+void Gazetteer::close() {
+    file.close();
+    mem.clear();
+    mem.shrink_to_fit();
+    recs = nullptr;
+    pool = nullptr;
+    count = 0;
+    idx = PlaceIndex{};
+    geoIdx = GeoIndex{};
+}
+
+PlaceView Gazetteer::operator[](size_t i) const {
+    const Record& r = recs[i];
+    return { { pool + r.name, r.nameLen }, { pool + r.admin, r.adminLen },
+             { pool + r.country, r.countryLen }, { pool + r.tzid, r.tzidLen }, r.lat, r.lon };
+}
+
+// "name, admin (country)"
+static std::string display_name(std::string_view name, std::string_view admin, std::string_view country) {
+    std::string s(name);
+    if (!admin.empty()) s.append(", ").append(admin);
+    if (!country.empty()) s.append(" (").append(country).append(")");
+    return s;
+}
+
+std::string PlaceView::display() const {
+    return display_name(name, admin, country);
+}
+
+std::string Place::display() const {
+    return display_name(name, adminName(), countryName());
+}
+
+// ---- CSV to Place ----
+std::vector<Place> load_places_csv(const std::string& path, std::vector<CsvError>* errors) {
+    std::vector<Place> v;
+    read_places_csv(path, [&](const PlaceRow& r) {
+        v.push_back({ std::string(r.name), place_admins().intern(r.admin), place_countries().intern(r.country),
+                      place_tzids().intern(r.tzid), r.lat, r.lon });
+    }, errors);
+    return v;
+}
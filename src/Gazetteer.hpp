@@ -1,67 +1,147 @@
 #pragma once
 #include <string>
 #include <vector>
-#include <fstream>
-#include <sstream>
 #include <algorithm>
+#include <cstdint>
+#include <string_view>
 
+#include "GeoIndex.hpp"
+#include "MappedFile.hpp"
+#include "PlaceCsv.hpp"
+#include "StringTable.hpp"
+
+// admin, country and tzid are ids into the shared place_admins(),
+// place_countries() and place_tzids() tables, resolved on use.
 struct Place {
-    std::string name, admin, country, tzid;
+    std::string name;
+    uint32_t admin{}, country{}, tzid{};
     double lat{0}, lon{0};
-    std::string display() const {
-        std::ostringstream os;
-        os << name;
-		if (!admin.empty()) os << ", " << admin;
-		if (!country.empty()) os << " (" << country << ")";
-		return os.str();
-    }
+
+    std::string_view adminName() const { return place_admins().str(admin); }
+    std::string_view countryName() const { return place_countries().str(country); }
+    std::string_view tzidName() const { return place_tzids().str(tzid); }
+    std::string display() const;
+};
+
+// Reads a places CSV (see PlaceCsv.hpp) into owning Places. Bad rows are
+// skipped and reported in errors; empty if the file cannot be read.
+std::vector<Place> load_places_csv(const std::string& path, std::vector<CsvError>* errors = nullptr);
+
+class Gazetteer;
+
+// ---- Search index ----
+// Built once from the loaded places. Each row's "name,admin country" text
+// is ASCII-lowercased into one buffer, and every distinct trigram of it gets
+// a posting list of row ids. A query of 3+ bytes intersects the posting
+// lists of its trigrams, verifies the survivors against the folded text and
+// ranks them: exact name, name prefix, word in name, inside name, then
+// admin/country; shorter names first. Shorter queries are name prefixes,
+// answered from a name-sorted row list. Queries allocate nothing per row.
+// A compiled gazetteer file carries the index, which is then used in place.
+class PlaceIndex {
+public:
+    PlaceIndex() = default;
+    explicit PlaceIndex(const std::vector<Place>& all) { build(all); }
+    PlaceIndex(const PlaceIndex&) = delete;
+    PlaceIndex& operator=(const PlaceIndex&) = delete;
+    PlaceIndex(PlaceIndex&&) = default;
+    PlaceIndex& operator=(PlaceIndex&&) = default;
+
+    void build(const std::vector<Place>& all);
+    void build(const Gazetteer& gaz);
+
+    // Indices into the rows given to build(), best match first.
+    void find(const char* q, std::vector<int>& hits, size_t limit = 1000) const;
+
+    size_t size() const { return nameLen.size(); }
+
+private:
+    friend class Gazetteer;
+
+    template <class T> struct Span {
+        const T* p{};
+        size_t n{};
+        const T* data() const { return p; }
+        const T* begin() const { return p; }
+        const T* end() const { return p + n; }
+        size_t size() const { return n; }
+        const T& operator[](size_t i) const { return p[i]; }
+    };
+
+    // Owned arrays after build(); empty when the index lives in a mapped file.
+    struct Storage {
+        std::vector<char> text;
+        std::vector<uint64_t> off;
+        std::vector<uint32_t> nameLen, keys, start, post, byName;
+    } own;
+
+    Span<char> text;          // folded "name,admin country" of all rows
+    Span<uint64_t> off;       // row i is text[off[i], off[i+1])
+    Span<uint32_t> nameLen;   // folded name length per row
+    Span<uint32_t> keys;      // distinct trigrams, sorted
+    Span<uint32_t> start;     // keys[k] posts post[start[k], start[k+1])
+    Span<uint32_t> post;      // row ids, ascending per trigram
+    Span<uint32_t> byName;    // row ids sorted by folded name
+
+    void clear(size_t rows, size_t bytes);
+    void addRow(std::string_view name, std::string_view admin, std::string_view country);
+    void indexText();         // postings and name order from own.text/off/nameLen
+};
+
+// ---- Compiled gazetteer ----
+// A read-only image of the place table: a header with a section table,
+// fixed-width records, one string pool (admin, country and tzid strings
+// deduplicated), the PlaceIndex arrays and the GeoIndex tree. Gazetteer::open() maps the file,
+// checks every offset and row id in it once, and serves string_views
+// straight out of the mapping, so a planet-sized file costs page cache
+// rather than heap. A damaged file is rejected rather than read out of bounds.
+// loadCsv() builds the same image in memory for small CSV files.
+// The image is host-endian; open() rejects files of the other byte order.
+
+struct PlaceView {
+    std::string_view name, admin, country, tzid;
+    double lat{0}, lon{0};
+    std::string display() const;
+};
+
+class Gazetteer {
+public:
+    Gazetteer() = default;
+    ~Gazetteer() { close(); }
+    Gazetteer(const Gazetteer&) = delete;
+    Gazetteer& operator=(const Gazetteer&) = delete;
+
+    bool open(const std::string& path, std::string* err = nullptr);
+    bool loadCsv(const std::string& path, std::string* err = nullptr, std::vector<CsvError>* rowErrors = nullptr);
+    void close();
+
+    size_t size() const { return count; }
+    PlaceView operator[](size_t i) const;
+    const PlaceIndex& index() const { return idx; }
+    const GeoIndex& geo() const { return geoIdx; }
+
+    struct Record {                   // 32 bytes
+        uint32_t name, admin, country, tzid;                  // pool offsets
+        uint16_t nameLen, adminLen, countryLen, tzidLen;
+        double lat, lon;
+    };
+
+private:
+    MappedFile file;                  // image of open()
+    std::vector<char> mem;            // image of loadCsv()
+    const Record* recs{};
+    const char* pool{};
+    size_t count{};
+    PlaceIndex idx;
+    GeoIndex geoIdx;
+
+    bool attach(const char* image, size_t len, std::string* err);
+    static bool buildImage(const std::string& csvPath, std::vector<char>& img, std::string* err,
+                           std::vector<CsvError>* rowErrors);
+    friend bool compile_gazetteer(const std::string&, const std::string&, std::string*, std::vector<CsvError>*);
 };
 
-static std::vector<std::string> split_csv(const std::string& s) {
-    std::vector<std::string> out; std::string cur;
-    for (char c : s) {
-        if (c == ',') {
-            out.push_back(cur);
-            cur.clear();
-        }
-        else cur.push_back(c);
-    }
-    out.push_back(cur);
-    return out;
-}
-
-static std::vector<Place> load_places_csv(const std::string& path) {
-    std::vector<Place> v;
-    std::ifstream f(path);
-    if (!f) return v;
-    std::string line;
-    // skip header
-    std::getline(f, line);
-    while (std::getline(f, line)) {
-        if (line.empty()) continue;
-		auto cols = split_csv(line);
-		if (cols.size() < 6) continue;
-		Place p;
-		p.name = cols[0];
-		p.admin = cols[1];
-		p.country = cols[2];
-		p.lat = std::stod(cols[3]); // south = negative
-		p.lon = std::stod(cols[4]); // west = negative
-		p.tzid = cols[5];
-        v.push_back(p);
-    }
-    return v;
-}
-
-inline void find_places(const std::vector<Place>& all, const char* q, std::vector<int>& hits) {
-    hits.clear();
-    if (!q || !*q) return;
-    std::string needle = q;
-	std::transform(needle.begin(), needle.end(), needle.begin(), ::tolower);
-    for (int i = 0; i < (int)all.size(); ++i) {
-		std::string hay = all[i].name + "," + all[i].admin + " " + all[i].country;
-		std::transform(hay.begin(), hay.end(), hay.begin(), ::tolower);
-        if (hay.find(needle) != std::string::npos) hits.push_back(i);
-		if ((int)hits.size() >= 1000) break; // limit
-    }
-}
+// CSV (name,admin,country,lat,lon,tzid with a header line) -> compiled file.
+// Rows that cannot be stored are skipped and reported in rowErrors.
+bool compile_gazetteer(const std::string& csvPath, const std::string& outPath, std::string* err = nullptr,
+                       std::vector<CsvError>* rowErrors = nullptr);
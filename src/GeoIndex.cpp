@@ -0,0 +1,177 @@
+// GeoIndex.cpp — implicit k-d tree over places on the unit sphere (C++17)
+
+#include "GeoIndex.hpp"
+#include "Gazetteer.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <thread>
+
+namespace {
+
+const double kEarthKm = 6371.0088;                       // mean radius
+const double kDegToRad = 3.14159265358979323846 / 180.0;
+
+struct Vec { double x, y, z; };
+
+inline Vec unit(double lat, double lon) {
+    const double la = lat * kDegToRad, lo = lon * kDegToRad;
+    return { std::cos(la) * std::cos(lo), std::cos(la) * std::sin(lo), std::sin(la) };
+}
+
+inline double coord(const GeoIndex::Point& p, int d) { return d == 0 ? p.x : d == 1 ? p.y : p.z; }
+inline double coord(const Vec& v, int d) { return d == 0 ? v.x : d == 1 ? v.y : v.z; }
+
+inline double chord2(const Vec& q, const GeoIndex::Point& p) {
+    const double dx = q.x - p.x, dy = q.y - p.y, dz = q.z - p.z;
+    return dx * dx + dy * dy + dz * dz;
+}
+
+inline double chord2_to_km(double c2) {
+    return 2.0 * kEarthKm * std::asin(std::min(1.0, std::sqrt(c2) * 0.5));
+}
+
+// While searching, GeoHit::km holds the squared chord.
+inline bool closer(const GeoHit& a, const GeoHit& b) {
+    return a.km < b.km || (a.km == b.km && a.id < b.id);
+}
+
+// Orders [b, e) so that the middle element splits on axis depth % 3.
+void order(GeoIndex::Point* b, GeoIndex::Point* e, int depth) {
+    while (e - b > 1) {
+        GeoIndex::Point* m = b + (e - b) / 2;
+        const int d = depth % 3;
+        std::nth_element(b, m, e, [d](const GeoIndex::Point& p, const GeoIndex::Point& q) {
+            double a = coord(p, d), c = coord(q, d);
+            return a < c || (a == c && p.id < q.id);
+        });
+        order(b, m, depth + 1);
+        b = m + 1;
+        ++depth;
+    }
+}
+
+// k nearest: h is a max-heap on (squared chord, id) of at most k hits.
+void knn(const GeoIndex::Point* b, const GeoIndex::Point* e, int depth, const Vec& q, size_t k,
+         std::vector<GeoHit>& h) {
+    while (b < e) {
+        const GeoIndex::Point* m = b + (e - b) / 2;
+        GeoHit c{ m->id, chord2(q, *m) };
+        if (h.size() < k) {
+            h.push_back(c);
+            std::push_heap(h.begin(), h.end(), closer);
+        } else if (closer(c, h.front())) {
+            std::pop_heap(h.begin(), h.end(), closer);
+            h.back() = c;
+            std::push_heap(h.begin(), h.end(), closer);
+        }
+        const double diff = coord(q, depth % 3) - coord(*m, depth % 3);
+        const GeoIndex::Point *nb = b, *ne = m, *fb = m + 1, *fe = e;
+        if (diff >= 0) {
+            std::swap(nb, fb);
+            std::swap(ne, fe);
+        }
+        knn(nb, ne, depth + 1, q, k, h);
+        if (h.size() == k && diff * diff > h.front().km) return;
+        b = fb;
+        e = fe;
+        ++depth;
+    }
+}
+
+void radius(const GeoIndex::Point* b, const GeoIndex::Point* e, int depth, const Vec& q, double c2max,
+            std::vector<GeoHit>& out) {
+    while (b < e) {
+        const GeoIndex::Point* m = b + (e - b) / 2;
+        const double c2 = chord2(q, *m);
+        if (c2 <= c2max) out.push_back({ m->id, c2 });
+        const double diff = coord(q, depth % 3) - coord(*m, depth % 3);
+        const GeoIndex::Point *nb = b, *ne = m, *fb = m + 1, *fe = e;
+        if (diff >= 0) {
+            std::swap(nb, fb);
+            std::swap(ne, fe);
+        }
+        radius(nb, ne, depth + 1, q, c2max, out);
+        if (diff * diff > c2max) return;
+        b = fb;
+        e = fe;
+        ++depth;
+    }
+}
+
+// squared-chord hits -> km, nearest first
+void finish(std::vector<GeoHit>& out) {
+    std::sort(out.begin(), out.end(), closer);
+    for (auto& h : out) h.km = chord2_to_km(h.km);
+}
+
+} // namespace
+
+// ---- Build ----
+void GeoIndex::add(uint32_t id, double lat, double lon) {
+    Vec v = unit(lat, lon);
+    own.push_back({ (float)v.x, (float)v.y, (float)v.z, id });
+}
+
+void GeoIndex::index() {
+    order(own.data(), own.data() + own.size(), 0);
+    pts = own.data();
+    n = own.size();
+}
+
+void GeoIndex::build(const std::vector<Place>& all) {
+    own.clear();
+    own.reserve(all.size());
+    for (size_t i = 0; i < all.size(); ++i) add((uint32_t)i, all[i].lat, all[i].lon);
+    index();
+}
+
+void GeoIndex::build(const Gazetteer& gaz) {
+    own.clear();
+    own.reserve(gaz.size());
+    for (size_t i = 0; i < gaz.size(); ++i) {
+        PlaceView v = gaz[i];
+        add((uint32_t)i, v.lat, v.lon);
+    }
+    index();
+}
+
+// ---- Query ----
+void GeoIndex::nearest(double lat, double lon, size_t k, std::vector<GeoHit>& out) const {
+    out.clear();
+    if (k == 0 || !std::isfinite(lat) || !std::isfinite(lon)) return;
+    knn(pts, pts + n, 0, unit(lat, lon), k, out);
+    finish(out);
+}
+
+void GeoIndex::within(double lat, double lon, double km, std::vector<GeoHit>& out) const {
+    out.clear();
+    if (!(km >= 0) || !std::isfinite(lat) || !std::isfinite(lon)) return;
+    const double half = km / kEarthKm * 0.5;
+    const double c = half >= 3.14159265358979323846 * 0.5 ? 2.0 : 2.0 * std::sin(half);
+    radius(pts, pts + n, 0, unit(lat, lon), c * c, out);
+    finish(out);
+}
+
+void GeoIndex::nearestBatch(const double* lat, const double* lon, size_t count, GeoHit* out, unsigned threads) const {
+    const size_t kBlock = 1024;
+    std::atomic<size_t> next{ 0 };
+    auto work = [&] {
+        std::vector<GeoHit> h;
+        h.reserve(1);
+        for (size_t b; (b = next.fetch_add(kBlock)) < count;) {
+            for (size_t i = b, e = std::min(count, b + kBlock); i < e; ++i) {
+                nearest(lat[i], lon[i], 1, h);
+                out[i] = h.empty() ? GeoHit{ kNoPlace, std::numeric_limits<double>::infinity() } : h[0];
+            }
+        }
+    };
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = (unsigned)std::min<size_t>(threads, (count + kBlock - 1) / kBlock);
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < threads; ++t) pool.emplace_back(work);
+    work();
+    for (auto& t : pool) t.join();
+}
@@ -0,0 +1,59 @@
+#pragma once
+// GeoIndex.hpp — nearest-place lookup by coordinates (C++17)
+//
+// Places are points on the unit sphere in an implicit k-d tree: one array,
+// ordered so that the middle element of every range splits it on x, y or z
+// by depth. No node pointers, so the array can live in a mapped gazetteer
+// file as-is. Straight-line (chord) distance in 3D orders points exactly as
+// great-circle distance does, so queries work in 3D and convert to km at the
+// end. Coordinates are floats: distances are good to about a metre.
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct Place;
+class Gazetteer;
+
+struct GeoHit {
+    uint32_t id;    // row in the gazetteer, kNoPlace if the index is empty
+    double km;      // great-circle distance
+};
+
+static const uint32_t kNoPlace = 0xFFFFFFFFu;
+
+class GeoIndex {
+public:
+    struct Point { float x, y, z; uint32_t id; };
+
+    GeoIndex() = default;
+    GeoIndex(const GeoIndex&) = delete;
+    GeoIndex& operator=(const GeoIndex&) = delete;
+    GeoIndex(GeoIndex&&) = default;
+    GeoIndex& operator=(GeoIndex&&) = default;
+
+    void build(const std::vector<Place>& all);
+    void build(const Gazetteer& gaz);
+
+    // The k rows nearest to (lat, lon), nearest first.
+    void nearest(double lat, double lon, size_t k, std::vector<GeoHit>& out) const;
+
+    // All rows within km of (lat, lon), nearest first.
+    void within(double lat, double lon, double km, std::vector<GeoHit>& out) const;
+
+    // out[i] = nearest row to (lat[i], lon[i]), spread over `threads` threads
+    // (0 = all cores).
+    void nearestBatch(const double* lat, const double* lon, size_t n, GeoHit* out, unsigned threads = 0) const;
+
+    size_t size() const { return n; }
+
+private:
+    friend class Gazetteer;
+
+    std::vector<Point> own;   // after build(); empty when mapped
+    const Point* pts{};
+    size_t n{};
+
+    void add(uint32_t id, double lat, double lon);
+    void index();             // orders own into the tree
+};
@@ -0,0 +1,114 @@
+#pragma once
+// LatencyHistogram.hpp — lock-free log-linear histogram for latencies and sizes (C++17)
+//
+// Values below 16 get a bucket each; above that every power of two is split
+// into 8 buckets, so a quantile read back is within 12.5% of the recorded
+// values while the whole 64-bit range fits in 496 counters. record() is a
+// relaxed atomic increment and may be called from any thread. Readers see
+// each counter exactly but not a snapshot across counters, which is what
+// monitoring needs.
+
+#include <atomic>
+#include <charconv>
+#include <cstdint>
+#include <string>
+
+class LatencyHistogram {
+public:
+    static constexpr int kBuckets = 16 + 60 * 8;
+
+    LatencyHistogram() { reset(); }
+    LatencyHistogram(const LatencyHistogram&) = delete;
+    LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+    void record(uint64_t v) {
+        counts[bucket(v)].fetch_add(1, std::memory_order_relaxed);
+        n.fetch_add(1, std::memory_order_relaxed);
+        total.fetch_add(v, std::memory_order_relaxed);
+        uint64_t m = hi.load(std::memory_order_relaxed);
+        while (v > m && !hi.compare_exchange_weak(m, v, std::memory_order_relaxed)) {}
+    }
+
+    void merge(const LatencyHistogram& o) {
+        for (int b = 0; b < kBuckets; ++b)
+            counts[b].fetch_add(o.counts[b].load(std::memory_order_relaxed), std::memory_order_relaxed);
+        n.fetch_add(o.count(), std::memory_order_relaxed);
+        total.fetch_add(o.sum(), std::memory_order_relaxed);
+        const uint64_t v = o.max();
+        uint64_t m = hi.load(std::memory_order_relaxed);
+        while (v > m && !hi.compare_exchange_weak(m, v, std::memory_order_relaxed)) {}
+    }
+
+    void reset() {
+        for (auto& c : counts) c.store(0, std::memory_order_relaxed);
+        n.store(0, std::memory_order_relaxed);
+        total.store(0, std::memory_order_relaxed);
+        hi.store(0, std::memory_order_relaxed);
+    }
+
+    uint64_t count() const { return n.load(std::memory_order_relaxed); }
+    uint64_t sum() const { return total.load(std::memory_order_relaxed); }
+    uint64_t max() const { return hi.load(std::memory_order_relaxed); }
+    double mean() const { return count() ? (double)sum() / (double)count() : 0.0; }
+
+    // The q-quantile (0..1): the middle of the bucket holding that rank,
+    // never above max().
+    uint64_t quantile(double q) const {
+        uint64_t c = 0;
+        for (int b = 0; b < kBuckets; ++b) c += counts[b].load(std::memory_order_relaxed);
+        if (c == 0) return 0;
+        uint64_t rank = (uint64_t)(q * (double)c + 0.5);
+        if (rank < 1) rank = 1;
+        if (rank > c) rank = c;
+        uint64_t seen = 0;
+        for (int b = 0; b < kBuckets; ++b) {
+            seen += counts[b].load(std::memory_order_relaxed);
+            if (seen >= rank) {
+                const uint64_t v = lower(b) + width(b) / 2;
+                return v < max() ? v : max();
+            }
+        }
+        return max();
+    }
+
+    // {"count":N,"mean":..,"p50":..,"p90":..,"p99":..,"p999":..,"max":..},
+    // every value divided by `unit` (1000 turns ns into us).
+    void json(std::string& out, double unit = 1.0) const {
+        auto num = [&](double v) {
+            char b[32];
+            out.append(b, std::to_chars(b, b + sizeof(b), v).ptr);
+        };
+        out.append("{\"count\":").append(std::to_string(count()));
+        out.append(",\"mean\":"); num(round3(mean() / unit));
+        static const struct { const char* key; double q; } kQs[] = {
+            { "p50", 0.50 }, { "p90", 0.90 }, { "p99", 0.99 }, { "p999", 0.999 } };
+        for (const auto& k : kQs) {
+            out.append(",\"").append(k.key).append("\":");
+            num(round3((double)quantile(k.q) / unit));
+        }
+        out.append(",\"max\":"); num(round3((double)max() / unit));
+        out.push_back('}');
+    }
+
+private:
+    std::atomic<uint64_t> counts[kBuckets];
+    std::atomic<uint64_t> n, total, hi;
+
+    static int log2(uint64_t v) {
+        int e = 0;
+        while (v >>= 1) ++e;
+        return e;
+    }
+    static int bucket(uint64_t v) {
+        if (v < 16) return (int)v;
+        const int e = log2(v);
+        return 16 + (e - 4) * 8 + (int)(v >> (e - 3) & 7);
+    }
+    static uint64_t lower(int b) {
+        if (b < 16) return (uint64_t)b;
+        const int e = 4 + (b - 16) / 8;
+        return (uint64_t)(8 + (b - 16) % 8) << (e - 3);
+    }
+    static uint64_t width(int b) { return b < 16 ? 1 : (uint64_t)1 << ((b - 16) / 8 + 1); }
+    static double round3(double v) { return (double)(int64_t)(v * 1000.0 + 0.5) / 1000.0; }
+};
@@ -1,4 +1,11 @@
-// Main.cpp  v2 console app with a reusable AstrologyChart class (C++17)
+// Main.cpp — console app: one chart, or a streaming batch job over ChartPool (C++17)
+//
+// Batch mode reads births (CSV or NDJSON, see ChartIO.hpp) from a file or
+// stdin and writes one result per input line to stdout, in input order.
+// Three stages overlap: a reader thread parses lines into blocks, the main
+// thread computes each block on the ChartPool workers, and a writer thread
+// formats and writes it. A fixed set of blocks circulates through bounded
+// queues, so memory does not grow with the input.
 
 #define WIN32_LEAN_AND_MEAN
 #define NOMINMAX
@@ -12,174 +19,323 @@
 // #define _CRT_SECURE_NO_WARNINGS
 #ifdef _WIN32
 #include <windows.h>
+#include <fcntl.h>
+#include <io.h>
 #endif
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
 #include <iostream>
-#include <iomanip>
-#include <sstream>
+#include <memory>
 #include <string>
-#include <vector>
-#include <cmath>
 #include <filesystem>
+#include <thread>
+#include <vector>
 
-extern "C" {
-#include "swephexp.h"
-}
+#include "AstrologyChart.hpp"
+#include "BoundedQueue.hpp"
+#include "ChartIO.hpp"
+#include "ChartPool.hpp"
+#include "DateTime.hpp"
+#include "EpheStats.hpp"
+#include "TimeZones.hpp"
+#include "Trace.hpp"
 
 // ---- Config ----
-static const char* EPHE_PATH = "C:/Users/Admin/source/repos/Astrology/data/ephe"; // or "../../data/ephe"
-
-// ---- Helpers ----
-static inline double norm360(double x) { double y = fmod(x, 360.0); if (y < 0) y += 360.0; return y; }
-
-struct DMS { int deg; int min; double sec; };
-static DMS toDMS(double degrees) {
-    double d = std::floor(degrees);
-    double mfull = (degrees - d) * 60.0;
-    double m = std::floor(mfull);
-    double s = (mfull - m) * 60.0;
-    return { (int)d, (int)m, s };
+static const char* kDefaultEphePath = "data/ephe";     // relative to the working directory
+static const size_t kBlocks = 4;                        // blocks in flight: read, compute, write + 1
+
+static void usage() {
+    std::cerr <<
+        "usage: astrology [options] [input|-]\n"
+        "       astrology --chart \"YYYY-MM-DD HH:MM[:SS]\" --lat DEG --lon DEG [options]\n"
+        "\n"
+        "Batch mode reads births from input (default stdin) and writes one chart per\n"
+        "line to stdout, in input order. Input fields: id, datetime | jd, lat, lon,\n"
+        "hsys, tz (CSV needs a header line naming them).\n"
+        "\n"
+        "  --ephe PATH      ephemeris directory (default $SE_EPHE_PATH, else data/ephe)\n"
+        "  --in FORMAT      csv | ndjson (default from the file extension, else csv)\n"
+        "  --out FORMAT     csv | ndjson | bin (default csv)\n"
+        "  --hsys C         house system for rows without one (default P)\n"
+        "  --bodies LIST    all, or keys such as sun,moon,mercury,node (default all)\n"
+        "  --threads N      chart workers (default: all cores)\n"
+        "  --block N        charts per block (default 4096)\n"
+        "  --pin            pin workers to cores\n"
+        "  --ephe-mmap      read the ephemeris files through memory mappings\n"
+        "  --warmup FROM-TO before reading input, decode the ephemeris segments for\n"
+        "                   the years FROM..TO (e.g. 1900-2100) and compile the time\n"
+        "                   zones on all workers\n"
+        "  --trace FILE     write a Chrome trace (open in ui.perfetto.dev) of the\n"
+        "                   parse / compute / format stages to FILE\n"
+        "  --ephe-stats     print ephemeris counters as JSON to stderr at exit\n"
+        "                   (needs a -DASTRO_SWE_INSTRUMENT=ON build)\n"
+        "  --ascii          'deg' instead of the degree sign (--chart)\n";
 }
 
-static const char* SIGN_NAMES[12] = {
-  "Aries","Taurus","Gemini","Cancer","Leo","Virgo",
-  "Libra","Scorpio","Sagittarius","Capricorn","Aquarius","Pisces"
+struct Options {
+    std::string ephe, input = "-", chart, trace;
+    bool inSet{}, pin{}, ascii{}, epheStats{}, epheMmap{};
+    InputFormat in{ InputFormat::Csv };
+    OutputFormat out{ OutputFormat::Csv };
+    char hsys{ 'P' };
+    BodySet bodies{ kAllBodies };
+    unsigned threads{};
+    size_t block{ 4096 };
+    double lat{}, lon{};
+    bool haveLat{}, haveLon{};
+    bool warmup{};
+    double warmFrom{}, warmTo{};
 };
 
-static std::string fmtLongitude(double lon, bool asciiDegrees = false) {
-    lon = norm360(lon);
-    int signIdx = (int)(lon / 30.0) % 12;
-    double within = fmod(lon, 30.0);
-    auto dms = toDMS(within);
-    std::ostringstream os;
-    os << SIGN_NAMES[signIdx] << " "
-        << dms.deg << (asciiDegrees ? " deg " : u8" ") << std::setfill('0')
-        << std::setw(2) << dms.min << "' "
-        << std::fixed << std::setprecision(2) << dms.sec << "\"";
-    return os.str();
+static bool parse_args(int argc, char** argv, Options& o) {
+    auto num = [](const char* s, double& v) {
+        char* end;
+        v = std::strtod(s, &end);
+        return *s && !*end;
+    };
+    for (int i = 1; i < argc; ++i) {
+        const std::string a = argv[i];
+        const bool hasValue = i + 1 < argc;
+        std::string err;
+        if (a == "-h" || a == "--help") return false;
+        else if (a == "--pin") o.pin = true;
+        else if (a == "--ascii") o.ascii = true;
+        else if (a == "--ephe-stats") o.epheStats = true;
+        else if (a == "--ephe-mmap") o.epheMmap = true;
+        else if (a[0] == '-' && a.size() > 1 && !hasValue) {
+            std::cerr << "missing value for " << a << "\n";
+            return false;
+        }
+        else if (a == "--ephe") o.ephe = argv[++i];
+        else if (a == "--chart") o.chart = argv[++i];
+        else if (a == "--trace") o.trace = argv[++i];
+        else if (a == "--in") {
+            o.inSet = true;
+            if (!parse_input_format(argv[++i], o.in)) { std::cerr << "bad --in " << argv[i] << "\n"; return false; }
+        }
+        else if (a == "--out") {
+            if (!parse_output_format(argv[++i], o.out)) { std::cerr << "bad --out " << argv[i] << "\n"; return false; }
+        }
+        else if (a == "--hsys") {
+            const char* v = argv[++i];
+            if (std::strlen(v) != 1) { std::cerr << "bad --hsys " << v << "\n"; return false; }
+            o.hsys = v[0];
+        }
+        else if (a == "--bodies") {
+            if (!parse_body_set(argv[++i], o.bodies, &err)) { std::cerr << "bad --bodies: " << err << "\n"; return false; }
+        }
+        else if (a == "--warmup") {
+            if (!(o.warmup = parse_year_window(argv[++i], o.warmFrom, o.warmTo, &err))) { std::cerr << "bad --warmup: " << err << "\n"; return false; }
+        }
+        else if (a == "--threads") o.threads = (unsigned)std::strtoul(argv[++i], nullptr, 10);
+        else if (a == "--block") o.block = std::max<size_t>(1, std::strtoull(argv[++i], nullptr, 10));
+        else if (a == "--lat") {
+            if (!(o.haveLat = num(argv[++i], o.lat))) { std::cerr << "bad --lat\n"; return false; }
+        }
+        else if (a == "--lon") {
+            if (!(o.haveLon = num(argv[++i], o.lon))) { std::cerr << "bad --lon\n"; return false; }
+        }
+        else if (a[0] == '-' && a.size() > 1) {
+            std::cerr << "unknown option " << a << "\n";
+            return false;
+        }
+        else o.input = a;
+    }
+    if (!o.inSet && o.input != "-") {
+        const std::string ext = std::filesystem::path(o.input).extension().string();
+        if (ext == ".ndjson" || ext == ".jsonl") o.in = InputFormat::Ndjson;
+    }
+    if (o.ephe.empty()) {
+        const char* env = std::getenv("SE_EPHE_PATH");
+        o.ephe = env && *env ? env : kDefaultEphePath;
+    }
+    return true;
 }
 
-// strict UTC parser: "YYYY-MM-DD HH:MM[:SS]"
-static bool parseUtcDateTime(const std::string& s, int& year, int& month, int& day, double& hour) {
-    if (s.size() < 16) return false;
-    try {
-        year = std::stoi(s.substr(0, 4));
-        month = std::stoi(s.substr(5, 2));
-        day = std::stoi(s.substr(8, 2));
-        int h = std::stoi(s.substr(11, 2));
-        int m = std::stoi(s.substr(14, 2));
-        double sec = 0.0;
-        if (s.size() >= 19) sec = std::stod(s.substr(17));
-        hour = h + m / 60.0 + sec / 3600.0;
-        return true;
+// ---- Single chart ----
+static int run_chart(const Options& o) {
+    int Y, M, D;
+    double hour;
+    if (!parseUtcDateTime(o.chart, Y, M, D, hour)) {
+        std::cerr << "bad --chart datetime '" << o.chart << "'\n";
+        return 1;
     }
-    catch (...) { return false; }
+    if (!o.haveLat || !o.haveLon) {
+        std::cerr << "--chart needs --lat and --lon\n";
+        return 1;
+    }
+    swe_set_ephe_path(o.ephe.c_str());
+    AstrologyChart chart(Y, M, D, hour, o.lat, o.lon, o.hsys);
+    chart.compute();
+    chart.print(o.ascii);
+    return 0;
 }
 
-// ---- Core data ----
-struct Body {
-    std::string name;
-    double lon{};
-    double lat{};
-    double speed{};
-    bool retro{};
-};
+// ---- Batch ----
+struct Block {
+    static constexpr size_t kNoSlot = (size_t)-1;
 
-struct Houses {
-    double cusps[13]{}; // 1..12
-    double ascmc[10]{}; // [SE_ASC], [SE_MC], ...
+    size_t n{};
+    std::vector<BirthInput> rows;
+    std::vector<size_t> slot;               // batch index of each row, or kNoSlot
+    std::vector<std::pair<size_t, std::string>> badRows;   // (row, parse error), by row
+    ChartBatch batch;
+    std::string out;
+
+    explicit Block(BodySet bodies) : batch(SEFLG_SWIEPH | SEFLG_SPEED, bodies) {}
 };
 
-// ---- AstrologyChart class ----
-class AstrologyChart {
-public:
-    AstrologyChart(int Y, int M, int D, double hour_utc, double lat_deg, double lon_deg, char house = 'P')
-        : Y(Y), M(M), D(D), hour(hour_utc), lat(lat_deg), lon(lon_deg), hsys(house) {
-        jd_ut = swe_julday(Y, M, D, hour, SE_GREG_CAL);
+static int run_batch(const Options& o) {
+    std::ifstream file;
+    std::istream* in = &std::cin;
+    if (o.input != "-") {
+        file.open(o.input, std::ios::binary);
+        if (!file) {
+            std::cerr << "cannot open " << o.input << "\n";
+            return 1;
+        }
+        in = &file;
     }
+#ifdef _WIN32
+    _setmode(_fileno(stdout), _O_BINARY);
+#endif
+    std::ios::sync_with_stdio(false);
 
-    void compute() { computePlanets(); computeHouses(); }
-
-    void print(bool asciiDegrees = false) const {
-        std::cout << "Planets:\n";
-        for (const auto& b : bodies) {
-            std::cout << std::left << std::setw(11) << b.name
-                << fmtLongitude(b.lon, asciiDegrees)
-                << (b.retro ? " [R]" : "") << "\n";
-        }
-        std::cout << "\nHouses (" << houseName() << "):\n";
-        for (int i = 1; i <= 12; ++i) {
-            std::cout << "House " << std::setw(2) << i << ": "
-                << fmtLongitude(H.cusps[i], asciiDegrees) << "\n";
+    namespace fs = std::filesystem;
+    fs::path ephe = o.ephe;
+    if (!ephe.is_absolute()) ephe = fs::weakly_canonical(fs::current_path() / ephe);
+    ChartPool pool(ephe.string(), o.threads, o.pin);
+    if (o.warmup) {
+        const auto w0 = std::chrono::steady_clock::now();
+        std::string err;
+        const size_t positions = pool.warmup(o.warmFrom, o.warmTo, o.bodies, &err);
+        if (!err.empty()) {
+            std::cerr << "warmup: " << err << "\n";
+            return 1;
         }
-        std::cout << "\nAscendant: " << fmtLongitude(norm360(H.ascmc[SE_ASC]), asciiDegrees) << "\n";
-        std::cout << "Midheaven: " << fmtLongitude(norm360(H.ascmc[SE_MC]), asciiDegrees) << "\n";
+        const size_t zones = tz_database().preload(pool.threads());
+        std::cerr << "warmup: " << positions << " positions, " << zones << " zones in "
+            << std::chrono::duration<double>(std::chrono::steady_clock::now() - w0).count() << " s\n";
     }
 
-    const std::vector<Body>& getBodies() const { return bodies; }
-    const Houses& getHouses() const { return H; }
-    double getJulianDayUT() const { return jd_ut; }
+    std::vector<std::unique_ptr<Block>> blocks;
+    BoundedQueue<Block*> freeQ(kBlocks), computeQ(kBlocks), writeQ(kBlocks);
+    for (size_t k = 0; k < kBlocks; ++k) {
+        blocks.push_back(std::make_unique<Block>(o.bodies));
+        blocks.back()->rows.resize(o.block);
+        blocks.back()->slot.resize(o.block);
+        blocks.back()->batch.reserve(o.block);
+        freeQ.push(blocks.back().get());
+    }
 
-private:
-    int Y, M, D;
-    double hour, lat, lon;
-    char hsys;
-    double jd_ut{};
-    std::vector<Body> bodies;
-    Houses H{};
-
-    const char* houseName() const {
-        switch (hsys) {
-        case 'P': return "Placidus";
-        case 'W': return "Whole Sign";
-        case 'E': return "Equal";
-        case 'K': return "Koch";
-        default:  return "Custom";
+    std::atomic<uint64_t> charts{ 0 }, failed{ 0 };
+    std::atomic<bool> fatal{ false };
+    std::string fatalMsg;
+
+    // reader: lines -> blocks
+    std::thread reader([&] {
+        trace_thread_name("reader");
+        BirthParser parser(o.in, o.hsys);
+        std::string line, err;
+        uint64_t lineNo = 0;
+        bool eof = false;
+        Block* b;
+        while (!eof && freeQ.pop(b)) {
+            b->n = 0;
+            b->badRows.clear();
+            b->batch.clear();
+            while (b->n < o.block) {
+                if (!std::getline(*in, line)) {
+                    eof = true;
+                    break;
+                }
+                ++lineNo;
+                if (line.find_first_not_of(" \t\r") == std::string::npos) continue;
+                if (parser.needsHeader()) {
+                    if (!parser.header(line, &err)) {
+                        fatalMsg = "line " + std::to_string(lineNo) + ": " + err;
+                        fatal = true;
+                        eof = true;
+                        break;
+                    }
+                    continue;
+                }
+                const size_t k = b->n++;
+                BirthInput& r = b->rows[k];
+                if (parser.parse(line, r, &err)) {
+                    b->slot[k] = b->batch.add(r.jd, r.lat, r.lon, r.hsys);
+                } else {
+                    b->slot[k] = Block::kNoSlot;
+                    b->badRows.push_back({ k, "line " + std::to_string(lineNo) + ": " + err });
+                }
+            }
+            if (b->n) computeQ.push(b);
+            else freeQ.push(b);
         }
-    }
+        computeQ.close();
+    });
 
-    void computePlanets() {
-        static const int kBodies[] = {
-          SE_SUN, SE_MOON, SE_MERCURY, SE_VENUS, SE_MARS,
-          SE_JUPITER, SE_SATURN, SE_URANUS, SE_NEPTUNE, SE_PLUTO,
-          SE_TRUE_NODE, SE_CHIRON, SE_MEAN_APOG
-        };
-        bodies.clear();
-        for (int ipl : kBodies) {
-            double xx[6]; char serr[256] = { 0 };
-            int rc = swe_calc_ut(jd_ut, ipl, SEFLG_SWIEPH | SEFLG_SPEED, xx, serr);
-            if (rc < 0) throw std::runtime_error(std::string("swe_calc_ut: ") + serr);
-
-            Body b;
-            switch (ipl) {
-            case SE_SUN:        b.name = "Sun"; break;
-            case SE_MOON:       b.name = "Moon"; break;
-            case SE_MERCURY:    b.name = "Mercury"; break;
-            case SE_VENUS:      b.name = "Venus"; break;
-            case SE_MARS:       b.name = "Mars"; break;
-            case SE_JUPITER:    b.name = "Jupiter"; break;
-            case SE_SATURN:     b.name = "Saturn"; break;
-            case SE_URANUS:     b.name = "Uranus"; break;
-            case SE_NEPTUNE:    b.name = "Neptune"; break;
-            case SE_PLUTO:      b.name = "Pluto"; break;
-            case SE_TRUE_NODE:  b.name = "True Node"; break;
-            case SE_CHIRON:     b.name = "Chiron"; break;
-            case SE_MEAN_APOG:  b.name = "Lilith"; break;
-            default:            b.name = "Body"; break;
+    // writer: blocks -> stdout
+    std::thread writer([&] {
+        trace_thread_name("writer");
+        ChartWriter w(o.out, o.bodies);
+        std::string head;
+        w.header(head);
+        std::fwrite(head.data(), 1, head.size(), stdout);
+        Block* b;
+        while (writeQ.pop(b)) {
+            TRACE_SPAN("write_block", b->n);
+            b->out.clear();
+            const auto& fails = b->batch.failures();     // sorted by batch index
+            size_t nextBad = 0, nextFail = 0;
+            for (size_t k = 0; k < b->n; ++k) {
+                const char* error = nullptr;
+                const bool bad = b->slot[k] == Block::kNoSlot;
+                if (bad) {
+                    error = b->badRows[nextBad++].second.c_str();
+                } else if (nextFail < fails.size() && fails[nextFail].index == b->slot[k]) {
+                    error = fails[nextFail++].message.c_str();
+                }
+                if (error) ++failed;
+                w.row(b->out, b->rows[k], &b->batch, bad ? 0 : b->slot[k], error, bad);
             }
-            b.lon = norm360(xx[0]);
-            b.lat = xx[1];
-            b.speed = xx[3];
-            b.retro = (xx[3] < 0);
-            bodies.push_back(b);
+            charts += b->n;
+            if (std::fwrite(b->out.data(), 1, b->out.size(), stdout) != b->out.size()) {
+                fatalMsg = "write failed";
+                fatal = true;
+            }
+            freeQ.push(b);
         }
+        std::fflush(stdout);
+    });
+
+    const auto t0 = std::chrono::steady_clock::now();
+    Block* b;
+    while (computeQ.pop(b)) {
+        TRACE_SPAN("compute_block", b->batch.size());
+        if (b->batch.size()) pool.compute(b->batch);
+        writeQ.push(b);
     }
+    writeQ.close();
+    reader.join();
+    writer.join();
+    freeQ.close();
+    const double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
 
-    void computeHouses() {
-        int rc = swe_houses_ex(jd_ut, SEFLG_SWIEPH, lat, lon, hsys, H.cusps, H.ascmc);
-        if (rc == -1) throw std::runtime_error("swe_houses_ex failed");
+    if (fatal) {
+        std::cerr << "ERROR: " << fatalMsg << "\n";
+        return 1;
     }
-};
+    std::cerr << charts << " charts, " << failed << " failed, "
+        << (uint64_t)(secs > 0 ? charts / secs : 0) << " charts/s on " << pool.threads() << " threads\n";
+    return failed ? 2 : 0;
+}
 
 // ---- main ----
 int main(int argc, char** argv) {
@@ -188,26 +344,31 @@ int main(int argc, char** argv) {
     SetConsoleCP(CP_UTF8);
 #endif
 
+    Options o;
+    if (!parse_args(argc, argv, o)) {
+        usage();
+        return 1;
+    }
+    // before any thread opens an ephemeris file
+    if (o.epheMmap) swe_set_ephe_mmap(TRUE);
+    if (!o.trace.empty()) {
+        trace_thread_name("main");
+        trace_start();
+    }
     try {
-        // set ephemeris path
-        namespace fs = std::filesystem;
-        fs::path ephe = EPHE_PATH;
-        if (!ephe.is_absolute())
-            ephe = fs::weakly_canonical(fs::current_path() / ephe);
-        swe_set_ephe_path(ephe.string().c_str());
-
-        // demo inputs
-        int Y = 1996, M = 2, D = 12;
-        double hour = 16.2;
-        double lat = -53.80, lon = -1.54;
-        // if (argc > 1) parseUtcDateTime(argv[1], Y, M, D, hour);
-
-        AstrologyChart chart(Y, M, D, hour, lat, lon, 'P');
-        chart.compute();
-        chart.print(false);
-
+        int rc = o.chart.empty() ? run_batch(o) : run_chart(o);
+        std::string err;
+        if (!o.trace.empty() && !trace_write(o.trace, &err)) {
+            std::cerr << err << "\n";
+            if (!rc) rc = 1;
+        }
+        if (o.epheStats) {
+            std::string js;
+            ephe_stats_json(ephe_stats(), js);
+            std::cerr << js << "\n";
+        }
         swe_close();
-        return 0;
+        return rc;
     }
     catch (const std::exception& e) {
         std::cerr << "\nERROR: " << e.what() << "\n";
@@ -0,0 +1,82 @@
+// MappedFile.cpp — read-only memory mapping of a whole file (C++17)
+
+#include "MappedFile.hpp"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+bool MappedFile::open(const std::string& path, std::string* err) {
+    close();
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        if (err) *err = "cannot open '" + path + "'";
+        return false;
+    }
+    LARGE_INTEGER size{};
+    GetFileSizeEx(file, &size);
+    if (size.QuadPart == 0) {
+        CloseHandle(file);
+        return true;
+    }
+    HANDLE map = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);
+    const void* view = map ? MapViewOfFile(map, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if (!view) {
+        if (map) CloseHandle(map);
+        if (err) *err = "cannot map '" + path + "'";
+        return false;
+    }
+    handle = map;
+    base = (const char*)view;
+    bytes = (size_t)size.QuadPart;
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        if (err) *err = "cannot open '" + path + "'";
+        return false;
+    }
+    struct stat st{};
+    if (fstat(fd, &st) != 0) {
+        ::close(fd);
+        if (err) *err = "cannot stat '" + path + "'";
+        return false;
+    }
+    if (st.st_size == 0) {
+        ::close(fd);
+        return true;
+    }
+    void* view = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (view == MAP_FAILED) {
+        if (err) *err = "cannot map '" + path + "'";
+        return false;
+    }
+    base = (const char*)view;
+    bytes = (size_t)st.st_size;
+#endif
+    return true;
+}
+
+void MappedFile::close() {
+    if (base) {
+#ifdef _WIN32
+        UnmapViewOfFile(base);
+        CloseHandle((HANDLE)handle);
+#else
+        munmap(const_cast<char*>(base), bytes);
+#endif
+    }
+    base = nullptr;
+    bytes = 0;
+    handle = nullptr;
+}
@@ -0,0 +1,25 @@
+#pragma once
+// MappedFile.hpp — read-only memory mapping of a whole file (C++17)
+
+#include <cstddef>
+#include <string>
+
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile() { close(); }
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // Empty files open fine and map nothing.
+    bool open(const std::string& path, std::string* err = nullptr);
+    void close();
+
+    const char* data() const { return base; }
+    size_t size() const { return bytes; }
+
+private:
+    const char* base{};
+    size_t bytes{};
+    void* handle{};   // Windows: file mapping handle
+};
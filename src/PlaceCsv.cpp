@@ -0,0 +1,270 @@
+// PlaceCsv.cpp — parallel streaming reader for places CSV files (C++17)
+
+#include "PlaceCsv.hpp"
+#include "MappedFile.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <thread>
+
+namespace {
+
+const size_t kChunkBytes = (size_t)1 << 20;
+const size_t kChunksPerThread = 4;      // parse-ahead window
+
+// A field inside the chunk text, or (escaped) inside the chunk's arena.
+struct Field {
+    uint32_t off, len;
+    bool arena;
+};
+
+struct Row {
+    Field name, admin, country, tzid;
+    double lat, lon;
+    uint64_t line;
+};
+
+struct Chunk {
+    const char* b{};
+    const char* e{};
+    bool header{};                  // first chunk: skip one record
+    std::vector<Row> rows;
+    std::string arena;              // quoted fields with "" unescaped
+    std::vector<CsvError> errors;   // line relative to the chunk
+    uint64_t lines{};               // line breaks in the chunk
+    bool ready{};
+
+    std::string_view view(const Field& f) const {
+        return { (f.arena ? arena.data() : b) + f.off, f.len };
+    }
+    void release() {
+        std::vector<Row>().swap(rows);
+        std::string().swap(arena);
+        std::vector<CsvError>().swap(errors);
+    }
+};
+
+bool parse_deg(std::string_view s, double limit, double& out) {
+    while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) s.remove_prefix(1);
+    while (!s.empty() && (s.back() == ' ' || s.back() == '\t')) s.remove_suffix(1);
+    if (!s.empty() && s.front() == '+') s.remove_prefix(1);
+    if (s.empty()) return false;
+    auto r = std::from_chars(s.data(), s.data() + s.size(), out);
+    return r.ec == std::errc() && r.ptr == s.data() + s.size() && out >= -limit && out <= limit;
+}
+
+// Parses one record at p; fills up to 6 fields, returns the field count or
+// -1 with msg set. Leaves p after the record's line break.
+int parse_record(Chunk& c, const char*& p, Field* f, std::string& msg) {
+    const char* e = c.e;
+    int nf = 0;
+    for (;;) {
+        Field fld{ 0, 0, false };
+        if (p < e && *p == '"') {
+            const char* s = ++p;
+            bool escaped = false;
+            const char* q;
+            for (;;) {
+                q = (const char*)std::memchr(p, '"', (size_t)(e - p));
+                if (!q) {
+                    c.lines += (uint64_t)std::count(p, e, '\n');
+                    p = e;
+                    msg = "unterminated quoted field";
+                    return -1;
+                }
+                c.lines += (uint64_t)std::count(p, q, '\n');
+                if (q + 1 < e && q[1] == '"') {
+                    escaped = true;
+                    p = q + 2;
+                    continue;
+                }
+                p = q + 1;
+                break;
+            }
+            if (escaped) {
+                fld = { (uint32_t)c.arena.size(), 0, true };
+                for (const char* k = s; k < q; ++k) {
+                    c.arena.push_back(*k);
+                    if (*k == '"') ++k;     // "" -> "
+                }
+                fld.len = (uint32_t)(c.arena.size() - fld.off);
+            } else {
+                fld = { (uint32_t)(s - c.b), (uint32_t)(q - s), false };
+            }
+            if (p < e && *p != ',' && *p != '\n' && *p != '\r') {
+                while (p < e && *p != '\n') ++p;
+                if (p < e) { ++p; ++c.lines; }
+                msg = "unexpected text after a closing quote";
+                return -1;
+            }
+        } else {
+            const char* s = p;
+            while (p < e && *p != ',' && *p != '\n' && *p != '\r') ++p;
+            fld = { (uint32_t)(s - c.b), (uint32_t)(p - s), false };
+        }
+        if (nf < 6) f[nf] = fld;
+        ++nf;
+        if (p < e && *p == ',') {
+            ++p;
+            continue;
+        }
+        if (p < e && *p == '\r') ++p;
+        if (p < e && *p == '\n') { ++p; ++c.lines; }
+        return nf;
+    }
+}
+
+void parse_chunk(Chunk& c) {
+    const char* p = c.b;
+    Field f[6];
+    std::string msg;
+    if (c.header && p < c.e) parse_record(c, p, f, msg);
+    while (p < c.e) {
+        const uint64_t line = c.lines;
+        int nf = parse_record(c, p, f, msg);
+        if (nf < 0) {
+            c.errors.push_back({ line, msg });
+            continue;
+        }
+        if (nf == 1 && f[0].len == 0) continue;    // blank line
+        if (nf < 6) {
+            c.errors.push_back({ line, "expected 6 fields, found " + std::to_string(nf) });
+            continue;
+        }
+        Row r{ f[0], f[1], f[2], f[5], 0, 0, line };
+        if (!parse_deg(c.view(f[3]), 90.0, r.lat)) {                    // south = negative
+            c.errors.push_back({ line, "bad latitude '" + std::string(c.view(f[3])) + "'" });
+            continue;
+        }
+        if (!parse_deg(c.view(f[4]), 180.0, r.lon)) {                   // west = negative
+            c.errors.push_back({ line, "bad longitude '" + std::string(c.view(f[4])) + "'" });
+            continue;
+        }
+        c.rows.push_back(r);
+    }
+}
+
+template <class F>
+void parallel_for(size_t n, unsigned threads, F&& f) {
+    std::atomic<size_t> next{ 0 };
+    auto work = [&] {
+        for (size_t k; (k = next.fetch_add(1)) < n;) f(k);
+    };
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < threads; ++t) pool.emplace_back(work);
+    work();
+    for (auto& t : pool) t.join();
+}
+
+// Chunk starts: every kChunkBytes, moved forward to the next line break
+// outside quotes. Parity at a nominal start is the parity of all quotes
+// before it, counted per nominal chunk in parallel.
+std::vector<size_t> chunk_starts(const char* data, size_t size, unsigned threads) {
+    const size_t nominal = (size + kChunkBytes - 1) / kChunkBytes;
+    std::vector<uint8_t> odd(nominal);
+    parallel_for(nominal, threads, [&](size_t k) {
+        const char* b = data + k * kChunkBytes;
+        odd[k] = (uint8_t)(std::count(b, data + std::min(size, (k + 1) * kChunkBytes), '"') & 1);
+    });
+    std::vector<size_t> starts{ 0 };
+    bool inQuote = false;
+    for (size_t k = 1; k < nominal; ++k) {
+        inQuote ^= odd[k - 1] != 0;
+        bool q = inQuote;
+        size_t pos = k * kChunkBytes;
+        while (pos < size && (q || data[pos] != '\n')) {
+            if (data[pos] == '"') q = !q;
+            ++pos;
+        }
+        if (pos < size) ++pos;
+        if (pos > starts.back() && pos < size) starts.push_back(pos);
+    }
+    return starts;
+}
+
+void deliver(Chunk& c, uint64_t lineBase, const PlaceRowFn& row, std::vector<CsvError>* errors) {
+    if (errors)
+        for (auto& er : c.errors) errors->push_back({ lineBase + er.line + 1, std::move(er.message) });
+    for (const Row& r : c.rows)
+        row({ c.view(r.name), c.view(r.admin), c.view(r.country), c.view(r.tzid), r.lat, r.lon, lineBase + r.line + 1 });
+    c.release();
+}
+
+} // namespace
+
+void read_places_csv(const char* data, size_t size, const PlaceRowFn& row,
+                     std::vector<CsvError>* errors, unsigned threads) {
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    if (size >= 3 && std::memcmp(data, "\xEF\xBB\xBF", 3) == 0) {   // UTF-8 BOM
+        data += 3;
+        size -= 3;
+    }
+    std::vector<size_t> starts = chunk_starts(data, size, threads);
+    std::vector<Chunk> chunks(starts.size());
+    for (size_t k = 0; k < chunks.size(); ++k) {
+        chunks[k].b = data + starts[k];
+        chunks[k].e = data + (k + 1 < starts.size() ? starts[k + 1] : size);
+        chunks[k].header = k == 0;
+    }
+
+    uint64_t lineBase = 0;
+    if (threads == 1 || chunks.size() == 1) {
+        for (auto& c : chunks) {
+            parse_chunk(c);
+            deliver(c, lineBase, row, errors);
+            lineBase += c.lines;
+        }
+        return;
+    }
+
+    // Workers parse ahead up to a window of chunks; this thread delivers in order.
+    std::mutex mu;
+    std::condition_variable cv;
+    size_t nextParse = 0, delivered = 0;
+    const size_t window = (size_t)threads * kChunksPerThread;
+    auto work = [&] {
+        for (;;) {
+            size_t k;
+            {
+                std::unique_lock<std::mutex> lk(mu);
+                cv.wait(lk, [&] { return nextParse >= chunks.size() || nextParse < delivered + window; });
+                if (nextParse >= chunks.size()) return;
+                k = nextParse++;
+            }
+            parse_chunk(chunks[k]);
+            {
+                std::lock_guard<std::mutex> lk(mu);
+                chunks[k].ready = true;
+            }
+            cv.notify_all();
+        }
+    };
+    std::vector<std::thread> pool;
+    for (unsigned t = 0; t < threads; ++t) pool.emplace_back(work);
+    for (size_t k = 0; k < chunks.size(); ++k) {
+        {
+            std::unique_lock<std::mutex> lk(mu);
+            cv.wait(lk, [&] { return chunks[k].ready; });
+        }
+        deliver(chunks[k], lineBase, row, errors);
+        lineBase += chunks[k].lines;
+        {
+            std::lock_guard<std::mutex> lk(mu);
+            delivered = k + 1;
+        }
+        cv.notify_all();
+    }
+    for (auto& t : pool) t.join();
+}
+
+bool read_places_csv(const std::string& path, const PlaceRowFn& row,
+                     std::vector<CsvError>* errors, unsigned threads, std::string* err) {
+    MappedFile f;
+    if (!f.open(path, err)) return false;
+    read_places_csv(f.data(), f.size(), row, errors, threads);
+    return true;
+}
@@ -0,0 +1,43 @@
+#pragma once
+// PlaceCsv.hpp — parallel streaming reader for places CSV files (C++17)
+//
+// The file is memory-mapped and cut into ~1 MB chunks at line breaks that
+// are outside quoted fields (quote parity per chunk is counted in parallel
+// first). Worker threads parse chunks into chunk-local rows; the calling
+// thread hands the rows to the caller in file order and frees each chunk,
+// so memory stays bounded by a small window of chunks, not the file size.
+// Fields follow RFC 4180: quoted fields may hold commas, "" and line breaks.
+// Numbers go through std::from_chars, so parsing ignores the C locale.
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// One data row. The views are valid only during the callback.
+struct PlaceRow {
+    std::string_view name, admin, country, tzid;
+    double lat{0}, lon{0};
+    uint64_t line{};        // 1-based physical line where the row starts
+};
+
+struct CsvError {
+    uint64_t line;          // 1-based physical line where the row starts
+    std::string message;
+};
+
+using PlaceRowFn = std::function<void(const PlaceRow&)>;
+
+// Reads a places CSV: a header line, then name,admin,country,lat,lon,tzid
+// (extra columns ignored, LF or CRLF). Calls row() for every good row in
+// file order; bad rows are skipped and reported in errors. Never throws on
+// bad data. threads = 0 uses all cores. Returns false only if the file
+// cannot be read.
+bool read_places_csv(const std::string& path, const PlaceRowFn& row,
+                     std::vector<CsvError>* errors = nullptr, unsigned threads = 0, std::string* err = nullptr);
+
+// The same over a buffer in memory.
+void read_places_csv(const char* data, size_t size, const PlaceRowFn& row,
+                     std::vector<CsvError>* errors = nullptr, unsigned threads = 0);
@@ -0,0 +1,59 @@
+// StringTable.cpp — interned strings addressed by small integer ids (C++17)
+
+#include "StringTable.hpp"
+
+StringTable::StringTable() {
+    for (auto& b : blocks) b.store(nullptr, std::memory_order_relaxed);
+    strings.emplace_back();     // id 0 = ""
+    auto* b = new std::string_view[kBlockSize];
+    b[0] = strings.back();
+    ids.emplace(strings.back(), 0);
+    blocks[0].store(b, std::memory_order_release);
+    count.store(1, std::memory_order_release);
+}
+
+StringTable::~StringTable() {
+    for (auto& b : blocks) delete[] b.load(std::memory_order_relaxed);
+}
+
+uint32_t StringTable::intern(std::string_view s) {
+    if (s.empty()) return 0;
+    std::lock_guard<std::mutex> lk(mu);
+    auto it = ids.find(s);
+    if (it != ids.end()) return it->second;
+
+    const uint32_t id = count.load(std::memory_order_relaxed);
+    const uint32_t blk = id >> kBlockBits;
+    if (blk >= kMaxBlocks) return 0;
+    std::string_view* b = blocks[blk].load(std::memory_order_relaxed);
+    if (!b) {
+        b = new std::string_view[kBlockSize];
+        blocks[blk].store(b, std::memory_order_release);
+    }
+    strings.emplace_back(s);
+    b[id & (kBlockSize - 1)] = strings.back();
+    ids.emplace(strings.back(), id);
+    count.store(id + 1, std::memory_order_release);
+    return id;
+}
+
+uint32_t StringTable::find(std::string_view s) const {
+    std::lock_guard<std::mutex> lk(mu);
+    auto it = ids.find(s);
+    return it == ids.end() ? kNotFound : it->second;
+}
+
+StringTable& place_admins() {
+    static StringTable t;
+    return t;
+}
+
+StringTable& place_countries() {
+    static StringTable t;
+    return t;
+}
+
+StringTable& place_tzids() {
+    static StringTable t;
+    return t;
+}
@@ -0,0 +1,56 @@
+#pragma once
+// StringTable.hpp — interned strings addressed by small integer ids (C++17)
+//
+// Each distinct string is stored once and gets a dense id; id 0 is "".
+// Equal strings get equal ids, so comparing ids compares the strings.
+// intern() and find() lock; str() does not: ids index fixed blocks that
+// never move once published, so resolving an id is two loads.
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+class StringTable {
+public:
+    static const uint32_t kNotFound = 0xFFFFFFFFu;
+
+    StringTable();
+    ~StringTable();
+    StringTable(const StringTable&) = delete;
+    StringTable& operator=(const StringTable&) = delete;
+
+    // The id of s, adding it if new. 0 for "" (and if the table is full).
+    uint32_t intern(std::string_view s);
+
+    // The id of s, or kNotFound.
+    uint32_t find(std::string_view s) const;
+
+    // The string of id; "" for ids never handed out.
+    std::string_view str(uint32_t id) const {
+        if (id >= count.load(std::memory_order_acquire)) return {};
+        return blocks[id >> kBlockBits].load(std::memory_order_acquire)[id & (kBlockSize - 1)];
+    }
+
+    size_t size() const { return count.load(std::memory_order_acquire); }
+
+private:
+    static const uint32_t kBlockBits = 12;
+    static const uint32_t kBlockSize = 1u << kBlockBits;
+    static const uint32_t kMaxBlocks = 1u << 14;        // 64M strings
+
+    mutable std::mutex mu;
+    std::deque<std::string> strings;                    // stable storage
+    std::unordered_map<std::string_view, uint32_t> ids; // views into strings
+    std::atomic<std::string_view*> blocks[kMaxBlocks];
+    std::atomic<uint32_t> count{ 0 };
+};
+
+// Shared tables for Place fields.
+StringTable& place_admins();
+StringTable& place_countries();
+StringTable& place_tzids();
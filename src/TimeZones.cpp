@@ -0,0 +1,450 @@
+// TimeZones.cpp — compiled UTC-offset tables for IANA time zones (C++17)
+
+#include "TimeZones.hpp"
+#include "StringTable.hpp"
+#include "Trace.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <thread>
+#include <utility>
+
+namespace {
+
+const int kLastYear = 2400;         // footer rules are expanded through this year
+
+inline int64_t floor_div(int64_t a, int64_t b) { return a / b - ((a % b) != 0 && ((a < 0) != (b < 0))); }
+
+inline bool is_leap(int y) { return (y % 4 == 0 && y % 100 != 0) || y % 400 == 0; }
+
+inline int weekday(int64_t days) { return (int)(((days % 7) + 11) % 7); }     // 0 = Sunday; 1970-01-01 was a Thursday
+
+// Sorts by instant, keeps the last offset at equal instants and drops
+// transitions that do not change the offset.
+void normalize(std::vector<std::pair<int64_t, int32_t>>& tr, int32_t initial,
+               std::vector<int64_t>& trans, std::vector<int32_t>& off) {
+    std::stable_sort(tr.begin(), tr.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+    trans.clear();
+    off.assign(1, initial);
+    for (size_t i = 0; i < tr.size(); ++i) {
+        if (i + 1 < tr.size() && tr[i + 1].first == tr[i].first) continue;
+        if (tr[i].second == off.back()) continue;
+        trans.push_back(tr[i].first);
+        off.push_back(tr[i].second);
+    }
+}
+
+// ---- TZif ----
+
+struct Reader {
+    const unsigned char* p;
+    const unsigned char* e;
+
+    bool has(size_t n) const { return (size_t)(e - p) >= n; }
+    int64_t be(int bytes) {
+        uint64_t v = 0;
+        for (int i = 0; i < bytes; ++i) v = (v << 8) | *p++;
+        if (bytes == 4) return (int32_t)(uint32_t)v;
+        return (int64_t)v;
+    }
+};
+
+struct TzifHeader {
+    char version;
+    int64_t isutcnt, isstdcnt, leapcnt, timecnt, typecnt, charcnt;
+
+    bool read(Reader& r) {
+        if (!r.has(44) || std::string_view((const char*)r.p, 4) != "TZif") return false;
+        version = (char)r.p[4];
+        r.p += 20;
+        isutcnt = r.be(4);
+        isstdcnt = r.be(4);
+        leapcnt = r.be(4);
+        timecnt = r.be(4);
+        typecnt = r.be(4);
+        charcnt = r.be(4);
+        return isutcnt >= 0 && isstdcnt >= 0 && leapcnt >= 0 && timecnt >= 0 && typecnt > 0 && charcnt >= 0;
+    }
+    size_t bodySize(int timeBytes) const {
+        return (size_t)(timecnt * timeBytes + timecnt + typecnt * 6 + charcnt +
+                        leapcnt * (timeBytes + 4) + isstdcnt + isutcnt);
+    }
+};
+
+// ---- POSIX TZ rule (the TZif footer) ----
+
+struct PosixRule {
+    char kind;          // 'M', 'J' (1..365, no Feb 29) or 'D' (0..365)
+    int m, w, d;        // M: month, week 1..5, weekday; J/D: day in d
+    int32_t time;       // local seconds after midnight, may be negative or > 24h
+};
+
+struct PosixTz {
+    int32_t std{}, dst{};
+    bool hasDst{};
+    PosixRule start{}, end{};
+};
+
+bool parse_abbr(const char*& s) {
+    if (*s == '<') {
+        while (*s && *s != '>') ++s;
+        if (*s != '>') return false;
+        ++s;
+        return true;
+    }
+    const char* b = s;
+    while ((*s >= 'A' && *s <= 'Z') || (*s >= 'a' && *s <= 'z')) ++s;
+    return s - b >= 3;
+}
+
+bool parse_num(const char*& s, int maxv, int& out) {
+    if (*s < '0' || *s > '9') return false;
+    out = 0;
+    while (*s >= '0' && *s <= '9') {
+        out = out * 10 + (*s++ - '0');
+        if (out > maxv) return false;
+    }
+    return true;
+}
+
+bool parse_hms(const char*& s, int32_t& out) {
+    int sign = 1;
+    if (*s == '+' || *s == '-') sign = *s++ == '-' ? -1 : 1;
+    int h, m = 0, sec = 0;
+    if (!parse_num(s, 167, h)) return false;
+    if (*s == ':' && !parse_num(++s, 59, m)) return false;
+    if (*s == ':' && !parse_num(++s, 59, sec)) return false;
+    out = sign * (h * 3600 + m * 60 + sec);
+    return true;
+}
+
+bool parse_rule(const char*& s, PosixRule& r) {
+    r.time = 2 * 3600;
+    if (*s == 'M') {
+        r.kind = 'M';
+        if (!parse_num(++s, 12, r.m) || r.m < 1 || *s != '.') return false;
+        if (!parse_num(++s, 5, r.w) || r.w < 1 || *s != '.') return false;
+        if (!parse_num(++s, 6, r.d)) return false;
+    } else if (*s == 'J') {
+        r.kind = 'J';
+        if (!parse_num(++s, 365, r.d) || r.d < 1) return false;
+    } else {
+        r.kind = 'D';
+        if (!parse_num(s, 365, r.d)) return false;
+    }
+    return *s != '/' || parse_hms(++s, r.time);
+}
+
+bool parse_posix(const char* s, PosixTz& tz) {
+    int32_t v;
+    if (!parse_abbr(s) || !parse_hms(s, v)) return false;
+    tz.std = -v;                    // POSIX offsets count west of Greenwich
+    if (!*s) return true;
+    if (!parse_abbr(s)) return false;
+    tz.dst = tz.std + 3600;
+    if (*s != ',' && *s) {
+        if (!parse_hms(s, v)) return false;
+        tz.dst = -v;
+    }
+    if (*s != ',' || !parse_rule(++s, tz.start)) return false;
+    if (*s != ',' || !parse_rule(++s, tz.end)) return false;
+    tz.hasDst = true;
+    return *s == 0;
+}
+
+// Local midnight (as days) of the rule's date in year y.
+int64_t rule_day(const PosixRule& r, int y) {
+    const int64_t jan1 = days_from_civil(y, 1, 1);
+    if (r.kind == 'J') return jan1 + r.d - 1 + (is_leap(y) && r.d >= 60 ? 1 : 0);
+    if (r.kind == 'D') return jan1 + r.d;
+    const int64_t first = days_from_civil(y, r.m, 1);
+    const int64_t next = r.m == 12 ? days_from_civil(y + 1, 1, 1) : days_from_civil(y, r.m + 1, 1);
+    int64_t day = first + (r.d - weekday(first) + 7) % 7 + (int64_t)(r.w - 1) * 7;
+    while (day >= next) day -= 7;
+    return day;
+}
+
+// Appends the footer rule's transitions after the last explicit one.
+void extend(const PosixTz& tz, std::vector<std::pair<int64_t, int32_t>>& tr) {
+    if (!tz.hasDst) return;         // the last offset holds forever
+    const int64_t last = tr.empty() ? INT64_MIN : tr.back().first;
+    int y0 = 1970;
+    if (!tr.empty()) {
+        int m, d;
+        civil_from_days(floor_div(last, 86400), y0, m, d);
+    }
+    std::vector<std::pair<int64_t, int32_t>> ext;
+    for (int y = y0; y <= kLastYear; ++y) {
+        ext.push_back({ rule_day(tz.start, y) * 86400 + tz.start.time - tz.std, tz.dst });
+        ext.push_back({ rule_day(tz.end, y) * 86400 + tz.end.time - tz.dst, tz.std });
+    }
+    std::stable_sort(ext.begin(), ext.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+    for (const auto& t : ext)
+        if (t.first > last) tr.push_back(t);
+}
+
+bool valid_zone_name(std::string_view s) {
+    if (s.empty() || s.front() == '/' || s.find("..") != std::string_view::npos) return false;
+    for (char c : s)
+        if (c == '\\' || c == 0) return false;
+    return true;
+}
+
+} // namespace
+
+// ---- Civil time helpers ----
+
+// Howard Hinnant's days_from_civil / civil_from_days (proleptic Gregorian).
+int64_t days_from_civil(int y, int m, int d) {
+    const int64_t yy = (int64_t)y - (m <= 2);
+    const int64_t era = floor_div(yy, 400);
+    const int64_t yoe = yy - era * 400;
+    const int64_t doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    const int64_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 719468;
+}
+
+void civil_from_days(int64_t days, int& y, int& m, int& d) {
+    days += 719468;
+    const int64_t era = floor_div(days, 146097);
+    const int64_t doe = days - era * 146097;
+    const int64_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    const int64_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    const int64_t mp = (5 * doy + 2) / 153;
+    d = (int)(doy - (153 * mp + 2) / 5 + 1);
+    m = (int)(mp < 10 ? mp + 3 : mp - 9);
+    y = (int)(yoe + era * 400 + (m <= 2));
+}
+
+// ---- TZif reader ----
+
+bool read_tzif(const std::string& path, std::vector<int64_t>& trans, std::vector<int32_t>& off) {
+    std::ifstream f(path, std::ios::binary);
+    if (!f) return false;
+    const std::string buf((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+    Reader r{ (const unsigned char*)buf.data(), (const unsigned char*)buf.data() + buf.size() };
+
+    TzifHeader h;
+    if (!h.read(r)) return false;
+    int timeBytes = 4;
+    if (h.version >= '2') {         // skip the 32-bit body
+        if (!r.has(h.bodySize(4))) return false;
+        r.p += h.bodySize(4);
+        if (!h.read(r)) return false;
+        timeBytes = 8;
+    }
+    if (!r.has(h.bodySize(timeBytes))) return false;
+
+    std::vector<int64_t> at((size_t)h.timecnt);
+    for (auto& t : at) t = r.be(timeBytes);
+    std::vector<uint8_t> idx(r.p, r.p + h.timecnt);
+    r.p += h.timecnt;
+    std::vector<int32_t> utoff((size_t)h.typecnt);
+    for (auto& u : utoff) {
+        u = (int32_t)r.be(4);
+        r.p += 2;                   // isdst, desigidx
+    }
+    r.p += h.bodySize(timeBytes) - (size_t)(h.timecnt * timeBytes + h.timecnt + h.typecnt * 6);
+
+    std::vector<std::pair<int64_t, int32_t>> tr;
+    tr.reserve(at.size());
+    for (size_t i = 0; i < at.size(); ++i) {
+        if (idx[i] >= utoff.size()) return false;
+        tr.push_back({ at[i], utoff[idx[i]] });
+    }
+
+    if (timeBytes == 8 && r.has(2) && *r.p == '\n') {
+        const char* s = (const char*)r.p + 1;
+        const char* e = (const char*)r.e;
+        const char* nl = std::find(s, e, '\n');
+        PosixTz tz;
+        if (nl != e && nl > s && parse_posix(std::string(s, nl).c_str(), tz)) extend(tz, tr);
+    }
+    normalize(tr, utoff[0], trans, off);
+    return true;
+}
+
+// ---- TzZone ----
+
+TzZone::TzZone(std::vector<int64_t> t, std::vector<int32_t> o) : trans(std::move(t)), off(std::move(o)) {
+    off.resize(trans.size() + 1, off.empty() ? 0 : off.back());
+    localStart.resize(trans.size());
+    int64_t prev = INT64_MIN;
+    for (size_t i = 0; i < trans.size(); ++i) {
+        prev = std::max(prev, trans[i] + off[i + 1]);   // keep sorted for the search
+        localStart[i] = prev;
+    }
+}
+
+int32_t TzZone::offsetAt(int64_t utc) const {
+    return off[(size_t)(std::upper_bound(trans.begin(), trans.end(), utc) - trans.begin())];
+}
+
+int64_t TzZone::toUtc(int64_t local, TzStatus* st) const {
+    // Span k (offset off[k]) is the last one whose local start is <= local.
+    const size_t k = (size_t)(std::upper_bound(localStart.begin(), localStart.end(), local) - localStart.begin());
+    TzStatus s = TZ_OK;
+    int64_t utc = local - off[k];
+    if (k < trans.size() && local >= trans[k] + off[k]) {
+        s = TZ_NONEXISTENT;         // past span k's end, before span k+1 starts
+        utc = trans[k];
+    } else if (k > 0 && local < trans[k - 1] + off[k - 1]) {
+        s = TZ_AMBIGUOUS;           // span k-1 has not ended yet
+        utc = local - off[k - 1];
+    }
+    if (st) *st = s;
+    return utc;
+}
+
+// ---- TzDatabase ----
+
+TzDatabase::TzDatabase(std::string d) : dir(std::move(d)) {
+    for (auto& f : fast) f.store(nullptr, std::memory_order_relaxed);
+    loader = [this](std::string_view tzid, std::vector<int64_t>& trans, std::vector<int32_t>& off) {
+        return valid_zone_name(tzid) && read_tzif(dir + "/" + std::string(tzid), trans, off);
+    };
+}
+
+std::string TzDatabase::default_dir() {
+    if (const char* e = std::getenv("TZDIR"))
+        if (*e) return e;
+#ifdef _WIN32
+    return "data/zoneinfo";
+#else
+    return "/usr/share/zoneinfo";
+#endif
+}
+
+void TzDatabase::setLoader(TzLoader l) {
+    std::lock_guard<std::mutex> lk(mu);
+    loader = std::move(l);
+}
+
+const TzZone* TzDatabase::compile(uint32_t tzid) {
+    TzLoader load;
+    {
+        std::lock_guard<std::mutex> lk(mu);
+        auto it = zones.find(tzid);
+        if (it != zones.end()) return it->second.get();
+        if (missing.count(tzid)) return nullptr;
+        load = loader;
+    }
+
+    // Read and build outside the lock so that zones compile in parallel; if
+    // another thread compiled the same zone meanwhile, its copy wins.
+    std::vector<int64_t> trans;
+    std::vector<int32_t> off;
+    const std::string_view name = place_tzids().str(tzid);
+    std::unique_ptr<TzZone> built;
+    if (!name.empty() && load(name, trans, off)) built = std::make_unique<TzZone>(std::move(trans), std::move(off));
+
+    std::lock_guard<std::mutex> lk(mu);
+    if (!built) {
+        missing.insert(tzid);
+        return nullptr;
+    }
+    const auto ins = zones.emplace(tzid, std::move(built));
+    TzZone* z = ins.first->second.get();
+    if (ins.second && tzid < kFastIds) fast[tzid].store(z, std::memory_order_release);
+    return z;
+}
+
+const TzZone* TzDatabase::zone(uint32_t tzid) {
+    if (tzid < kFastIds)
+        if (const TzZone* z = fast[tzid].load(std::memory_order_acquire)) return z;
+    return compile(tzid);
+}
+
+const TzZone* TzDatabase::zone(std::string_view tzid) {
+    return tzid.empty() ? nullptr : zone(place_tzids().intern(tzid));
+}
+
+size_t TzDatabase::preload(unsigned threads) {
+    TRACE_SPAN("tz_preload");
+    namespace fs = std::filesystem;
+    std::vector<uint32_t> ids;
+    std::error_code ec;
+    const fs::path root(dir);
+    for (fs::recursive_directory_iterator it(root, ec), end; !ec && it != end; it.increment(ec)) {
+        const std::string rel = it->path().lexically_relative(root).generic_string();
+        if (it->is_directory(ec)) {
+            if (rel == "posix" || rel == "right") it.disable_recursion_pending();
+            continue;
+        }
+        char magic[4] = {};
+        std::ifstream f(it->path(), std::ios::binary);
+        if (f.read(magic, 4) && std::string_view(magic, 4) == "TZif") ids.push_back(place_tzids().intern(rel));
+    }
+    for (uint32_t id = 1; id < (uint32_t)place_tzids().size(); ++id) ids.push_back(id);
+    std::sort(ids.begin(), ids.end());
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+
+    std::atomic<size_t> next{ 0 }, compiled{ 0 };
+    auto work = [&] {
+        for (size_t i; (i = next.fetch_add(1)) < ids.size();)
+            if (zone(ids[i])) ++compiled;
+    };
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = (unsigned)std::min<size_t>(threads, std::max<size_t>(ids.size(), 1));
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < threads; ++t) pool.emplace_back(work);
+    work();
+    for (auto& t : pool) t.join();
+    return compiled.load();
+}
+
+size_t TzDatabase::toUtc(const uint32_t* tzids, const int64_t* local, size_t n, int64_t* utc,
+                         TzStatus* status, unsigned threads) {
+    const size_t kBlock = 4096;
+    std::atomic<size_t> next{ 0 }, bad{ 0 };
+    auto work = [&] {
+        size_t nbad = 0;
+        for (size_t b; (b = next.fetch_add(kBlock)) < n;) {
+            uint32_t lastId = StringTable::kNotFound;
+            const TzZone* z = nullptr;
+            for (size_t i = b, e = std::min(n, b + kBlock); i < e; ++i) {
+                if (tzids[i] != lastId) {           // rows usually come grouped by zone
+                    lastId = tzids[i];
+                    z = zone(lastId);
+                }
+                TzStatus s = TZ_UNKNOWN_ZONE;
+                utc[i] = z ? z->toUtc(local[i], &s) : local[i];
+                if (status) status[i] = s;
+                nbad += s != TZ_OK;
+            }
+        }
+        bad += nbad;
+    };
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = (unsigned)std::min<size_t>(threads, (n + kBlock - 1) / kBlock);
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < threads; ++t) pool.emplace_back(work);
+    work();
+    for (auto& t : pool) t.join();
+    return bad;
+}
+
+TzDatabase& tz_database() {
+    static TzDatabase db;
+    return db;
+}
+
+TzStatus local_to_utc(std::string_view tzid, int Y, int M, int D, double hour,
+                      int& uY, int& uM, int& uD, double& uHour) {
+    TRACE_SPAN("local_to_utc");
+    const TzZone* z = tz_database().zone(tzid);
+    if (!z) return TZ_UNKNOWN_ZONE;
+    const double secs = hour * 3600.0;
+    const double whole = std::floor(secs);
+    TzStatus st;
+    int64_t utc = z->toUtc(days_from_civil(Y, M, D) * 86400 + (int64_t)whole, &st);
+    const double frac = st == TZ_NONEXISTENT ? 0.0 : secs - whole;
+    const int64_t day = floor_div(utc, 86400);
+    civil_from_days(day, uY, uM, uD);
+    uHour = ((double)(utc - day * 86400) + frac) / 3600.0;
+    return st;
+}
@@ -0,0 +1,104 @@
+#pragma once
+// TimeZones.hpp — compiled UTC-offset tables for IANA time zones (C++17)
+//
+// A zone is compiled once into sorted arrays: the UTC instants where its
+// offset changes, the offset of every span between them, and each span's
+// local start time. UTC -> local and local -> UTC are then one binary
+// search each. Zones come from TZif files (a zoneinfo directory), extended
+// past their last transition with the file's POSIX TZ rule, or from a
+// loader hook (e.g. another tz library). Compiled zones are cached by
+// their interned id in place_tzids(), so lookups need no string work.
+//
+// Times are seconds since 1970-01-01 00:00, UTC or local wall clock.
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+enum TzStatus {
+    TZ_OK,
+    TZ_AMBIGUOUS,       // local time occurs twice (fall back): the earlier instant is used
+    TZ_NONEXISTENT,     // local time skipped (spring forward): the transition instant is used
+    TZ_UNKNOWN_ZONE
+};
+
+class TzZone {
+public:
+    // trans: UTC instants, ascending. off: UTC offset in seconds before
+    // trans[0], then after each transition (trans.size() + 1 entries).
+    TzZone(std::vector<int64_t> trans, std::vector<int32_t> off);
+
+    int32_t offsetAt(int64_t utc) const;
+    int64_t toUtc(int64_t local, TzStatus* st = nullptr) const;
+
+    size_t transitions() const { return trans.size(); }
+
+private:
+    std::vector<int64_t> trans;
+    std::vector<int32_t> off;
+    std::vector<int64_t> localStart;    // local start of the span after trans[i]
+};
+
+// Fills trans/off (see TzZone) for a zone name; false if unknown.
+using TzLoader = std::function<bool(std::string_view tzid, std::vector<int64_t>& trans, std::vector<int32_t>& off)>;
+
+class TzDatabase {
+public:
+    // Reads TZif files under dir (default: $TZDIR, else the system zoneinfo).
+    explicit TzDatabase(std::string dir = default_dir());
+
+    // Replaces the TZif reader; call before the first lookup.
+    void setLoader(TzLoader loader);
+
+    // Compiled zone, or nullptr if unknown. tzid is an id of place_tzids().
+    const TzZone* zone(uint32_t tzid);
+    const TzZone* zone(std::string_view tzid);
+
+    // utc[i] = local[i] in zone tzids[i]; status[i] optional. Returns the
+    // number of rows that were not TZ_OK. threads = 0 uses all cores.
+    size_t toUtc(const uint32_t* tzids, const int64_t* local, size_t n, int64_t* utc,
+                 TzStatus* status = nullptr, unsigned threads = 0);
+
+    // Compiles ahead of the first lookup every zone in the zoneinfo
+    // directory (its posix/ and right/ copies aside) and every zone already
+    // named in place_tzids(), on `threads` threads (0 = all cores). Returns
+    // the number of zones compiled.
+    size_t preload(unsigned threads = 0);
+
+    static std::string default_dir();
+
+private:
+    static const uint32_t kFastIds = 4096;
+
+    std::string dir;
+    TzLoader loader;
+    std::mutex mu;
+    std::atomic<const TzZone*> fast[kFastIds];                       // by tzid id
+    std::unordered_map<uint32_t, std::unique_ptr<TzZone>> zones;     // owns every zone
+    std::unordered_set<uint32_t> missing;                            // ids with no zone
+
+    const TzZone* compile(uint32_t tzid);
+};
+
+// Process-wide database over the default directory.
+TzDatabase& tz_database();
+
+// Reads one TZif file (v1..v4) into trans/off, extending it to the end of
+// 2400 with its footer rule. False if the file is missing or malformed.
+bool read_tzif(const std::string& path, std::vector<int64_t>& trans, std::vector<int32_t>& off);
+
+// ---- Civil time helpers ----
+int64_t days_from_civil(int y, int m, int d);
+void civil_from_days(int64_t days, int& y, int& m, int& d);
+
+// Local wall time in tzid -> UTC date and decimal hour, as swe_julday() wants.
+TzStatus local_to_utc(std::string_view tzid, int Y, int M, int D, double hour,
+                      int& uY, int& uM, int& uD, double& uHour);
@@ -0,0 +1,234 @@
+// Trace.cpp — scoped spans in per-thread rings, exported as Chrome trace_event JSON (C++17)
+//
+// A ring has one writer, its thread, which fills a slot and then publishes
+// it by advancing head (release). A reader copies the published slots and
+// then rereads head: slots the writer may have reused meanwhile, including
+// the one it may be filling now, are dropped. Rings outlive their threads
+// and go to the next new thread, so a thread-per-connection server keeps a
+// bounded number of them; every event carries its thread id.
+
+#include "Trace.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace trace_detail {
+std::atomic<bool> on{ false };
+}
+
+namespace {
+
+struct Event {
+    std::atomic<const char*> name{ nullptr };
+    std::atomic<int64_t> begin{ 0 }, end{ 0 };
+    std::atomic<uint64_t> arg{ 0 };
+    std::atomic<uint32_t> tid{ 0 };
+};
+
+struct Ring {
+    explicit Ring(size_t cap) : mask(cap - 1), ev(new Event[cap]) {}
+    const size_t mask;
+    std::unique_ptr<Event[]> ev;
+    std::atomic<uint64_t> head{ 0 };   // events written so far
+};
+
+struct Registry {
+    std::mutex mu;
+    size_t capacity = 0;                // events per ring, fixed by the first trace_start()
+    std::atomic<int64_t> since{ 0 };
+    std::vector<std::unique_ptr<Ring>> rings;
+    std::vector<Ring*> idle;            // rings of exited threads
+    std::map<uint32_t, std::string> names;
+    std::atomic<uint32_t> nextTid{ 1 };
+};
+
+Registry& registry() {
+    static Registry* r = new Registry;  // never destroyed: threads may still trace during exit
+    return *r;
+}
+
+struct ThreadRing {
+    Ring* ring = nullptr;
+    uint32_t tid = 0;
+
+    ~ThreadRing() {
+        if (!ring) return;
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lk(r.mu);
+        r.idle.push_back(ring);
+    }
+
+    uint32_t id() {
+        if (!tid) tid = registry().nextTid.fetch_add(1, std::memory_order_relaxed);
+        return tid;
+    }
+
+    Ring* get() {
+        if (ring) return ring;
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lk(r.mu);
+        if (!r.idle.empty()) {
+            ring = r.idle.back();
+            r.idle.pop_back();
+        } else if (r.capacity) {
+            r.rings.push_back(std::make_unique<Ring>(r.capacity));
+            ring = r.rings.back().get();
+        }
+        return ring;
+    }
+};
+
+thread_local ThreadRing t_ring;
+
+inline void put_us(std::string& out, int64_t ns) {
+    char b[32];
+    out.append(b, std::to_chars(b, b + sizeof(b), (double)ns / 1000.0, std::chars_format::fixed, 3).ptr);
+}
+
+inline void put_uint(std::string& out, uint64_t v) {
+    char b[24];
+    out.append(b, std::to_chars(b, b + sizeof(b), v).ptr);
+}
+
+void put_json_text(std::string& out, const char* s) {
+    out.push_back('"');
+    for (; *s; ++s) {
+        const char c = *s;
+        if (c == '"' || c == '\\') out.push_back('\\');
+        if ((unsigned char)c >= 0x20) out.push_back(c);
+    }
+    out.push_back('"');
+}
+
+} // namespace
+
+namespace trace_detail {
+
+void record(const char* name, int64_t begin, int64_t end, uint64_t arg) {
+    Ring* r = t_ring.get();
+    if (!r) return;
+    const uint64_t h = r->head.load(std::memory_order_relaxed);
+    Event& e = r->ev[h & r->mask];
+    e.name.store(name, std::memory_order_relaxed);
+    e.begin.store(begin, std::memory_order_relaxed);
+    e.end.store(end, std::memory_order_relaxed);
+    e.arg.store(arg, std::memory_order_relaxed);
+    e.tid.store(t_ring.id(), std::memory_order_relaxed);
+    r->head.store(h + 1, std::memory_order_release);
+}
+
+} // namespace trace_detail
+
+void trace_start(size_t eventsPerThread) {
+    Registry& r = registry();
+    {
+        std::lock_guard<std::mutex> lk(r.mu);
+        if (!r.capacity) {
+            size_t cap = 2;
+            while (cap < eventsPerThread) cap <<= 1;
+            r.capacity = cap;
+        }
+    }
+    r.since.store(trace_detail::now());
+    trace_detail::on.store(true);
+}
+
+void trace_stop() {
+    trace_detail::on.store(false);
+}
+
+void trace_thread_name(const char* name) {
+    Registry& r = registry();
+    const uint32_t tid = t_ring.id();
+    std::lock_guard<std::mutex> lk(r.mu);
+    r.names[tid] = name;
+}
+
+void trace_json(std::string& out) {
+    Registry& r = registry();
+    const int64_t since = r.since.load();
+    std::vector<Ring*> rings;
+    std::map<uint32_t, std::string> names;
+    {
+        std::lock_guard<std::mutex> lk(r.mu);
+        for (const auto& ring : r.rings) rings.push_back(ring.get());
+        names = r.names;
+    }
+
+    struct Copy { const char* name; int64_t begin, end; uint64_t arg; uint32_t tid; };
+    std::vector<Copy> events;
+    for (Ring* ring : rings) {
+        const uint64_t cap = ring->mask + 1;
+        const uint64_t h1 = ring->head.load(std::memory_order_acquire);
+        const size_t from = events.size();
+        for (uint64_t i = h1 > cap ? h1 - cap : 0; i < h1; ++i) {
+            const Event& e = ring->ev[i & ring->mask];
+            events.push_back({ e.name.load(std::memory_order_relaxed), e.begin.load(std::memory_order_relaxed),
+                               e.end.load(std::memory_order_relaxed), e.arg.load(std::memory_order_relaxed),
+                               e.tid.load(std::memory_order_relaxed) });
+        }
+        // Slot i is safe unless the writer has since reached i + cap.
+        std::atomic_thread_fence(std::memory_order_acquire);
+        const uint64_t h2 = ring->head.load(std::memory_order_relaxed);
+        const uint64_t first = h1 > cap ? h1 - cap : 0;
+        const uint64_t keepFrom = h2 + 1 > cap ? h2 + 1 - cap : 0;
+        if (keepFrom > first)
+            events.erase(events.begin() + from, events.begin() + from + (size_t)std::min(keepFrom - first, h1 - first));
+    }
+
+    std::map<uint32_t, bool> tids;
+    out.append("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+    bool first = true;
+    for (const Copy& e : events) {
+        if (!e.name || e.begin < since) continue;
+        if (!first) out.push_back(',');
+        first = false;
+        tids[e.tid] = true;
+        out.append("\n{\"name\":");
+        put_json_text(out, e.name);
+        out.append(",\"cat\":\"astro\",\"ph\":\"X\",\"pid\":1,\"tid\":");
+        put_uint(out, e.tid);
+        out.append(",\"ts\":");
+        put_us(out, e.begin - since);
+        out.append(",\"dur\":");
+        put_us(out, e.end - e.begin);
+        if (e.arg) {
+            out.append(",\"args\":{\"n\":");
+            put_uint(out, e.arg);
+            out.push_back('}');
+        }
+        out.push_back('}');
+    }
+    for (const auto& t : tids) {
+        if (!first) out.push_back(',');
+        first = false;
+        out.append("\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":");
+        put_uint(out, t.first);
+        out.append(",\"args\":{\"name\":");
+        const auto it = names.find(t.first);
+        put_json_text(out, it != names.end() ? it->second.c_str() : ("thread " + std::to_string(t.first)).c_str());
+        out.append("}}");
+    }
+    out.append("\n]}\n");
+}
+
+bool trace_write(const std::string& path, std::string* err) {
+    std::string js;
+    trace_json(js);
+    FILE* f = std::fopen(path.c_str(), "wb");
+    if (!f) {
+        if (err) *err = "cannot create " + path;
+        return false;
+    }
+    const bool ok = std::fwrite(js.data(), 1, js.size(), f) == js.size();
+    if (std::fclose(f) != 0 || !ok) {
+        if (err) *err = "write failed: " + path;
+        return false;
+    }
+    return true;
+}
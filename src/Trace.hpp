@@ -0,0 +1,81 @@
+#pragma once
+// Trace.hpp — scoped spans in per-thread rings, exported as Chrome trace_event JSON (C++17)
+//
+// A TraceSpan records its name, start and duration when it goes out of
+// scope, but only while tracing is on; otherwise it costs one relaxed load.
+// Every thread writes its own fixed-size ring without locks: the newest
+// events overwrite the oldest, so a long-running service always holds its
+// last few seconds per thread. trace_json() snapshots all rings into the
+// Chrome trace_event format, which Perfetto (ui.perfetto.dev) and
+// chrome://tracing open directly: one track per thread, nested spans stacked.
+//
+// Span names must be string literals (the ring stores the pointer). The
+// pipeline uses:
+//   parse_birth, parse_datetime, local_to_utc    input (ChartIO, TimeZones)
+//   tz_preload                                    TzDatabase::preload()
+//   computePlanets, computeHouses                 ChartBatch / AstrologyChart
+//   aspects                                       AspectFinder
+//   format_row                                    ChartWriter
+//   chunk                                         ChartPool worker, one ChartBatch range
+//   warmup                                        ChartPool::warmup(), segment preload
+//   batch                                         ChartService, one micro-batch
+//   compute_block, write_block                    console app batch mode
+//   request, service_wait                         astrologyd, per request and time in the service
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace trace_detail {
+extern std::atomic<bool> on;
+void record(const char* name, int64_t begin, int64_t end, uint64_t arg);
+inline int64_t now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+}
+
+// Starts recording. Rings hold eventsPerThread events each (rounded up to a
+// power of two); the size is fixed by the first trace_start(). Events from
+// before the latest trace_start() are not exported.
+void trace_start(size_t eventsPerThread = 1 << 16);
+
+// Stops recording; the rings keep their events for trace_json().
+void trace_stop();
+
+inline bool trace_enabled() { return trace_detail::on.load(std::memory_order_relaxed); }
+
+// Names the calling thread's track. Unnamed threads show as "thread N".
+void trace_thread_name(const char* name);
+
+// All recorded events as one Chrome trace_event JSON object.
+void trace_json(std::string& out);
+
+// trace_json() into a file.
+bool trace_write(const std::string& path, std::string* err = nullptr);
+
+class TraceSpan {
+public:
+    // arg, when non-zero, is shown as args.n (e.g. the charts in a batch).
+    explicit TraceSpan(const char* name, uint64_t arg = 0)
+        : name_(trace_enabled() ? name : nullptr), arg_(arg), begin_(name_ ? trace_detail::now() : 0) {}
+    ~TraceSpan() {
+        if (name_) trace_detail::record(name_, begin_, trace_detail::now(), arg_);
+    }
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+    void setArg(uint64_t arg) { arg_ = arg; }
+
+private:
+    const char* name_;
+    uint64_t arg_;
+    int64_t begin_;
+};
+
+#define TRACE_CAT2(a, b) a##b
+#define TRACE_CAT(a, b) TRACE_CAT2(a, b)
+// TRACE_SPAN("name") or TRACE_SPAN("name", n): a span to the end of the scope.
+#define TRACE_SPAN(...) TraceSpan TRACE_CAT(trace_span_, __LINE__)(__VA_ARGS__)
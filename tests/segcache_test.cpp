@@ -0,0 +1,85 @@
+// segcache_test.cpp — per-body segment caches across ephemeris file switches (C++17)
+//
+// usage: segcache_test EPHE_PATH [calls]
+//
+// Computes bodies 0-9, 11, 12 and 15 in random order at dates around the
+// 1800 and 2400 boundaries of the sepl/semo/seas files, so that bodies keep
+// flipping between the files on either side: once with the segment cache
+// off, then the same call sequence with the default cache. Every position
+// and speed must be bit-identical between the two runs (results near a
+// boundary depend on which file is open, so the reference is the same
+// sequence, not one call per date). A body must neither use a cached
+// segment of the file it left nor keep evaluating a current segment that
+// was freed with it; CMake also runs this under ASan.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+extern "C" {
+#include "swephexp.h"
+}
+
+namespace {
+
+const int kBodies[] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 11, 12, 15 };
+const int kNumBodies = (int)(sizeof kBodies / sizeof kBodies[0]);
+const int32 kFlags = SEFLG_SWIEPH | SEFLG_SPEED;
+
+bool same(const double* a, const double* b) { return std::memcmp(a, b, 6 * sizeof(double)) == 0; }
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::fprintf(stderr, "usage: segcache_test EPHE_PATH [calls]\n");
+        return 2;
+    }
+    const int calls = argc > 2 ? std::atoi(argv[2]) : 50000;
+
+    std::vector<double> dates;
+    for (int year : { 1800, 2400 }) {
+        const double t0 = swe_julday(year, 1, 1, 0.0, SE_GREG_CAL);
+        for (int d = -90; d <= 90; d += 3) dates.push_back(t0 + d + 0.37);
+    }
+    const size_t ndates = dates.size();
+
+    // one pass over the call sequence; false if a call fails
+    char serr[AS_MAXCH];
+    auto run = [&](int32 nseg, std::vector<double>& out) {
+        swe_set_ephe_path(argv[1]);
+        swe_set_segment_cache(nseg);
+        std::mt19937_64 rng(20240702);
+        out.resize((size_t)calls * 6);
+        for (int i = 0; i < calls; ++i) {
+            const double tjd = dates[rng() % ndates];
+            const int ipl = kBodies[rng() % kNumBodies];
+            if (swe_calc(tjd, ipl, kFlags, &out[(size_t)i * 6], serr) < 0) {
+                std::fprintf(stderr, "call %d: body %d at %.2f: %s\n", i, ipl, tjd, serr);
+                return false;
+            }
+        }
+        return true;
+    };
+
+    std::vector<double> want, got;
+    int64 hits = 0, misses = 0;
+    if (!run(0, want)) return 2;
+    swe_close();
+    if (!run(8, got)) return 2;
+    swe_get_segment_cache_stats(&hits, &misses, 0);
+    swe_close();
+
+    int failures = 0;
+    for (int i = 0; i < calls; ++i) {
+        if (!same(&got[(size_t)i * 6], &want[(size_t)i * 6]) && ++failures <= 10)
+            std::fprintf(stderr, "call %d: lon %.17g, speed %.17g, expected %.17g, %.17g\n", i, got[(size_t)i * 6],
+                         got[(size_t)i * 6 + 3], want[(size_t)i * 6], want[(size_t)i * 6 + 3]);
+    }
+
+    std::printf("%d calls, %lld cache hits, %lld misses, %d mismatches\n", calls, (long long)hits, (long long)misses,
+                failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,647 @@
+// astrologyd.cpp — chart service daemon on a Unix socket and localhost HTTP (C++17, POSIX)
+//
+// usage: astrologyd [options]
+//
+// Keeps a ChartService (a ChartPool with warm ephemeris files on every worker)
+// running and serves it two ways. Requests from all connections are coalesced
+// into micro-batches by the service, so concurrent clients share the work.
+//
+// Unix socket (stream): newline-separated. A line starting with '{' is a
+// birth as in ChartIO.hpp NDJSON input; consecutive ones that arrive
+// together are computed together. Each gets one response, in order: an
+// NDJSON row, or a fixed-size binary record after "bin". Other lines are
+// commands:
+//   bin       responses become binary records; replies with the BinHeader
+//   json      back to NDJSON rows; replies {"format":"ndjson"}
+//   metrics   replies with the metrics object on one line
+//   ephe      replies with the ephemeris counters (EpheStats.hpp) on one line
+//
+// HTTP/1.1 on 127.0.0.1, keep-alive:
+//   POST /chart    body: NDJSON births, one per line. Response: NDJSON rows,
+//                  or BinHeader + records with "Accept: application/octet-stream"
+//                  or ?format=bin
+//   GET /metrics   counters and latency histograms as JSON
+//   GET /metrics/ephemeris        swecalc/segment/nutation counters as JSON,
+//                                 or Prometheus text with ?format=prometheus;
+//                                 needs a -DASTRO_SWE_INSTRUMENT=ON build
+//   POST /metrics/ephemeris/reset starts those counters again from zero
+//   POST /trace/start, /trace/stop  record pipeline spans (Trace.hpp)
+//   GET /trace     the spans recorded so far, per thread, as Chrome trace JSON
+//                  (open in ui.perfetto.dev)
+//   GET /health    "ok"
+//
+// Rows that fail carry their error; the request as a whole still succeeds.
+// SIGINT / SIGTERM stop the daemon after the requests in flight.
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <mutex>
+#include <set>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "ChartService.hpp"
+#include "EpheStats.hpp"
+#include "TimeZones.hpp"
+#include "Trace.hpp"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const size_t kMaxLine = 1 << 20;            // Unix socket: longest request line
+const size_t kMaxHeader = 16 << 10;         // HTTP: request line + headers
+const size_t kMaxBody = 64 << 20;           // HTTP: POST body
+
+int g_wake[2] = { -1, -1 };                 // self-pipe: signal -> accept loop
+
+void on_signal(int) {
+    const char c = 1;
+    if (write(g_wake[1], &c, 1) < 0) {}
+}
+
+struct TransportStats {
+    std::atomic<uint64_t> requests{ 0 }, charts{ 0 }, badInput{ 0 };
+    LatencyHistogram latencyNs;             // request read -> response written
+};
+
+struct Daemon {
+    ChartService* svc{};
+    char hsys{ 'P' };
+    unsigned maxConnections{ 256 };
+    size_t traceEvents{ 1 << 16 };          // per thread, see trace_start()
+
+    TransportStats unixStats, httpStats;
+    std::atomic<uint64_t> accepted{ 0 }, rejected{ 0 };
+
+    mutable std::mutex mu;
+    std::condition_variable cv;
+    std::set<int> open;                     // connection fds, for shutdown
+
+    void metricsJson(std::string& out) const {
+        size_t nopen;
+        {
+            std::lock_guard<std::mutex> lk(mu);
+            nopen = open.size();
+        }
+        out.append("{\"service\":");
+        svc->statsJson(out);
+        out.append(",\"connections\":{\"open\":").append(std::to_string(nopen));
+        out.append(",\"accepted\":").append(std::to_string(accepted.load()));
+        out.append(",\"rejected\":").append(std::to_string(rejected.load())).append("}");
+        for (const auto& t : { std::make_pair("unix", &unixStats), std::make_pair("http", &httpStats) }) {
+            out.append(",\"").append(t.first).append("\":{\"requests\":").append(std::to_string(t.second->requests.load()));
+            out.append(",\"charts\":").append(std::to_string(t.second->charts.load()));
+            out.append(",\"bad_input\":").append(std::to_string(t.second->badInput.load()));
+            out.append(",\"latency_us\":");
+            t.second->latencyNs.json(out, 1000.0);
+            out.push_back('}');
+        }
+        out.push_back('}');
+    }
+};
+
+bool send_all(int fd, const char* p, size_t n) {
+    while (n) {
+        const ssize_t k = send(fd, p, n, MSG_NOSIGNAL);
+        if (k < 0 && errno == EINTR) continue;
+        if (k <= 0) return false;
+        p += k;
+        n -= (size_t)k;
+    }
+    return true;
+}
+
+// Reads more bytes into buf. False on EOF or error.
+bool recv_more(int fd, std::string& buf) {
+    char tmp[64 << 10];
+    for (;;) {
+        const ssize_t k = recv(fd, tmp, sizeof(tmp), 0);
+        if (k < 0 && errno == EINTR) continue;
+        if (k <= 0) return false;
+        buf.append(tmp, (size_t)k);
+        return true;
+    }
+}
+
+// ---- Charts: NDJSON lines in, rows out ----
+// Per connection, so that parsing and formatting run on the connection's
+// thread and only the computation goes through the service.
+class ChartSession {
+public:
+    explicit ChartSession(Daemon& d) : d(d), parser(InputFormat::Ndjson, d.hsys),
+        json(OutputFormat::Ndjson, d.svc->config().bodies), bin(OutputFormat::Binary, d.svc->config().bodies) {}
+
+    const ChartWriter& writer(bool binary) const { return binary ? bin : json; }
+
+    // Computes every non-blank line of `lines` and appends its response row.
+    // Returns the number of rows.
+    size_t run(std::string_view lines, bool binary, std::string& out, TransportStats& ts) {
+        TraceSpan span("request");
+        size_t rows = 0, ng = 0;
+        bad.clear();
+        while (!lines.empty()) {
+            const size_t nl = lines.find('\n');
+            std::string_view line = lines.substr(0, nl);
+            lines = nl == std::string_view::npos ? std::string_view() : lines.substr(nl + 1);
+            if (line.find_first_not_of(" \t\r") == std::string_view::npos) continue;
+            if (good.size() <= ng) good.resize(ng + 1);
+            if (parser.parse(line, good[ng], &err)) {
+                ++ng;
+            } else {
+                bad.push_back({ rows, good[ng], err });
+            }
+            ++rows;
+        }
+        if (ng) {
+            bodies.resize(ng);
+            houses.resize(ng);
+            failed.assign(ng, std::string());
+            TRACE_SPAN("service_wait", ng);
+            const bool ran = d.svc->compute(good.data(), ng, [&](const ChartBatch& batch, size_t first) {
+                for (size_t k = 0; k < ng; ++k) {
+                    if (const char* e = ChartService::error(batch, first + k)) failed[k] = e;
+                    else batch.get(first + k, bodies[k], houses[k]);
+                }
+            });
+            if (!ran) failed.assign(ng, "service stopping");
+        }
+        const ChartWriter& w = writer(binary);
+        for (size_t r = 0, g = 0, b = 0; r < rows; ++r) {
+            if (b < bad.size() && bad[b].row == r) {
+                w.row(out, bad[b].in, nullptr, nullptr, bad[b].error.c_str(), true);
+                ++b;
+            } else {
+                const char* e = failed[g].empty() ? nullptr : failed[g].c_str();
+                w.row(out, good[g], &bodies[g], &houses[g], e);
+                ++g;
+            }
+        }
+        span.setArg(rows);
+        ts.charts += rows;
+        ts.badInput += bad.size();
+        return rows;
+    }
+
+private:
+    struct Bad { size_t row; BirthInput in; std::string error; };
+
+    Daemon& d;
+    BirthParser parser;
+    ChartWriter json, bin;
+    std::string err;
+    std::vector<BirthInput> good;
+    std::vector<Bad> bad;
+    std::vector<ChartBodies> bodies;
+    std::vector<Houses> houses;
+    std::vector<std::string> failed;
+};
+
+// ---- Unix socket ----
+void serve_unix(Daemon& d, int fd) {
+    ChartSession session(d);
+    std::string buf, out;
+    bool binary = false;
+    while (recv_more(fd, buf)) {
+        // buf holds no newline before this read, so this finds only new lines.
+        const Clock::time_point t0 = Clock::now();
+        const size_t end = buf.rfind('\n');
+        if (end == std::string::npos) {
+            if (buf.size() > kMaxLine) {
+                const char* msg = "{\"error\":\"line too long\"}\n";
+                send_all(fd, msg, std::strlen(msg));
+                return;
+            }
+            continue;
+        }
+        out.clear();
+        std::string_view rest(buf.data(), end + 1);
+        size_t requests = 0;
+        while (!rest.empty()) {
+            // A run of chart lines, then at most one command line.
+            size_t p = 0;
+            while (p < rest.size()) {
+                const size_t q = rest.find_first_not_of(" \t\r\n", p);
+                if (q == std::string_view::npos || rest[q] != '{') break;
+                p = rest.find('\n', q) + 1;
+            }
+            if (p) {
+                requests += session.run(rest.substr(0, p), binary, out, d.unixStats);
+                rest.remove_prefix(p);
+                continue;
+            }
+            const size_t nl = rest.find('\n');
+            std::string_view cmd = rest.substr(0, nl);
+            rest.remove_prefix(nl + 1);
+            while (!cmd.empty() && (cmd.back() == '\r' || cmd.back() == ' ' || cmd.back() == '\t')) cmd.remove_suffix(1);
+            while (!cmd.empty() && (cmd.front() == ' ' || cmd.front() == '\t')) cmd.remove_prefix(1);
+            if (cmd.empty()) continue;
+            ++requests;
+            if (cmd == "bin") {
+                binary = true;
+                session.writer(true).header(out);
+            } else if (cmd == "json") {
+                binary = false;
+                out.append("{\"format\":\"ndjson\"}\n");
+            } else if (cmd == "metrics") {
+                d.metricsJson(out);
+                out.push_back('\n');
+            } else if (cmd == "ephe") {
+                ephe_stats_json(ephe_stats(), out);
+                out.push_back('\n');
+            } else {
+                out.append("{\"error\":\"unknown command\"}\n");
+            }
+        }
+        buf.erase(0, end + 1);
+        if (!send_all(fd, out.data(), out.size())) return;
+        if (requests) {
+            d.unixStats.requests += requests;
+            d.unixStats.latencyNs.record((uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - t0).count());
+        }
+    }
+}
+
+// ---- HTTP ----
+bool iequals(std::string_view a, std::string_view b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); ++i)
+        if (std::tolower((unsigned char)a[i]) != std::tolower((unsigned char)b[i])) return false;
+    return true;
+}
+
+void http_response(std::string& out, int status, const char* reason, const char* type,
+                   std::string_view body, bool close, const char* extra = nullptr) {
+    out.append("HTTP/1.1 ").append(std::to_string(status)).append(" ").append(reason).append("\r\n");
+    out.append("Content-Type: ").append(type).append("\r\n");
+    out.append("Content-Length: ").append(std::to_string(body.size())).append("\r\n");
+    if (extra) out.append(extra);
+    if (close) out.append("Connection: close\r\n");
+    out.append("\r\n").append(body);
+}
+
+void serve_http(Daemon& d, int fd) {
+    ChartSession session(d);
+    std::string buf, out, body;
+    for (;;) {
+        // Request line and headers.
+        size_t hdrEnd;
+        while ((hdrEnd = buf.find("\r\n\r\n")) == std::string::npos) {
+            if (buf.size() > kMaxHeader) {
+                out.clear();
+                http_response(out, 431, "Request Header Fields Too Large", "text/plain", "headers too large\n", true);
+                send_all(fd, out.data(), out.size());
+                return;
+            }
+            if (!recv_more(fd, buf)) return;
+        }
+        const Clock::time_point t0 = Clock::now();
+        std::string_view head(buf.data(), hdrEnd);
+        const size_t eol = head.find("\r\n");
+        std::string_view line = head.substr(0, eol);
+        std::string_view method = line.substr(0, line.find(' '));
+        std::string_view target = line.size() > method.size() ? line.substr(method.size() + 1) : std::string_view();
+        std::string_view version = target.substr(std::min(target.size(), target.find(' ') + 1));
+        target = target.substr(0, target.find(' '));
+
+        bool close = version != "HTTP/1.1", binary = false, chunked = false;
+        long long length = -1;
+        std::string_view hdrs = eol == std::string_view::npos ? std::string_view() : head.substr(eol + 2);
+        while (!hdrs.empty()) {
+            const size_t e = hdrs.find("\r\n");
+            std::string_view h = hdrs.substr(0, e);
+            hdrs = e == std::string_view::npos ? std::string_view() : hdrs.substr(e + 2);
+            const size_t colon = h.find(':');
+            if (colon == std::string_view::npos) continue;
+            std::string_view name = h.substr(0, colon), value = h.substr(colon + 1);
+            while (!value.empty() && value.front() == ' ') value.remove_prefix(1);
+            if (iequals(name, "content-length")) length = std::strtoll(std::string(value).c_str(), nullptr, 10);
+            else if (iequals(name, "transfer-encoding")) chunked = true;
+            else if (iequals(name, "connection")) {
+                if (iequals(value, "close")) close = true;
+                else if (iequals(value, "keep-alive")) close = false;
+            }
+            else if (iequals(name, "accept") && value.find("application/octet-stream") != std::string_view::npos) binary = true;
+        }
+        const std::string_view path = target.substr(0, target.find('?'));
+        if (target.find("format=bin") != std::string_view::npos) binary = true;
+
+        out.clear();
+        bool fatal = false;         // the request body can't be skipped: answer and close
+        if (chunked) {
+            http_response(out, 411, "Length Required", "text/plain", "chunked bodies are not supported\n", true);
+            fatal = true;
+        } else if (length > (long long)kMaxBody) {
+            http_response(out, 413, "Payload Too Large", "text/plain", "body too large\n", true);
+            fatal = true;
+        }
+        if (fatal) {
+            send_all(fd, out.data(), out.size());
+            return;
+        }
+        const size_t bodyLen = length > 0 ? (size_t)length : 0;
+        while (buf.size() < hdrEnd + 4 + bodyLen)
+            if (!recv_more(fd, buf)) return;
+        std::string_view reqBody(buf.data() + hdrEnd + 4, bodyLen);
+
+        if (path == "/chart") {
+            if (method != "POST") {
+                http_response(out, 405, "Method Not Allowed", "text/plain", "use POST\n", close, "Allow: POST\r\n");
+            } else {
+                body.clear();
+                const ChartWriter& w = session.writer(binary);
+                if (binary) w.header(body);
+                session.run(reqBody, binary, body, d.httpStats);
+                http_response(out, 200, "OK", binary ? "application/octet-stream" : "application/x-ndjson", body, close);
+            }
+        } else if (path == "/metrics" || path == "/health") {
+            if (method != "GET") {
+                http_response(out, 405, "Method Not Allowed", "text/plain", "use GET\n", close, "Allow: GET\r\n");
+            } else if (path == "/health") {
+                http_response(out, 200, "OK", "text/plain", "ok\n", close);
+            } else {
+                body.clear();
+                d.metricsJson(body);
+                body.push_back('\n');
+                http_response(out, 200, "OK", "application/json", body, close);
+            }
+        } else if (path == "/metrics/ephemeris") {
+            if (method != "GET") {
+                http_response(out, 405, "Method Not Allowed", "text/plain", "use GET\n", close, "Allow: GET\r\n");
+            } else if (target.find("format=prometheus") != std::string_view::npos) {
+                body.clear();
+                ephe_stats_prometheus(ephe_stats(), body);
+                http_response(out, 200, "OK", "text/plain; version=0.0.4", body, close);
+            } else {
+                body.clear();
+                ephe_stats_json(ephe_stats(), body);
+                body.push_back('\n');
+                http_response(out, 200, "OK", "application/json", body, close);
+            }
+        } else if (path == "/trace" || path == "/trace/start" || path == "/trace/stop") {
+            const char* want = path == "/trace" ? "GET" : "POST";
+            if (method != want) {
+                http_response(out, 405, "Method Not Allowed", "text/plain", path == "/trace" ? "use GET\n" : "use POST\n", close,
+                              path == "/trace" ? "Allow: GET\r\n" : "Allow: POST\r\n");
+            } else if (path == "/trace") {
+                body.clear();
+                trace_json(body);
+                http_response(out, 200, "OK", "application/json", body, close);
+            } else {
+                if (path == "/trace/start") trace_start(d.traceEvents);
+                else trace_stop();
+                http_response(out, 200, "OK", "text/plain", "ok\n", close);
+            }
+        } else if (path == "/metrics/ephemeris/reset") {
+            if (method != "POST") {
+                http_response(out, 405, "Method Not Allowed", "text/plain", "use POST\n", close, "Allow: POST\r\n");
+            } else {
+                reset_ephe_stats();
+                http_response(out, 200, "OK", "text/plain", "ok\n", close);
+            }
+        } else {
+            http_response(out, 404, "Not Found", "text/plain", "not found\n", close);
+        }
+        buf.erase(0, hdrEnd + 4 + bodyLen);
+        if (!send_all(fd, out.data(), out.size())) return;
+        d.httpStats.requests++;
+        d.httpStats.latencyNs.record((uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - t0).count());
+        if (close) return;
+    }
+}
+
+// ---- Listeners ----
+int listen_unix(const std::string& path) {
+    if (path.size() >= sizeof(sockaddr_un::sun_path)) {
+        std::fprintf(stderr, "astrologyd: socket path too long: %s\n", path.c_str());
+        return -1;
+    }
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+    const int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+
+    // A socket file left by a daemon that died: remove it. One that still
+    // answers belongs to a running daemon.
+    struct stat sb;
+    if (stat(path.c_str(), &sb) == 0 && S_ISSOCK(sb.st_mode)) {
+        const int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        const bool live = connect(probe, (sockaddr*)&addr, sizeof(addr)) == 0;
+        ::close(probe);
+        if (live) {
+            std::fprintf(stderr, "astrologyd: %s: another daemon is listening\n", path.c_str());
+            ::close(fd);
+            return -1;
+        }
+        unlink(path.c_str());
+    }
+    if (bind(fd, (sockaddr*)&addr, sizeof(addr)) < 0 || listen(fd, 128) < 0) {
+        std::fprintf(stderr, "astrologyd: %s: %s\n", path.c_str(), std::strerror(errno));
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int listen_http(int port) {
+    const int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    const int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t)port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(fd, (sockaddr*)&addr, sizeof(addr)) < 0 || listen(fd, 128) < 0) {
+        std::fprintf(stderr, "astrologyd: 127.0.0.1:%d: %s\n", port, std::strerror(errno));
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+void usage() {
+    std::fprintf(stderr,
+        "usage: astrologyd [options]\n"
+        "  --ephe PATH         ephemeris directory (default $SE_EPHE_PATH, else data/ephe)\n"
+        "  --socket PATH       Unix socket (default /tmp/astrologyd.sock; none to disable)\n"
+        "  --port N            HTTP port on 127.0.0.1 (default 8377; 0 to disable)\n"
+        "  --threads N         chart workers (default: all cores)\n"
+        "  --pin               pin workers to cores\n"
+        "  --ephe-mmap         read the ephemeris files through memory mappings\n"
+        "  --bodies LIST       all, or keys such as sun,moon,node (default all)\n"
+        "  --hsys C            house system for births without one (default P)\n"
+        "  --batch-max N       charts per micro-batch (default 4096)\n"
+        "  --batch-delay-us N  let a small batch wait this long for more requests (default 0)\n"
+        "  --max-connections N (default 256)\n"
+        "  --warmup FROM-TO    before listening, decode the ephemeris segments for the\n"
+        "                      years FROM..TO (e.g. 1900-2100) and compile the time zones\n"
+        "  --trace             record pipeline spans from the start (GET /trace)\n"
+        "  --trace-events N    spans kept per thread (default 65536)\n");
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    ChartService::Config cfg;
+    std::string socketPath = "/tmp/astrologyd.sock";
+    int port = 8377;
+    bool trace = false, warmup = false, epheMmap = false;
+    double warmFrom = 0, warmTo = 0;
+    Daemon d;
+    for (int i = 1; i < argc; ++i) {
+        const std::string a = argv[i];
+        if (a == "--pin") { cfg.pin = true; continue; }
+        if (a == "--trace") { trace = true; continue; }
+        if (a == "--ephe-mmap") { epheMmap = true; continue; }
+        if (a == "-h" || a == "--help" || i + 1 >= argc) { usage(); return a == "-h" || a == "--help" ? 0 : 2; }
+        const char* v = argv[++i];
+        std::string err;
+        if (a == "--ephe") cfg.ephe_path = v;
+        else if (a == "--socket") socketPath = std::strcmp(v, "none") ? v : "";
+        else if (a == "--port") port = std::atoi(v);
+        else if (a == "--threads") cfg.threads = (unsigned)std::strtoul(v, nullptr, 10);
+        else if (a == "--batch-max") cfg.maxBatch = std::strtoull(v, nullptr, 10);
+        else if (a == "--batch-delay-us") cfg.maxDelayUs = (unsigned)std::strtoul(v, nullptr, 10);
+        else if (a == "--trace-events") d.traceEvents = std::max<size_t>(2, std::strtoull(v, nullptr, 10));
+        else if (a == "--max-connections") d.maxConnections = std::max(1u, (unsigned)std::strtoul(v, nullptr, 10));
+        else if (a == "--hsys" && std::strlen(v) == 1) d.hsys = v[0];
+        else if (a == "--warmup") {
+            if (!(warmup = parse_year_window(v, warmFrom, warmTo, &err))) {
+                std::fprintf(stderr, "astrologyd: bad --warmup: %s\n", err.c_str());
+                return 2;
+            }
+        } else if (a == "--bodies") {
+            if (!parse_body_set(v, cfg.bodies, &err)) {
+                std::fprintf(stderr, "astrologyd: bad --bodies: %s\n", err.c_str());
+                return 2;
+            }
+        } else {
+            usage();
+            return 2;
+        }
+    }
+    if (cfg.ephe_path.empty()) {
+        const char* env = std::getenv("SE_EPHE_PATH");
+        cfg.ephe_path = env && *env ? env : "data/ephe";
+    }
+    namespace fs = std::filesystem;
+    if (!fs::path(cfg.ephe_path).is_absolute()) cfg.ephe_path = fs::weakly_canonical(fs::current_path() / cfg.ephe_path).string();
+
+    if (pipe(g_wake) < 0) return 1;
+    fcntl(g_wake[0], F_SETFD, FD_CLOEXEC);
+    fcntl(g_wake[1], F_SETFD, FD_CLOEXEC);
+    signal(SIGPIPE, SIG_IGN);
+    struct sigaction sa{};
+    sa.sa_handler = on_signal;
+    sigaction(SIGINT, &sa, nullptr);
+    sigaction(SIGTERM, &sa, nullptr);
+
+    if (trace) trace_start(d.traceEvents);
+    // before the service's workers open any ephemeris file
+    if (epheMmap) swe_set_ephe_mmap(TRUE);
+    ChartService svc(cfg);
+    d.svc = &svc;
+    // Warm before binding: until the sockets exist, health checks fail and
+    // no request can meet a cold segment or time zone.
+    if (warmup) {
+        const auto w0 = std::chrono::steady_clock::now();
+        std::string err;
+        const size_t positions = svc.warmup(warmFrom, warmTo, &err);
+        if (!err.empty()) {
+            std::fprintf(stderr, "astrologyd: warmup: %s\n", err.c_str());
+            return 1;
+        }
+        const size_t zones = tz_database().preload(svc.threads());
+        std::fprintf(stderr, "astrologyd: warmup: %zu positions, %zu zones in %.2f s\n", positions, zones,
+                     std::chrono::duration<double>(std::chrono::steady_clock::now() - w0).count());
+    }
+
+    const int ufd = socketPath.empty() ? -1 : listen_unix(socketPath);
+    const int hfd = port > 0 ? listen_http(port) : -1;
+    if ((!socketPath.empty() && ufd < 0) || (port > 0 && hfd < 0) || (ufd < 0 && hfd < 0)) {
+        if (ufd >= 0) { close(ufd); unlink(socketPath.c_str()); }
+        if (hfd >= 0) close(hfd);
+        if (socketPath.empty() && port <= 0) std::fprintf(stderr, "astrologyd: nothing to listen on\n");
+        return 1;
+    }
+
+    std::fprintf(stderr, "astrologyd: %u workers, ephemeris %s", svc.threads(), cfg.ephe_path.c_str());
+    if (ufd >= 0) std::fprintf(stderr, ", unix %s", socketPath.c_str());
+    if (hfd >= 0) std::fprintf(stderr, ", http 127.0.0.1:%d", port);
+    std::fprintf(stderr, "\n");
+
+    pollfd fds[3] = { { g_wake[0], POLLIN, 0 }, { ufd, POLLIN, 0 }, { hfd, POLLIN, 0 } };
+    for (;;) {
+        if (poll(fds, 3, -1) < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        if (fds[0].revents) break;
+        for (int k = 1; k < 3; ++k) {
+            if (!(fds[k].revents & POLLIN)) continue;
+            const int c = accept4(fds[k].fd, nullptr, nullptr, SOCK_CLOEXEC);
+            if (c < 0) continue;
+            const bool http = k == 2;
+            {
+                std::lock_guard<std::mutex> lk(d.mu);
+                if (d.open.size() >= d.maxConnections) {
+                    d.rejected++;
+                    ::close(c);
+                    continue;
+                }
+                d.open.insert(c);
+            }
+            d.accepted++;
+            if (http) {
+                const int one = 1;
+                setsockopt(c, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            }
+            std::thread([&d, c, http] {
+                if (http) serve_http(d, c);
+                else serve_unix(d, c);
+                std::lock_guard<std::mutex> lk(d.mu);
+                d.open.erase(c);
+                ::close(c);
+                d.cv.notify_all();      // under the lock: d may go away once open is empty
+            }).detach();
+        }
+    }
+
+    // Stop: no new connections, wake every reader, let the requests in flight finish.
+    std::fprintf(stderr, "astrologyd: stopping\n");
+    if (ufd >= 0) { close(ufd); unlink(socketPath.c_str()); }
+    if (hfd >= 0) close(hfd);
+    {
+        std::unique_lock<std::mutex> lk(d.mu);
+        for (int c : d.open) shutdown(c, SHUT_RD);
+        d.cv.wait(lk, [&] { return d.open.empty(); });
+    }
+    svc.stop();
+    std::string m;
+    d.metricsJson(m);
+    std::fprintf(stderr, "%s\n", m.c_str());
+    return 0;
+}
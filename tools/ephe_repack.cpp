@@ -0,0 +1,66 @@
+// ephe_repack.cpp — writes flat, decode-free copies of Swiss Ephemeris files (C++17)
+//
+// usage: ephe_repack <file.se1 | directory>...
+//
+// For every sweph file xxx.se1 it writes xxx.sef next to it (see
+// swe_repack_ephe_file() in swephexp.h): each segment's coefficients as the
+// ephemeris evaluates them, aligned little-endian doubles with a flat index.
+// Once a .sef lies next to its .se1, a segment switch repoints into the
+// mapped file instead of unpacking bits, at several times the disk size.
+// A directory argument converts every .se1 in it (not recursively). Delete
+// the .sef files, or call swe_set_ephe_flat(FALSE), to go back.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <system_error>
+#include <vector>
+
+extern "C" {
+#include "swephexp.h"
+}
+
+namespace fs = std::filesystem;
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::fprintf(stderr, "usage: ephe_repack <file.se1 | directory>...\n");
+        return 2;
+    }
+    std::vector<fs::path> files;
+    for (int i = 1; i < argc; ++i) {
+        const fs::path p = argv[i];
+        std::error_code ec;
+        if (fs::is_directory(p, ec)) {
+            std::vector<fs::path> in;
+            for (const auto& e : fs::directory_iterator(p, ec))
+                if (e.is_regular_file() && e.path().extension() == ".se1") in.push_back(e.path());
+            std::sort(in.begin(), in.end());
+            files.insert(files.end(), in.begin(), in.end());
+        } else {
+            files.push_back(p);
+        }
+    }
+
+    const auto t0 = std::chrono::steady_clock::now();
+    uintmax_t inBytes = 0, outBytes = 0;
+    int failed = 0;
+    char serr[AS_MAXCH];
+    for (const fs::path& f : files) {
+        if (swe_repack_ephe_file(f.string().c_str(), nullptr, serr) != OK) {
+            std::fprintf(stderr, "ephe_repack: %s: %s\n", f.string().c_str(), serr);
+            ++failed;
+            continue;
+        }
+        std::error_code ec;
+        inBytes += fs::file_size(f, ec);
+        outBytes += fs::file_size(fs::path(f).replace_extension(".sef"), ec);
+    }
+    swe_close();
+    std::printf("%zu files, %.1f MB -> %.1f MB in %.2f s, %d failed\n", files.size() - failed,
+                inBytes / 1048576.0, outBytes / 1048576.0,
+                std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count(), failed);
+    return failed ? 1 : 0;
+}
@@ -26,21 +26,15 @@
 #include "backends/imgui_impl_win32.h"
 #include "backends/imgui_impl_dx11.h"
 
-// Your core header with the class + helpers:
-extern "C" { 
-#include "swephexp.h" 
-}
+// Shared core: AstrologyChart + helpers (also pulls in swephexp.h)
+#include "AstrologyChart.hpp"
+#include "DateTime.hpp"
+#include "Aspects.hpp"
 #include <cmath>
 #include <iostream>
 #include "Gazetteer.hpp"
+#include "TimeZones.hpp"
 
-// ==== BEGIN: Paste the SAME helpers + AstrologyChart from your working console version ====
-// Keep these declarations in a shared header if you prefer.
-
-static inline double norm360(double x) { double y = fmod(x, 360.0); if (y < 0) y += 360.0; return y; }
-struct DMS { int deg; int min; double sec; };
-static DMS toDMS(double degrees) { double d = floor(degrees); double mfull = (degrees - d) * 60.0; double m = floor(mfull); double s = (mfull - m) * 60.0; return { (int)d,(int)m,s }; }
-static const char* SIGN_NAMES[12] = { "Aries","Taurus","Gemini","Cancer","Leo","Virgo","Libra","Scorpio","Sagittarius","Capricorn","Aquarius","Pisces" };
 static inline float deg2rad(float deg) { return deg * (float)M_PI / 180.0f; }
 static inline ImVec2 polar(const ImVec2& C, float R, float angRad) {
 	return ImVec2(C.x + R * cosf(angRad), C.y + R * sinf(angRad));
@@ -64,36 +58,10 @@ static inline float ecl_to_screen_angle(float ecl_deg, float asc_deg)
 	return deg2rad(a);
 }
 
-// Planet colors (tweak to taste)
-static ImU32 colSun = IM_COL32(255, 212, 0, 255);
-static ImU32 colMoon = IM_COL32(210, 210, 210, 255);
-static ImU32 colMercury = IM_COL32(160, 160, 160, 255);
-static ImU32 colVenus = IM_COL32(255, 140, 170, 255);
-static ImU32 colMars = IM_COL32(230, 60, 60, 255);
-static ImU32 colJupiter = IM_COL32(235, 170, 60, 255);
-static ImU32 colSaturn = IM_COL32(160, 120, 70, 255);
-static ImU32 colUranus = IM_COL32(80, 200, 200, 255);
-static ImU32 colNeptune = IM_COL32(80, 140, 220, 255);
-static ImU32 colPluto = IM_COL32(170, 80, 190, 255);
-static ImU32 colNode = IM_COL32(120, 120, 120, 255);
-static ImU32 colChiron = IM_COL32(120, 170, 80, 255);
-static ImU32 colLilith = IM_COL32(210, 80, 180, 255);
-
-static ImU32 color_for_body(const std::string& n) {
-    if (n == "Sun") return colSun;
-    if (n == "Moon") return colMoon;
-    if (n == "Mercury") return colMercury;
-    if (n == "Venus") return colVenus;
-    if (n == "Mars") return colMars;
-    if (n == "Jupiter") return colJupiter;
-    if (n == "Saturn") return colSaturn;
-    if (n == "Uranus") return colUranus;
-    if (n == "Neptune") return colNeptune;
-    if (n == "Pluto") return colPluto;
-    if (n == "True Node" || n == "Mean Node") return colNode;
-    if (n == "Chiron") return colChiron;
-    if (n == "Lilith") return colLilith;
-    return IM_COL32(220, 220, 220, 255);
+// Planet colors, indexed by BodyId (defaults from the body registry)
+static ImU32 body_color(BodyId id) {
+    const uint32_t c = kBodyInfo[id].rgb;
+    return IM_COL32((c >> 16) & 255, (c >> 8) & 255, c & 255, 255);
 }
 
 // Aspect settings
@@ -178,20 +146,10 @@ static bool EditColorFromU32(const char* id, ImU32& col)
     return changed;
 }
 
-// body class → orb multiplier
-static float orb_weight_for(const std::string& n) {
-    if (n == "Sun" || n == "Moon") 
-        return gOrbLuminaries * gOrbGlobal;
-    if (n == "Mercury" || n == "Venus" || n == "Mars") 
-        return gOrbPersonal * gOrbGlobal;
-    if (n == "Jupiter" || n == "Saturn") 
-        return gOrbSocial * gOrbGlobal;
-    if (n == "Uranus" || n == "Neptune" || n == "Pluto") 
-        return gOrbOuter * gOrbGlobal;
-    // points/asteroids
-    if (n == "ASC" || n == "MC" || n == "True Node" || n == "Mean Node" || n == "Chiron" || n == "Lilith") 
-        return gOrbPoints * gOrbGlobal;
-    return gOrbGlobal;
+// body class → orb multiplier, as a table indexed by body id
+static OrbWeights orb_weights() {
+    const double cls[kNumOrbClasses] = { gOrbLuminaries, gOrbPersonal, gOrbSocial, gOrbOuter, gOrbPoints, 1.0 };
+    return OrbWeights::fromClasses(cls, gOrbGlobal);
 }
 
 // tiny swatch helper for legend/table
@@ -202,7 +160,10 @@ static void DrawColorSwatch(ImU32 col, const ImVec2& size = ImVec2(18, 3)) {
     ImGui::GetWindowDrawList()->AddRectFilled(p0, p1, col, 2.0f);
 }
 
-auto places = load_places_csv("data/places/world_cities_min.csv");
+// compiled gazetteer (tools/gazetteer_compile) if present, else the bundled CSV
+static Gazetteer places;
+static bool placesLoaded = places.open("data/places/world_cities.gaz")
+    || places.loadCsv("data/places/world_cities_min.csv");
 static char cityQuery[128] = "";
 static std::vector<int> cityHits;
 static int selectedCity = -1;
@@ -210,69 +171,6 @@ static int selectedCity = -1;
 static bool gInputIsLocal = true;
 static std::string gSelectedTzid = "UTC";
 
-static std::string fmtLongitude(double lon, bool asciiDegrees = false) {
-    lon = norm360(lon);
-    int signIdx = (int)(lon / 30.0) % 12;
-    double within = fmod(lon, 30.0);
-    auto dms = toDMS(within);
-    std::ostringstream os;
-    os << SIGN_NAMES[signIdx] << " " << dms.deg << (asciiDegrees ? " deg " : "° ") << std::setfill('0') << std::setw(2) << dms.min << "' " << std::fixed << std::setprecision(2) << dms.sec << "\"";
-    return os.str();
-}
-static bool parseUtcDateTime(const std::string& s, int& Y, int& M, int& D, double& hour) {
-    if (s.size() < 16) return false;
-    try {
-        Y = std::stoi(s.substr(0, 4)); M = std::stoi(s.substr(5, 2)); D = std::stoi(s.substr(8, 2));
-        int h = std::stoi(s.substr(11, 2)); int m = std::stoi(s.substr(14, 2)); double sec = 0.0;
-        if (s.size() >= 19) sec = std::stod(s.substr(17));
-        hour = h + m / 60.0 + sec / 3600.0; return true;
-    }
-    catch (...) { return false; }
-}
-
-struct Body { std::string name; double lon{}, lat{}, speed{}; bool retro{}; };
-struct Houses { double cusps[13]{}; double ascmc[10]{}; };
-
-class AstrologyChart {
-public:
-    AstrologyChart(int Y, int M, int D, double hour_utc, double lat_deg, double lon_deg, char hsys = 'P')
-        : Y(Y), M(M), D(D), hour(hour_utc), lat(lat_deg), lon(lon_deg), hsys(hsys) {
-        jd_ut = swe_julday(Y, M, D, hour, SE_GREG_CAL);
-    }
-    void compute() { computePlanets(); computeHouses(); }
-    const std::vector<Body>& getBodies() const { return bodies; }
-    const Houses& getHouses() const { return H; }
-    double getJDUT() const { return jd_ut; }
-    char getHouse() const { return hsys; }
-private:
-    int Y, M, D; double hour, lat, lon; char hsys; double jd_ut{}; std::vector<Body> bodies; Houses H{};
-    void computePlanets() {
-        static const int kBodies[] = { SE_SUN,SE_MOON,SE_MERCURY,SE_VENUS,SE_MARS,SE_JUPITER,SE_SATURN,SE_URANUS,SE_NEPTUNE,SE_PLUTO,SE_TRUE_NODE,SE_CHIRON,SE_MEAN_APOG };
-        bodies.clear();
-        for (int ipl : kBodies) {
-            double xx[6]; char serr[256] = { 0 };
-            int rc = swe_calc_ut(jd_ut, ipl, SEFLG_SWIEPH | SEFLG_SPEED, xx, serr);
-            if (rc < 0) throw std::runtime_error(std::string("swe_calc_ut: ") + serr);
-            Body b;
-            switch (ipl) {
-            case SE_SUN: b.name = "Sun"; break; case SE_MOON: b.name = "Moon"; break; case SE_MERCURY: b.name = "Mercury"; break;
-            case SE_VENUS: b.name = "Venus"; break; case SE_MARS: b.name = "Mars"; break; case SE_JUPITER: b.name = "Jupiter"; break;
-            case SE_SATURN: b.name = "Saturn"; break; case SE_URANUS: b.name = "Uranus"; break; case SE_NEPTUNE: b.name = "Neptune"; break;
-            case SE_PLUTO: b.name = "Pluto"; break; case SE_TRUE_NODE: b.name = "True Node"; break; case SE_CHIRON: b.name = "Chiron"; break;
-            case SE_MEAN_APOG: b.name = "Lilith"; break; default: b.name = "Body"; break;
-            }
-            b.lon = norm360(xx[0]); b.lat = xx[1]; b.speed = xx[3]; b.retro = (xx[3] < 0);
-            bodies.push_back(b);
-        }
-    }
-    void computeHouses() {
-        int rc = swe_houses_ex(jd_ut, SEFLG_SWIEPH, lat, lon, hsys, H.cusps, H.ascmc);
-        if (rc == -1) throw std::runtime_error("swe_houses_ex failed");
-    }
-};
-
-// ==== END: helpers + class ====
-
 // Win32 / DX11 glue (trimmed from ImGui example)
 extern LRESULT ImGui_ImplWin32_WndProcHandler(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam);
 static ID3D11Device* g_pd3dDevice = nullptr;
@@ -316,28 +214,24 @@ static LRESULT WINAPI WndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam)
     return DefWindowProc(hWnd, msg, wParam, lParam);
 }
 
-// Example helper (you can drop this right above wWinMain or in an anon. namespace)
-static bool LocalToUTC(const std::string& tzid, int Y, int M, int D, int hh, int mm, int ss, int& outY, int& outM, int& outD, double& outHourDec)
+// Zone loader over the date library's tzdb, for installs without data/zoneinfo.
+// Walks the zone's sys_info spans once; TzDatabase keeps the compiled arrays.
+static bool LoadZoneFromTzdb(std::string_view tzid, std::vector<int64_t>& trans, std::vector<int32_t>& off)
 {
     try {
         using namespace date;
         using namespace std::chrono;
 
-        const time_zone* tz = locate_zone(tzid);           // throws if unknown tzid
-        local_time<seconds> lt = local_days{ year{Y} / M / D }   // local wall-clock
-        + hours{ hh } + minutes{ mm } + seconds{ ss };
-        zoned_time<seconds> zt{ tz, lt };                    // apply STD/DST rules
-        sys_time<seconds> st = zt.get_sys_time();          // UTC
-
-        // break out fields for Swiss Ephemeris
-        std::time_t tt = system_clock::to_time_t(st);
-        std::tm g{};
-        gmtime_s(&g, &tt);  // Windows-safe
-
-        outY = g.tm_year + 1900;
-        outM = g.tm_mon + 1;
-        outD = g.tm_mday;
-        outHourDec = g.tm_hour + g.tm_min / 60.0 + g.tm_sec / 3600.0;
+        const time_zone* tz = locate_zone(std::string(tzid));   // throws if unknown tzid
+        const sys_seconds last = sys_days{ year{2401} / 1 / 1 };
+        sys_info i = tz->get_info(sys_seconds{ sys_days{ year{1800} / 1 / 1 } });
+        off.push_back((int32_t)i.offset.count());
+        while (i.end < last) {
+            const sys_seconds t = i.end;
+            i = tz->get_info(t);
+            trans.push_back(t.time_since_epoch().count());
+            off.push_back((int32_t)i.offset.count());
+        }
         return true;
     }
     catch (...) {
@@ -367,7 +261,9 @@ int APIENTRY wWinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance
     ImGui_ImplWin32_Init(hwnd);
     ImGui_ImplDX11_Init(g_pd3dDevice, g_pd3dDeviceContext);
 
-    date::reload_tzdb();   // safe to call; ensures tzdb is present/updated
+    // Zones compile on first use from data/zoneinfo (TZif); without it, from the date library's tzdb.
+    if (!std::filesystem::exists(TzDatabase::default_dir()))
+        tz_database().setLoader(LoadZoneFromTzdb);
 
     // Input state
     char ts[32] = "1996-02-12 16:20:00";  // UTC
@@ -379,7 +275,7 @@ int APIENTRY wWinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance
     std::string error;
 
     // Computed data
-    std::vector<Body> outBodies; Houses outH{};
+    ChartBodies outBodies{}; Houses outH{};
 
     // Main loop
     MSG msg; ZeroMemory(&msg, sizeof(msg));
@@ -428,13 +324,13 @@ int APIENTRY wWinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance
 		ImGui::InputText("City", cityQuery, IM_ARRAYSIZE(cityQuery));
         ImGui::SameLine();
         if (ImGui::Button("Find")) {
-            find_places(places, cityQuery, cityHits);
+            places.index().find(cityQuery, cityHits);
             selectedCity = -1;
         }
         if (!cityHits.empty()) {
             ImGui::BeginChild("cityResults", ImVec2(0, 150), true);
             for (int i = 0; i < (int)cityHits.size(); ++i) {
-                const auto& p = places[cityHits[i]];
+                const PlaceView p = places[cityHits[i]];
                 if (ImGui::Selectable(p.display().c_str(), i==selectedCity)) {
                     selectedCity = i;
 					// Autofill lat/lon and optionally remember tzid
@@ -453,25 +349,26 @@ int APIENTRY wWinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance
 
         if (ImGui::Button("Compute")) {
             try {
-                int Y, M, D; double hourDec;
-                if (!parseUtcDateTime(ts, Y, M, D, hourDec))
-                    throw std::runtime_error("Bad datetime. Use YYYY-MM-DD HH:MM[:SS].");
-
-                // Prepare UTC values (start by assuming the typed time is already UTC)
-                int Uy = Y, Um = M, Ud = D;
-                double UhourDec = hourDec;
-
-                if (gInputIsLocal) {
+                DateTime t;
+                if (parse_iso_datetime(ts, t) != DT_OK)
+                    throw std::runtime_error("Bad datetime. Use YYYY-MM-DD HH:MM[:SS][Z|+HH:MM].");
+
+                // Prepare UTC values: a typed offset already fixes the instant,
+                // so only a bare time in local mode goes through the city's zone.
+                int Uy, Um, Ud;
+                double UhourDec;
+                if (!gInputIsLocal || t.hasOffset) {
+                    parseUtcDateTime(ts, Uy, Um, Ud, UhourDec);
+                } else {
                     if (gSelectedTzid.empty())
                         throw std::runtime_error("No city/timezone selected.");
 
-                    // Split decimal hours into hh:mm:ss
-                    int hh = (int)hourDec;
-                    int mm = (int)((hourDec - hh) * 60.0 + 1e-6);
-                    int ss = (int)((hourDec - hh - mm / 60.0) * 3600.0 + 0.5);
-
-                    if (!LocalToUTC(gSelectedTzid, Y, M, D, hh, mm, ss, Uy, Um, Ud, UhourDec))
-                        throw std::runtime_error("Time zone conversion failed (unknown tzid?).");
+                    switch (local_to_utc(gSelectedTzid, t.year, t.month, t.day, t.hour, Uy, Um, Ud, UhourDec)) {
+                    case TZ_OK: break;
+                    case TZ_AMBIGUOUS: throw std::runtime_error("Local time occurs twice (DST ends); enter it in UTC.");
+                    case TZ_NONEXISTENT: throw std::runtime_error("Local time does not exist (DST starts); enter it in UTC.");
+                    default: throw std::runtime_error("Time zone conversion failed (unknown tzid?).");
+                    }
                 }
 
                 hsys = (houseIdx == 0 ? 'P' : houseIdx == 1 ? 'W' : houseIdx == 2 ? 'E' : 'K');
@@ -564,6 +461,7 @@ int APIENTRY wWinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance
         }
 
         if (hasResult) {
+            char lonBuf[kLongitudeChars];
             if (ImGui::CollapsingHeader("Planets", ImGuiTreeNodeFlags_DefaultOpen)) {
                 if (ImGui::BeginTable("tbl", 3, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
                     ImGui::TableSetupColumn("Body");
@@ -572,8 +470,8 @@ int APIENTRY wWinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance
                     ImGui::TableHeadersRow();
                     for (auto& b : outBodies) {
                         ImGui::TableNextRow();
-                        ImGui::TableSetColumnIndex(0); ImGui::TextUnformatted(b.name.c_str());
-                        ImGui::TableSetColumnIndex(1); ImGui::TextUnformatted(fmtLongitude(b.lon, asciiDegrees).c_str());
+                        ImGui::TableSetColumnIndex(0); ImGui::TextUnformatted(b.name());
+                        ImGui::TableSetColumnIndex(1); fmtLongitude(b.lon, lonBuf, sizeof(lonBuf), asciiDegrees); ImGui::TextUnformatted(lonBuf);
                         ImGui::TableSetColumnIndex(2); ImGui::TextUnformatted(b.retro ? "R" : "");
                     }
                     ImGui::EndTable();
@@ -587,7 +485,7 @@ int APIENTRY wWinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance
                     for (int i = 1;i <= 12;++i) {
                         ImGui::TableNextRow();
                         ImGui::TableSetColumnIndex(0); ImGui::Text("House %d", i);
-                        ImGui::TableSetColumnIndex(1); ImGui::TextUnformatted(fmtLongitude(outH.cusps[i], asciiDegrees).c_str());
+                        ImGui::TableSetColumnIndex(1); fmtLongitude(outH.cusps[i], lonBuf, sizeof(lonBuf), asciiDegrees); ImGui::TextUnformatted(lonBuf);
                     }
                     ImGui::EndTable();
                 }
@@ -703,82 +601,48 @@ int APIENTRY wWinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance
 					draw_axis(mc, IM_COL32(200, 200, 255, 180)); // MC
 					draw_axis(ic, IM_COL32(200, 200, 255, 120)); // IC
 
-                    // -- Aspect helpers --
-                    auto shortest_sep = [](float a, float b) {
-                        float d = fmodf(fabsf(a - b), 360.0f);
-                        if (d > 180.0f) d = 360.0f - d; // fold to 0..180
-                        return d;
-                        };
-
-                    // collect draw positions for planets + points we want to include
-                    struct P { ImVec2 p; float lon; std::string name; };
-					float R_line = R_planet - wheel_size * 0.03f;
-
-                    std::vector<P> ps; ps.reserve(outBodies.size() + 5);
-                    // planets/asteroids/nodes you already compute
+                    // -- Aspects --
+                    // aspectable points: bodies (Node/Chiron/Lilith per checkbox) + ASC/MC
+                    std::vector<AspectPoint> ps; ps.reserve(outBodies.size() + 2);
                     for (const auto& b : outBodies) {
-                        float a = ecl_to_screen_angle((float)b.lon, asc);
-                        ps.push_back({ polar(center, R_line, a), (float)b.lon, b.name });
-                    }
-
-					// sensitive points (added based on checkboxes)
-					float lonASC = (float)outH.ascmc[SE_ASC];
-                    float lonMC = (float)outH.ascmc[SE_MC];
-					float lonNode = (float)outBodies.back().lon; // if you want your existing True Node
-					// ^^^ optionally, look up by name instead of "back()"
-
-                    if (gUseASC)    ps.push_back({ polar(center, R_line, ecl_to_screen_angle(lonASC, asc)), lonASC, "ASC" });
-                    if (gUseMC)     ps.push_back({ polar(center, R_line, ecl_to_screen_angle(lonMC, asc)), lonMC, "MC" });
-					if (gUseNode)   ps.push_back({ polar(center, R_line, ecl_to_screen_angle((float)lonNode, asc)), (float)lonNode, "True Node" });
-                    if (gUseChiron) {
-                        auto it = std::find_if(outBodies.begin(), outBodies.end(), [](const Body& b) { return b.name == "Chiron"; });
-                        if (it != outBodies.end()) { float a = ecl_to_screen_angle((float)it->lon, asc);
-                            ps.push_back({ polar(center, R_line, a), (float)it->lon, it->name }); }
+                        if (b.id == BODY_NODE && !gUseNode) continue;
+                        if (b.id == BODY_CHIRON && !gUseChiron) continue;
+                        if (b.id == BODY_LILITH && !gUseLilith) continue;
+                        ps.push_back({ b.ipl(), b.lon, b.speed });
                     }
-                    if (gUseLilith) {
-                        auto it = std::find_if(outBodies.begin(), outBodies.end(), [](const Body& b) { return b.name == "Lilith"; });
-                        if (it != outBodies.end()) { float a = ecl_to_screen_angle((float)it->lon, asc); ps.push_back({ polar(center, R_line, a), (float)it->lon, it->name }); }
+                    if (gUseASC) ps.push_back({ ASP_ASC, outH.ascmc[SE_ASC], 0.0 });
+                    if (gUseMC)  ps.push_back({ ASP_MC, outH.ascmc[SE_MC], 0.0 });
+
+                    // enabled aspects; defIdx maps back into gAspects for color/width
+                    std::vector<AspectDef> defs; std::vector<int> defIdx;
+                    for (int k = 0; k < (int)gAspects.size(); ++k) {
+                        if (!gAspects[k].enabled) continue;
+                        defs.push_back({ gAspects[k].label.c_str(), gAspects[k].angle, gAspects[k].base_orb });
+                        defIdx.push_back(k);
                     }
 
-					// For each pair, draw the *best* matching aspect (if any),
+					// Draw the *best* matching aspect of each pair (if any),
 					// so we don't stack multiple lines for near-angles.
-                    for (int i = 0; i < (int)ps.size(); ++i) {
-                        for (int j = i + 1; j < (int)ps.size(); ++j) {
-							float sep = shortest_sep(ps[i].lon, ps[j].lon); // 0..180
-
-							const AspectSetting* best = nullptr;
-                            float bestDelta = 1e9f;
-
-							// Allowed orb scales with the weaker of the two bodies
-                            float scale = (std::min)(orb_weight_for(ps[i].name), orb_weight_for(ps[j].name));
-
-                            for (const auto& A : gAspects) {
-								if (!A.enabled) continue;
-								float allow = A.base_orb * scale;
-                                float delta = fabsf(sep - A.angle);
-                                if (delta <= allow && delta < bestDelta) {
-									bestDelta = delta; 
-                                    best = &A;
-                                }
-							}
-
-                            if (best) {
-								// avoid any tiny "dot" for near-perfect conjunction
-								if (best->angle == 0.0f && sep < 0.4f) continue;
-								ImGui::GetWindowDrawList()->AddLine(ps[i].p, ps[j].p, best->color, best->width);
-                            }
-                        }
+                    static AspectFinder finder;
+					float R_line = R_planet - wheel_size * 0.03f;
+                    for (const AspectHit& h : finder.find(ps.data(), ps.size(), defs.data(), defs.size(), orb_weights(), true)) {
+                        const AspectSetting& A = gAspects[defIdx[h.aspect]];
+						// avoid any tiny "dot" for near-perfect conjunction
+                        if (A.angle == 0.0f && h.orb < 0.4) continue;
+                        ImVec2 p1 = polar(center, R_line, ecl_to_screen_angle((float)ps[h.i].lon, asc));
+                        ImVec2 p2 = polar(center, R_line, ecl_to_screen_angle((float)ps[h.j].lon, asc));
+                        draw->AddLine(p1, p2, A.color, A.width);
                     }
 
                     // Planets + labels
                     for (const auto& b : outBodies) {
                         float ang = ecl_to_screen_angle((float)b.lon, asc);
                         ImVec2 pt = polar(center, R_planet, ang);
-                        ImU32 col = color_for_body(b.name);
+                        ImU32 col = body_color(b.id);
                         draw->AddCircleFilled(pt, wheel_size * 0.012f, col, 24);
 
                         ImVec2 lbl = polar(center, R_planet + wheel_size * 0.04f, ang);
-                        draw->AddText(lbl, col, b.name.c_str());
+                        draw->AddText(lbl, col, b.name());
                     }
 
                     // Center marker
@@ -800,22 +664,21 @@ int APIENTRY wWinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance
                     ImGui::TableSetupColumn("Color");
                     ImGui::TableHeadersRow();
 
-                    auto row = [&](const char* name) {
+                    for (int id = 0; id < kNumBodyIds; ++id) {
+                        const char* name = kBodyInfo[id].name;
                         ImGui::TableNextRow();
                         ImGui::TableSetColumnIndex(0);
-                        ImU32 c = color_for_body(name);
-                        ImGui::InvisibleButton(("##" + std::string(name)).c_str(), ImVec2(16, 16));
+                        ImU32 c = body_color((BodyId)id);
+                        ImGui::PushID(id);
+                        ImGui::InvisibleButton("##swatch", ImVec2(16, 16));
+                        ImGui::PopID();
                         ImVec2 p = ImGui::GetItemRectMin();
                         ImVec2 q = ImGui::GetItemRectMax();
                         ImGui::GetWindowDrawList()->AddRectFilled(p, q, c, 3.0f);
 
                         ImGui::TableSetColumnIndex(1); ImGui::TextUnformatted(name);
-                        ImGui::TableSetColumnIndex(2); ImGui::Text("#%02X%02X%02X", (c >> 16) & 255, (c >> 8) & 255, c & 255);
-                        };
-
-                    row("Sun"); row("Moon"); row("Mercury"); row("Venus"); row("Mars");
-                    row("Jupiter"); row("Saturn"); row("Uranus"); row("Neptune"); row("Pluto");
-                    row("True Node"); row("Chiron"); row("Lilith");
+                        ImGui::TableSetColumnIndex(2); ImGui::Text("#%06X", kBodyInfo[id].rgb);
+                    }
                     ImGui::EndTable();
                 }
 				// Aspect colors